@@ -4,8 +4,10 @@ set_property(CACHE ACE_LIBRARY_KIND PROPERTY STRINGS ${ACE_LIBRARY_KINDS})
 set(ACE_DEBUG OFF CACHE BOOL "Build with ACE-specific debug/safety functionality.")
 set(ACE_DEBUG_UAE OFF CACHE BOOL "With ACE_DEBUG enabled, output log to UAE console.")
 set(ACE_DEBUG_SERIAL OFF CACHE BOOL "With ACE_DEBUG enabled, output log to serial port.")
+set(ACE_DEBUG_LOG_BINARY OFF CACHE BOOL "With ACE_DEBUG enabled, write log file in unformatted binary form, to be decoded with log_decode tool.")
 set(ACE_BOB_WRAP_Y ON CACHE BOOL "Conrols Y-wrapping support in bob manager. Disable for extra performance in simple buffer scenarios.")
 set(ACE_BOB_PRISTINE_BUFFER OFF CACHE BOOL "When enabled, uses pristine buffer for bob undraw instead of allocating restore buffers.")
+set(ACE_BOB_MERGE_UNDRAW OFF CACHE BOOL "With ACE_BOB_PRISTINE_BUFFER enabled, merges undraw areas of overlapping bobs before restoring them.")
 set(ACE_BOB_ALWAYS_ON_SCROLL_BUFFER OFF CACHE BOOL "When enabled, allows for extra optimizations for bobs.")
 set(ACE_USE_ECS_FEATURES OFF CACHE BOOL "Enable ECS feature sets, makes ACE OCS-incompatible.")
 set(ACE_USE_AGA_FEATURES OFF CACHE BOOL "Enable AGA feature sets, makes ACE use AGA Features.")
@@ -21,8 +23,10 @@ message(STATUS "[ACE] ACE_LIBRARY_KIND: '${ACE_LIBRARY_KIND}'")
 message(STATUS "[ACE] ACE_DEBUG: '${ACE_DEBUG}'")
 message(STATUS "[ACE] ACE_DEBUG_UAE: '${ACE_DEBUG_UAE}'")
 message(STATUS "[ACE] ACE_DEBUG_SERIAL: '${ACE_DEBUG_SERIAL}'")
+message(STATUS "[ACE] ACE_DEBUG_LOG_BINARY: '${ACE_DEBUG_LOG_BINARY}'")
 message(STATUS "[ACE] ACE_BOB_WRAP_Y: '${ACE_BOB_WRAP_Y}'")
 message(STATUS "[ACE] ACE_BOB_PRISTINE_BUFFER: '${ACE_BOB_PRISTINE_BUFFER}'")
+message(STATUS "[ACE] ACE_BOB_MERGE_UNDRAW: '${ACE_BOB_MERGE_UNDRAW}'")
 message(STATUS "[ACE] ACE_BOB_ALWAYS_ON_SCROLL_BUFFER: '${ACE_BOB_ALWAYS_ON_SCROLL_BUFFER}'")
 message(STATUS "[ACE] ACE_USE_ECS_FEATURES: '${ACE_USE_ECS_FEATURES}'")
 message(STATUS "[ACE] ACE_USE_AGA_FEATURES: '${ACE_USE_AGA_FEATURES}'")
@@ -120,6 +120,7 @@ int main(void) {
 #if !defined(GENERIC_MAIN_NO_TIMER)
 		timerProcess();
 #endif
+		memFrameReset();
 		genericProcess();
 	}
 	genericDestroy();
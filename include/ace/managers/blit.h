@@ -49,6 +49,50 @@ extern "C" {
 #define MINTERM_REVERSE_COOKIE 0xAC
 #define MINTERM_COPY 0xC0
 
+/**
+ * @brief Single blit of the blit plan, done on each bitplane.
+ */
+typedef struct tBlitPass {
+	ULONG ulSrcOffs; ///< Byte offset of first blitted word in source planes.
+	LONG lDstOffs; ///< Offset of first blitted word relative to dest pos.
+	UWORD uwBltCon0;
+	UWORD uwBltCon1;
+	UWORD uwFirstMask;
+	UWORD uwLastMask;
+	WORD wSrcModulo;
+	WORD wDstModulo;
+	UWORD uwBlitWords; ///< Zero if pass is unused.
+} tBlitPass;
+
+/**
+ * @brief Precomputed copy of fixed source region onto destination bitmap
+ * of given geometry, at given X phase (position within 16-pixel word).
+ *
+ * Computing shifts, masks, modulos, blit direction and size is done once
+ * in blitPlanInit(), so drawing the same shape many times with only
+ * destination position changing is reduced to register writes.
+ *
+ * @see blitPlanInit()
+ * @see blitPlanExecute()
+ */
+typedef struct tBlitPlan {
+	const tBitMap *pSrc;
+	const UBYTE *pMsk; ///< Optional mask for A channel, zero if none.
+	/**
+	 * Masked copy with source spanning one word less than destination can't
+	 * have both source ends masked by a single blit wider than 2 words,
+	 * so its last destination word is done by the second pass.
+	 */
+	tBlitPass pPasses[2];
+	UWORD uwBlitHeight; ///< Already multiplied by depth for interleaved blits.
+	UBYTE ubPlaneCount; ///< Number of bitplanes blitted separately.
+	UBYTE isInterleaved; ///< If set, all bitplanes are done in single blit.
+	UBYTE ubDstPhase; ///< Dest X & 0xF which plan was made for.
+#if defined(ACE_DEBUG)
+	UWORD uwDstBytesPerRow; ///< For checking if dest matches plan's geometry.
+#endif
+} tBlitPlan;
+
 typedef enum tBlitLineMode {
 	BLIT_LINE_MODE_OR = ((ABC | ABNC | NABC | NANBC) | (SRCA | SRCC | DEST)),
 	BLIT_LINE_MODE_XOR = ((ABNC | NABC | NANBC) | (SRCA | SRCC | DEST)),
@@ -285,6 +329,62 @@ UBYTE blitSafeCopyMask(
 	UWORD uwLine, const char *szFile
 );
 
+/**
+ * @brief Prepares the plan of rectangular copy from given source region
+ * onto destination with given geometry.
+ *
+ * Plan may be executed on any bitmap with the same BytesPerRow, depth
+ * and interleaving as pDst, on any position with matching X phase.
+ * Source bitmap and mask must stay valid as long as plan is used.
+ *
+ * @param pPlan Plan to be initialized.
+ * @param pSrc Source bitmap.
+ * @param wSrcX Source rectangle top-left position's X-coordinate.
+ * @param wSrcY Source rectangle top-left position's Y-coordinate.
+ * @param pDst Bitmap describing destination geometry.
+ * @param ubDstPhase Destination X-coordinate modulo 16.
+ * @param wWidth Rectangle width.
+ * @param wHeight Rectangle height.
+ * @param ubMinterm Minterm to be used for blitter operation, usually MINTERM_COOKIE.
+ * @param pMsk Raw mask bitplane data in the same format as for
+ * blitUnsafeCopyMask(), or zero for unmasked copy.
+ *
+ * @see blitPlanExecute()
+ * @see blitPlanSetMinterm()
+ */
+void blitPlanInit(
+	tBlitPlan *pPlan, const tBitMap *pSrc, WORD wSrcX, WORD wSrcY,
+	const tBitMap *pDst, UBYTE ubDstPhase, WORD wWidth, WORD wHeight,
+	UBYTE ubMinterm, const UBYTE *pMsk
+);
+
+/**
+ * @brief Changes the minterm used by given blit plan, e.g. for drawing
+ * the same shape on different bitplanes with different operation.
+ *
+ * @param pPlan Plan to be changed.
+ * @param ubMinterm New minterm.
+ */
+static inline void blitPlanSetMinterm(tBlitPlan *pPlan, UBYTE ubMinterm) {
+	pPlan->pPasses[0].uwBltCon0 = (pPlan->pPasses[0].uwBltCon0 & 0xFF00) | ubMinterm;
+	pPlan->pPasses[1].uwBltCon0 = (pPlan->pPasses[1].uwBltCon0 & 0xFF00) | ubMinterm;
+}
+
+/**
+ * @brief Performs the blit described by the plan, without any safety checks.
+ *
+ * @param pPlan Plan of the blit.
+ * @param pDst Destination bitmap, with same geometry as one used for plan.
+ * @param wDstX Destination rectangle top-left position's X-coordinate.
+ * Must be non-negative and have the same phase as one used for plan.
+ * @param wDstY Destination rectangle top-left position's Y-coordinate.
+ *
+ * @see blitPlanInit()
+ */
+void blitPlanExecute(
+	const tBlitPlan *pPlan, tBitMap *pDst, WORD wDstX, WORD wDstY
+);
+
 /**
  * @brief Performs the rectangular fill with selected color.
  *
@@ -72,6 +72,13 @@ typedef struct tBob {
 	UWORD _uwBlitSize;
 	WORD _wModuloUndrawSave;
 	UWORD _uwInterleavedHeight;
+	// Draw blit registers cached for last used X phase
+	UWORD _uwDrawBltCon0;
+	UWORD _uwDrawLastMask;
+	UWORD _uwDrawBlitSize;
+	WORD _wDrawSrcModulo;
+	WORD _wDrawDstModulo;
+	UBYTE _ubDrawPhase;
 #if defined(ACE_BOB_PRISTINE_BUFFER)
 	ULONG _pSaveOffsets[2];
 #else
@@ -79,6 +86,19 @@ typedef struct tBob {
 #endif
 } tBob;
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+/**
+ * @brief Counters of merged undraw, accumulated since last
+ * bobResetUndrawStats() call. Sizes are in words, counting all bitplanes.
+ */
+typedef struct tBobUndrawStats {
+	ULONG ulRects;     ///< Undraw rects of bobs.
+	ULONG ulRectWords; ///< Size of undraw rects, as restored without merging.
+	ULONG ulBlits;     ///< Restore blits done after merging.
+	ULONG ulBlitWords; ///< Size actually restored after merging.
+} tBobUndrawStats;
+#endif
+
 /**
  * @brief Creates bob manager with optional double buffering support.
  * If you use single buffering, pass same pointer in pFront and pBack.
@@ -260,6 +280,20 @@ void bobEnd(void);
 
 void bobDiscardUndraw(void);
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+/**
+ * @brief Gets counters of merged undraw, allowing to check how much blitter
+ * time is saved, i.e. `ulRectWords - ulBlitWords`.
+ *
+ * @return Pointer to counters, valid until bob manager is destroyed.
+ *
+ * @see bobResetUndrawStats()
+ */
+const tBobUndrawStats *bobGetUndrawStats(void);
+
+void bobResetUndrawStats(void);
+#endif
+
 /**
  * @brief Sets the current buffer to given bitmap in case it loses sync.
  * Usually used in tandem with bobDiscardUndraw() when bob system was disabled
@@ -59,6 +59,21 @@ void _logWrite(char *szFormat, ...) __attribute__ ((format (printf, 1, 2)));
 
 void _logWriteVa(char *szFormat, va_list vaArgs);
 
+/**
+ * @brief Writes messages buffered for log file to the disk.
+ *
+ * File log messages are buffered in RAM since each file write requires OS.
+ * The buffer is flushed when it's full, on state changes and on log close,
+ * call this on other safe points, e.g. before expected crash site.
+ */
+void _logFlush(void);
+
+/**
+ * @brief Flushes buffered file log messages if there's enough of them.
+ * Called by systemIdleBegin().
+ */
+void _logFlushOnIdle(void);
+
 // Functions - block logging
 
 void _logBlockBegin(char *szBlockName, ...) __attribute__ ((format (printf, 1, 2)));
@@ -82,6 +97,8 @@ void _logAvgWrite(tAvg *pAvg);
 #define logPopInt() _logPopInt()
 #define logWrite(...) _logWrite(__VA_ARGS__)
 #define logWriteVa(szFormat, vaArgs) _logWriteVa(szFormat, vaArgs)
+#define logFlush() _logFlush()
+#define logFlushOnIdle() _logFlushOnIdle()
 
 #define logBlockBegin(...) _logBlockBegin(__VA_ARGS__)
 #define logBlockEnd(szBlockName) _logBlockEnd(szBlockName)
@@ -101,6 +118,8 @@ void _logAvgWrite(tAvg *pAvg);
 #define logPopInt()
 #define logWrite(...)
 #define logWriteVa(szFormat, vaArgs)
+#define logFlush()
+#define logFlushOnIdle()
 
 #define logBlockBegin(...)
 #define logBlockEnd(szBlockName)
@@ -28,6 +28,24 @@ extern "C" {
 
 /* Types */
 
+/**
+ * @brief Pool of same-sized elements, allocated from single memory block.
+ * Allocating and freeing elements is O(1) and doesn't involve the OS.
+ *
+ * @see memPoolCreate
+ */
+typedef struct tMemPool {
+	UBYTE *pData; ///< Element storage.
+	void *pFreeHead; ///< First free element, each one points to next free.
+	ULONG ulElemSize; ///< Element size, rounded up for alignment.
+	UWORD uwElemCount;
+	UWORD uwUsedCount; ///< Number of currently allocated elements.
+	UWORD uwPeakCount; ///< Max number of elements allocated at once.
+#if defined(ACE_DEBUG)
+	UBYTE *pUsed; ///< Per-element in-use flags, for catching bad frees.
+#endif
+} tMemPool;
+
 /* Globals */
 
 /* Functions */
@@ -58,6 +76,103 @@ void _memCheckIntegrity(UWORD uwLine, const char *szFile);
 
 void _memLogPeak(void);
 
+/**
+ * @brief Creates pool of same-sized elements, e.g. for bobs, copper blocks
+ * or game entities created and destroyed at runtime.
+ *
+ * Whole pool storage is a single tracked allocation, so it's included in
+ * CHIP/FAST usage and leak reports of debug builds.
+ *
+ * @param ulElemSize Size of single element, in bytes.
+ * @param uwElemCount Max number of elements allocated at once.
+ * @param ulMemType Memory type for elements, e.g. MEMF_ANY or MEMF_CHIP for
+ * blitter-visible data. MEMF_CLEAR clears the storage on pool creation only.
+ * @return Newly created pool, zero on failure.
+ *
+ * @see memPoolDestroy
+ * @see memPoolAlloc
+ */
+tMemPool *memPoolCreate(ULONG ulElemSize, UWORD uwElemCount, ULONG ulMemType);
+
+/**
+ * @brief Destroys the pool along with its storage. Elements still allocated
+ * from it become invalid.
+ *
+ * @param pPool Pool to be destroyed.
+ *
+ * @see memPoolCreate
+ */
+void memPoolDestroy(tMemPool *pPool);
+
+/**
+ * @brief Allocates single element from the pool.
+ *
+ * @param pPool Pool to allocate from.
+ * @return Pointer to element, aligned to 4 bytes. Zero if pool is full.
+ * Element contents are undefined.
+ *
+ * @see memPoolFree
+ */
+void *memPoolAlloc(tMemPool *pPool);
+
+/**
+ * @brief Returns element to the pool.
+ *
+ * @param pPool Pool which element was allocated from.
+ * @param pElem Element to be freed.
+ *
+ * @see memPoolAlloc
+ */
+void memPoolFree(tMemPool *pPool, void *pElem);
+
+/**
+ * @brief Allocates per-frame scratch arenas used by memFrameAllocFast()
+ * and memFrameAllocChip().
+ *
+ * Arenas are meant for temporaries which live no longer than single frame,
+ * e.g. formatted strings or sorted lists. Allocating from them is a simple
+ * pointer bump and there is no need to free anything - all allocations
+ * are discarded at once by memFrameReset().
+ *
+ * @param ulFastSize Size of FAST arena, in bytes. May be zero.
+ * @param ulChipSize Size of CHIP arena, in bytes. May be zero.
+ *
+ * @see memFrameArenaDestroy
+ * @see memFrameReset
+ */
+void memFrameArenaCreate(ULONG ulFastSize, ULONG ulChipSize);
+
+/**
+ * @brief Frees per-frame scratch arenas. Their peak usage is still reported
+ * by memLogPeak() and on memory manager destroy.
+ *
+ * @see memFrameArenaCreate
+ */
+void memFrameArenaDestroy(void);
+
+/**
+ * @brief Discards all allocations made from per-frame arenas.
+ * Called once per frame before genericProcess() by generic main - if you
+ * don't use it, call this in your game loop.
+ */
+void memFrameReset(void);
+
+/**
+ * @brief Allocates memory from FAST per-frame arena, valid until next
+ * memFrameReset() call.
+ *
+ * @param ulSize Number of bytes to allocate.
+ * @return Pointer to memory, aligned to 4 bytes. Zero if arena is full.
+ * Memory contents are undefined.
+ */
+void *memFrameAllocFast(ULONG ulSize);
+
+/**
+ * @brief Same as memFrameAllocFast(), but allocates from CHIP arena, so that
+ * memory is accessible by the blitter, copper etc.
+ */
+void *memFrameAllocChip(ULONG ulSize);
+
 /**
  * Macros for enabling or disabling logging
  */
@@ -87,6 +202,8 @@ void _memLogPeak(void);
 #define memAllocChipClear(ulSize) memAlloc(ulSize, MEMF_CHIP | MEMF_CLEAR)
 #define memAllocChipFlags(ulSize, ulFlags) memAlloc(ulSize, MEMF_CHIP | ulFlags)
 #define memAllocFastFlags(ulSize, ulFlags) memAlloc(ulSize, MEMF_ANY |ulFlags)
+#define memPoolCreateFast(ulElemSize, uwElemCount) memPoolCreate(ulElemSize, uwElemCount, MEMF_ANY)
+#define memPoolCreateChip(ulElemSize, uwElemCount) memPoolCreate(ulElemSize, uwElemCount, MEMF_CHIP)
 
 #ifdef __cplusplus
 }
@@ -12,6 +12,11 @@ extern "C" {
 #include <ace/types.h>
 #include <ace/utils/file.h>
 
+// .bm file versions. In version 1, each stored bitplane row is separately
+// compressed with ByteRun1, so it may be unpacked directly into dest bitmap.
+#define BITMAP_VERSION_RAW 0
+#define BITMAP_VERSION_BYTERUN1 1
+
 // File has its own 'flags' field - could be used in new ACE bitmap struct
 #define BITMAP_INTERLEAVED 1
 // FEATURE PROPOSAL:
@@ -16,6 +16,10 @@ typedef enum tDiskFileMode {
 	DISK_FILE_MODE_WRITE,
 } tDiskFileMode;
 
+#define DISK_FILE_BUFFER_SIZE_DEFAULT 512
+#define DISK_FILE_BUFFER_SIZE_MIN 512
+#define DISK_FILE_BUFFER_SIZE_MAX 0x10000UL
+
 /**
  * @brief Opens the filesystem file for read/write.
  *
@@ -28,6 +32,19 @@ typedef enum tDiskFileMode {
  */
 tFile *diskFileOpen(const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupted);
 
+/**
+ * @brief Same as diskFileOpen(), but with custom buffer size. Bigger buffer
+ * means fewer OS calls when doing many small reads/writes or short seeks.
+ * Reads at least as big as the buffer bypass it, going straight to dest.
+ *
+ * @param ulBufferSize Buffer size, from DISK_FILE_BUFFER_SIZE_MIN
+ * to DISK_FILE_BUFFER_SIZE_MAX. Allocated in FAST mem.
+ */
+tFile *diskFileOpenBuffered(
+	const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupted,
+	ULONG ulBufferSize
+);
+
 /**
  * @brief Check whether file at given path exists and is not a directory.
  *
@@ -57,8 +57,52 @@ typedef struct _tTextBitMap {
 	tBitMap *pBitMap;    ///< Word-aligned bitmap buffer with pre-drawn text.
 	UWORD uwActualWidth; ///< Actual text width for precise blitting.
 	UWORD uwActualHeight; ///< Actual text height for precise blitting.
+	// Optional interleaved buffers, see fontCreateTextBitMapInterleaved()
+	tBitMap *pColorBitMap; ///< Text on bitplanes set in ubColorCached, zeros elsewhere.
+	tBitMap *pMaskBitMap; ///< Text on all bitplanes.
+	UBYTE ubColorCached; ///< Color of text in pColorBitMap, if valid.
+	UBYTE isColorValid; ///< Set if pColorBitMap matches current text.
+	UBYTE isMaskValid; ///< Set if pMaskBitMap matches current text.
 } tTextBitMap;
 
+#define FONT_TEXT_CACHE_SLOTS 2
+
+/**
+ * @brief Text contents and glyph positions, as used by tTextCache.
+ */
+typedef struct _tTextCacheState {
+	char *pChars;     ///< Glyphs of the text, not null-terminated.
+	UWORD *pGlyphX;   ///< Glyph positions, last entry being total text width.
+	UBYTE ubLength;   ///< Glyph count.
+} tTextCacheState;
+
+typedef struct _tTextCacheSlot {
+	const tBitMap *pDest; ///< Bitmap on which text was drawn, zero if none.
+	UWORD uwX;
+	UWORD uwY;
+	UBYTE ubColor;
+	tTextCacheState sState; ///< Text drawn last time on pDest.
+} tTextCacheSlot;
+
+/**
+ * @brief Single-line text which is often changed only partially, like score,
+ * timer or ammo counters.
+ * Only the glyphs which have changed since the previous text are re-rendered
+ * and re-blitted, so changing single digit takes just a small blit.
+ * Each of last FONT_TEXT_CACHE_SLOTS destination bitmaps remembers its own
+ * last drawn text, so that double-buffered screens converge on both buffers.
+ */
+typedef struct _tTextCache {
+	const tFont *pFont;
+	tTextBitMap *pTextBitMap; ///< Rendered current text.
+	tTextCacheState sCurr; ///< Text currently rendered in pTextBitMap.
+	tTextCacheState sNext; ///< Scratch for the text being filled.
+	tTextCacheSlot pSlots[FONT_TEXT_CACHE_SLOTS];
+	UBYTE *pStateData; ///< Storage of all states' chars and positions.
+	UBYTE ubMaxLength;
+	UBYTE ubNextSlot; ///< Slot to be reused for the next unknown destination.
+} tTextCache;
+
 /* Globals */
 
 /* Functions */
@@ -115,6 +159,32 @@ tUwCoordYX fontDrawStr1bpp(
 
 tTextBitMap *fontCreateTextBitMap(UWORD uwWidth, UWORD uwHeight);
 
+/**
+ * @brief Creates text bitmap which can be drawn on interleaved bitmaps
+ * of given depth using single blit, instead of one blit per bitplane.
+ *
+ * Apart from regular 1bpp buffer, it allocates two interleaved buffers with
+ * text spread on all bitplanes and only on ones used by the text color.
+ * They are refreshed lazily on first draw after text or color change,
+ * which costs one small blit per bitplane, so this pays off for text which
+ * is redrawn more often than it is changed, e.g. on double-buffered HUDs.
+ *
+ * Drawing on non-interleaved bitmaps or ones with different depth falls back
+ * to regular per-bitplane drawing.
+ *
+ * @param uwWidth Buffer width, in pixels.
+ * @param uwHeight Buffer height, in pixels.
+ * @param ubDepth Depth of interleaved bitmaps on which text will be drawn.
+ * @return Newly-created text bitmap pointer on success, otherwise zero.
+ *
+ * @see fontCreateTextBitMap()
+ * @see fontDrawTextBitMap()
+ * @see fontDestroyTextBitMap()
+ */
+tTextBitMap *fontCreateTextBitMapInterleaved(
+	UWORD uwWidth, UWORD uwHeight, UBYTE ubDepth
+);
+
 /**
  *  @brief Creates text bitmap with specified font, containing given text.
  *  Treat as cache - allows faster reblit of text without need
@@ -215,6 +285,57 @@ void fontDrawStr(
 	const char *szText, UBYTE ubColor, UBYTE ubFlags, tTextBitMap *pTextBitMap
 );
 
+/**
+ * @brief Creates text cache for partially updated single-line text.
+ *
+ * @param pFont Font to be used for text rendering.
+ * @param uwWidth Max text width, in pixels.
+ * @param ubMaxLength Max text length, in chars.
+ * @return Newly-created text cache pointer on success, otherwise zero.
+ *
+ * @see fontFillTextCache()
+ * @see fontDrawTextCache()
+ * @see fontDestroyTextCache()
+ */
+tTextCache *fontCreateTextCache(
+	const tFont *pFont, UWORD uwWidth, UBYTE ubMaxLength
+);
+
+/**
+ * @brief Destroys specified text cache.
+ *
+ * @param pCache Text cache to be destroyed.
+ */
+void fontDestroyTextCache(tTextCache *pCache);
+
+/**
+ * @brief Sets new text of the cache, re-rendering only the glyphs which
+ * differ from the previous one.
+ *
+ * @param pCache Text cache to be updated.
+ * @param szText New single-line text.
+ */
+void fontFillTextCache(tTextCache *pCache, const char *szText);
+
+/**
+ * @brief Draws the text cache on given bitmap, blitting only the span
+ * which differs from what was drawn there last time.
+ *
+ * Text is drawn opaquely, using color 0 for background, so that changed
+ * glyphs overwrite the old ones. If position or color differs from last draw
+ * on given bitmap, or bitmap wasn't drawn on recently, whole text is redrawn.
+ * Text previously drawn at other position isn't erased.
+ *
+ * @param pCache Text cache to be drawn.
+ * @param pDest Destination bitmap.
+ * @param uwX X position on destination bitmap.
+ * @param uwY Y position on destination bitmap.
+ * @param ubColor Desired text color.
+ */
+void fontDrawTextCache(
+	tTextCache *pCache, tBitMap *pDest, UWORD uwX, UWORD uwY, UBYTE ubColor
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,57 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _ACE_UTILS_MEM_FILE_H_
+#define _ACE_UTILS_MEM_FILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "file.h"
+
+#if !defined(ACE_FILE_USE_ONLY_DISK)
+
+/**
+ * @brief Opens the memory buffer as a read-only file, e.g. preloaded pak blob
+ * or a RAM image. All fd-based loaders can then parse it without OS calls.
+ *
+ * The buffer isn't copied nor freed on fileClose(), so it must outlive
+ * the returned file handle.
+ *
+ * @param pData Pointer to file contents.
+ * @param ulSize Size of file contents, in bytes.
+ * @return File handle on success, zero on failure.
+ */
+tFile *memFileOpen(const void *pData, ULONG ulSize);
+
+/**
+ * @brief Returns pointer to next ulSize bytes of the file and advances
+ * its position past them, allowing loaders to skip copying the data.
+ *
+ * Data is returned as is, so it's in file's endianness and alignment.
+ * Returned pointer is valid as long as the underlying buffer is.
+ *
+ * @param pFile File handle. May be of any type - only memory files are
+ * supported, though.
+ * @param ulSize Number of bytes to be taken.
+ * @param ulMemType MEMF_CHIP if data must reside in CHIP mem, MEMF_ANY if
+ * it may reside in any mem.
+ * @return Pointer to data on success. Zero if file isn't a memory file,
+ * has less than ulSize bytes remaining or its buffer is in wrong mem type -
+ * in that case the position isn't changed and data should be read as usual.
+ */
+const void *memFileTakePtr(tFile *pFile, ULONG ulSize, ULONG ulMemType);
+
+#else
+
+#define memFileTakePtr(pFile, ulSize, ulMemType) ((const void*)0)
+
+#endif // !defined(ACE_FILE_USE_ONLY_DISK)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _ACE_UTILS_MEM_FILE_H_
@@ -14,20 +14,113 @@ extern "C" {
 
 #if !defined(ACE_FILE_USE_ONLY_DISK)
 
+/**
+ * @brief Value of first header word which denotes that it's followed by
+ * flags and actual file count. Older pak files start directly with file count.
+ */
+#define PAK_FILE_HEADER_EXTENDED 0xFFFF
+
+/**
+ * @brief Compressed entries are split into independently packed segments
+ * of ulRestartInterval unpacked bytes, allowing fast seeks.
+ */
+#define PAK_FILE_FLAG_RESTART_POINTS 1
+
+/**
+ * @brief Entries are sorted by ascending path hash, allowing binary search.
+ */
+#define PAK_FILE_FLAG_SORTED_BY_HASH 2
+
+/**
+ * @brief Each index entry is followed by UWORD codec id. Without this flag,
+ * entries with data size different than uncompressed one use
+ * PAK_FILE_CODEC_LZSS.
+ */
+#define PAK_FILE_FLAG_ENTRY_CODECS 4
+
+#define PAK_FILE_CODEC_NONE 0
+/**
+ * @brief Bit-flagged literals and matches within 4 KiB window.
+ */
+#define PAK_FILE_CODEC_LZSS 1
+/**
+ * @brief Byte-aligned literal runs and matches in blocks of 4 KiB, each
+ * prefixed with its packed size. Compresses a bit worse than LZSS, but decodes
+ * several times faster.
+ */
+#define PAK_FILE_CODEC_LZ_FAST 2
+
+/**
+ * @brief First long of access trace file, see pakFileTraceBegin().
+ */
+#define PAK_FILE_TRACE_MAGIC 0x50414B54 // "PAKT"
+
+/**
+ * @brief Max path length accepted by PAK_HASH().
+ */
+#define PAK_HASH_MAX_PATH_LENGTH 64
+
+// Helpers for PAK_HASH() - sums bytes of string literal, optionally weighted
+// by their distance from the end, which is closed form of adler32.
+#define _PAK_HASH_LEN(s) (sizeof(s) - 1)
+#define _PAK_HASH_CHR(s, i) ((i) < _PAK_HASH_LEN(s) ? \
+	(ULONG)(UBYTE)(s)[(i) < _PAK_HASH_LEN(s) ? (i) : 0] : 0)
+#define _PAK_HASH_WCHR(s, i) (_PAK_HASH_CHR(s, i) * (ULONG)(_PAK_HASH_LEN(s) - (i)))
+#define _PAK_HASH_SUM8(m, s, i) ( \
+	m(s, (i) + 0) + m(s, (i) + 1) + m(s, (i) + 2) + m(s, (i) + 3) + \
+	m(s, (i) + 4) + m(s, (i) + 5) + m(s, (i) + 6) + m(s, (i) + 7) \
+)
+#define _PAK_HASH_SUM64(m, s) ( \
+	_PAK_HASH_SUM8(m, s, 0) + _PAK_HASH_SUM8(m, s, 8) + \
+	_PAK_HASH_SUM8(m, s, 16) + _PAK_HASH_SUM8(m, s, 24) + \
+	_PAK_HASH_SUM8(m, s, 32) + _PAK_HASH_SUM8(m, s, 40) + \
+	_PAK_HASH_SUM8(m, s, 48) + _PAK_HASH_SUM8(m, s, 56) \
+)
+
+/**
+ * @brief Calculates path hash of string literal at compile time.
+ * Result is the same as of pakFileGetPathHash(), so it can be passed directly
+ * to pakFileGetFileByHash() without hashing the path on each lookup.
+ * Fails to compile if path is longer than PAK_HASH_MAX_PATH_LENGTH.
+ *
+ * @param szPath String literal with path inside pak file.
+ */
+#define PAK_HASH(szPath) ( \
+	0 * sizeof(char[_PAK_HASH_LEN(szPath) <= PAK_HASH_MAX_PATH_LENGTH ? 1 : -1]) + ( \
+		(((_PAK_HASH_LEN(szPath) + _PAK_HASH_SUM64(_PAK_HASH_WCHR, szPath)) % 65521) << 16) | \
+		((1 + _PAK_HASH_SUM64(_PAK_HASH_CHR, szPath)) % 65521) \
+	) \
+)
+
 typedef struct tPakFileEntry {
-	ULONG ulOffs;
+	ULONG ulOffs; ///< May be shared between entries with identical contents.
 	ULONG ulSizeUncompressed;
 	ULONG ulSizeData;
 	ULONG ulPathChecksum; // adler32
+	UBYTE ubCodec; ///< One of PAK_FILE_CODEC_* values.
 } tPakFileEntry;
 
 typedef struct tPakFile {
 	tFile *pFile;
 	void *pPrevReadSubfile;
 	UWORD uwFileCount;
+	UWORD uwFlags;
+	ULONG ulRestartInterval;
 	tPakFileEntry *pEntries;
+	tFile *pTraceFile; ///< Access trace destination, 0 if not tracing.
 } tPakFile;
 
+/**
+ * @brief State of subfile being loaded in background, see pakFilePrefetch().
+ */
+typedef struct tPakFilePrefetch {
+	tFile *pFile; ///< Closed as soon as the whole subfile is loaded.
+	UBYTE *pDest;
+	ULONG ulSize;
+	ULONG ulLoaded;
+	UBYTE isError;
+} tPakFilePrefetch;
+
 tPakFile *pakFileOpen(const char *szPath, UBYTE isUninterrupted);
 
 void pakFileClose(tPakFile *pPakFile);
@@ -40,6 +133,66 @@ tFile *pakFileGetFileByIndex(tPakFile *pPakFile, UWORD uwIndex);
 
 ULONG pakFileGetPathHash(const char *szPath);
 
+/**
+ * @brief Starts recording subfile accesses to given file, so that they can be
+ * turned into pak_tool order file with its -order mode.
+ * After PAK_FILE_TRACE_MAGIC, each closed subfile appends a record of three
+ * ULONGs: path hash, timerGet() at the time it was opened and number of bytes
+ * read from pak file.
+ *
+ * @param pPakFile Pak file to be traced.
+ * @param szTracePath Path of trace file to be created.
+ */
+void pakFileTraceBegin(tPakFile *pPakFile, const char *szTracePath);
+
+/**
+ * @brief Stops recording subfile accesses, closing the trace file.
+ * Called automatically by pakFileClose().
+ */
+void pakFileTraceEnd(tPakFile *pPakFile);
+
+/**
+ * @brief Returns uncompressed size of subfile with given path hash,
+ * e.g. for allocating the buffer for pakFilePrefetch().
+ *
+ * @return Size of subfile or 0 if it doesn't exist.
+ */
+ULONG pakFileGetFileSizeByHash(const tPakFile *pPakFile, ULONG ulPathHash);
+
+/**
+ * @brief Starts loading subfile with given path hash into pDest without
+ * blocking. Actual reading and unpacking is done in chunks by
+ * pakFilePrefetchProcess(), which should be called once per frame.
+ *
+ * @param pPakFile Pak file containing the subfile.
+ * @param ulPathHash Path hash of the subfile.
+ * @param pDest Buffer at least pakFileGetFileSizeByHash() bytes long.
+ * It must be kept valid until prefetch is finished or destroyed.
+ * @return Prefetch state, or 0 if there's no such subfile.
+ *
+ * @see pakFilePrefetchProcess()
+ * @see pakFilePrefetchDestroy()
+ */
+tPakFilePrefetch *pakFilePrefetch(tPakFile *pPakFile, ULONG ulPathHash, void *pDest);
+
+/**
+ * @brief Loads next chunks of prefetched subfile until given time budget is
+ * spent. At least one chunk is processed on each call, so a single chunk read
+ * which goes through the OS may take longer than the budget.
+ * Requires timer manager to be created.
+ *
+ * @param pPrefetch Prefetch state created with pakFilePrefetch().
+ * @param ulBudgetUs Time budget in microseconds.
+ * @return 1 if loading is finished or has failed (see isError), otherwise 0.
+ */
+UBYTE pakFilePrefetchProcess(tPakFilePrefetch *pPrefetch, ULONG ulBudgetUs);
+
+/**
+ * @brief Frees prefetch state. May be called before loading is finished,
+ * leaving the rest of the buffer unfilled.
+ */
+void pakFilePrefetchDestroy(tPakFilePrefetch *pPrefetch);
+
 #endif
 
 #ifdef __cplusplus
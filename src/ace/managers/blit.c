@@ -121,28 +121,26 @@ UBYTE blitIsIdle(void) {
 	return 1;
 }
 
-UBYTE blitUnsafeCopy(
-	const tBitMap *pSrc, WORD wSrcX, WORD wSrcY,
-	tBitMap *pDst, WORD wDstX, WORD wDstY, WORD wWidth, WORD wHeight,
-	UBYTE ubMinterm
+static void blitPassInit(
+	tBlitPass *pPass, const tBitMap *pSrc, WORD wSrcX, WORD wSrcY,
+	const tBitMap *pDst, UBYTE ubDstPhase, WORD wWidth, WORD wHeight,
+	UBYTE ubMinterm, UBYTE isMasked, UBYTE isBlitInterleaved
 ) {
 	// Helper vars
 	UWORD uwBlitWords, uwBlitWidth;
-	ULONG ulSrcOffs, ulDstOffs;
 	UBYTE ubShift, ubSrcDelta, ubDstDelta, ubWidthDelta, ubMaskFShift, ubMaskLShift;
-	// Blitter register values
-	UWORD uwBltCon0, uwBltCon1, uwFirstMask, uwLastMask;
-	WORD wSrcModulo, wDstModulo;
+	UWORD uwBltCon1, uwFirstMask, uwLastMask;
 
 	ubSrcDelta = wSrcX & 0xF;
-	ubDstDelta = wDstX & 0xF;
+	ubDstDelta = ubDstPhase & 0xF;
 	ubWidthDelta = (ubSrcDelta + wWidth) & 0xF;
-	UBYTE isBlitInterleaved = (
-		bitmapIsInterleaved(pSrc) && bitmapIsInterleaved(pDst) &&
-		pSrc->Depth == pDst->Depth
-	);
+	// Source fits in one word less than destination, so first & last word
+	// masks in source space can't cover it for blits wider than 2 words.
+	// Masked ones are split by blitPlanInit(), so they're never that wide here.
+	UBYTE isSrcShorter = ((wWidth+ubDstDelta+15) & 0xFFF0)-(wWidth+ubSrcDelta) > 16;
+	UBYTE ubMaskShift;
 
-	if(ubSrcDelta > ubDstDelta || ((wWidth+ubDstDelta+15) & 0xFFF0)-(wWidth+ubSrcDelta) > 16) {
+	if(ubSrcDelta > ubDstDelta || (isSrcShorter && isMasked)) {
 		uwBlitWidth = (wWidth+(ubSrcDelta>ubDstDelta?ubSrcDelta:ubDstDelta)+15) & 0xFFF0;
 		uwBlitWords = uwBlitWidth >> 4;
 
@@ -155,94 +153,197 @@ UBYTE blitUnsafeCopy(
 		}
 
 		ubShift = uwBlitWidth - (ubDstDelta+wWidth+ubMaskFShift);
+		ubMaskShift = ubShift;
 		uwBltCon1 = (ubShift << BSHIFTSHIFT) | BLITREVERSE;
 
 		// Position on the end of last row of the bitmap.
 		// For interleaved, position on the last row of last bitplane.
+		// Dest offset is relative to word containing the top-left pixel.
 		if(isBlitInterleaved) {
 			// TODO: fix duplicating bitmapIsInterleaved() check inside bitmapGetByteWidth()
-			ulSrcOffs = pSrc->BytesPerRow * (wSrcY + wHeight) - bitmapGetByteWidth(pSrc) + ((wSrcX + wWidth + ubMaskFShift - 1) / 16) * 2;
-			ulDstOffs = pDst->BytesPerRow * (wDstY + wHeight) - bitmapGetByteWidth(pDst) + ((wDstX + wWidth + ubMaskFShift - 1) / 16) * 2;
+			pPass->ulSrcOffs = pSrc->BytesPerRow * (wSrcY + wHeight) - bitmapGetByteWidth(pSrc) + ((wSrcX + wWidth + ubMaskFShift - 1) / 16) * 2;
+			pPass->lDstOffs = pDst->BytesPerRow * wHeight - bitmapGetByteWidth(pDst) + ((ubDstDelta + wWidth + ubMaskFShift - 1) / 16) * 2;
 		}
 		else {
-			ulSrcOffs = pSrc->BytesPerRow * (wSrcY + wHeight - 1) + ((wSrcX + wWidth + ubMaskFShift - 1) / 16) * 2;
-			ulDstOffs = pDst->BytesPerRow * (wDstY + wHeight - 1) + ((wDstX + wWidth + ubMaskFShift - 1) / 16) * 2;
+			pPass->ulSrcOffs = pSrc->BytesPerRow * (wSrcY + wHeight - 1) + ((wSrcX + wWidth + ubMaskFShift - 1) / 16) * 2;
+			pPass->lDstOffs = pDst->BytesPerRow * (wHeight - 1) + ((ubDstDelta + wWidth + ubMaskFShift - 1) / 16) * 2;
 		}
 	}
 	else {
 		uwBlitWidth = (wWidth+ubDstDelta+15) & 0xFFF0;
 		uwBlitWords = uwBlitWidth >> 4;
 
-		ubMaskFShift = ubSrcDelta;
-		ubMaskLShift = uwBlitWidth-(wWidth+ubSrcDelta);
+		ubShift = ubDstDelta-ubSrcDelta;
+		uwBltCon1 = ubShift << BSHIFTSHIFT;
+
+		if(isSrcShorter) {
+			// Without mask channel A is constant, so it can stay unshifted
+			// and masks may be set in destination space instead.
+			ubMaskShift = 0;
+			ubMaskFShift = ubDstDelta;
+			ubMaskLShift = uwBlitWidth-(wWidth+ubDstDelta);
+		}
+		else {
+			ubMaskShift = ubShift;
+			ubMaskFShift = ubSrcDelta;
+			ubMaskLShift = uwBlitWidth-(wWidth+ubSrcDelta);
+		}
 
 		uwFirstMask = 0xFFFF >> ubMaskFShift;
 		uwLastMask = 0xFFFF << ubMaskLShift;
 
-		ubShift = ubDstDelta-ubSrcDelta;
-		uwBltCon1 = ubShift << BSHIFTSHIFT;
-
-		ulSrcOffs = pSrc->BytesPerRow * wSrcY + (wSrcX >> 3);
-		ulDstOffs = pDst->BytesPerRow * wDstY + (wDstX >> 3);
+		pPass->ulSrcOffs = pSrc->BytesPerRow * wSrcY + (wSrcX >> 3);
+		pPass->lDstOffs = ubDstDelta >> 3;
 	}
 
-	uwBltCon0 = (ubShift << ASHIFTSHIFT) | USEB|USEC|USED | ubMinterm;
+	pPass->uwBltCon0 = (ubMaskShift << ASHIFTSHIFT) | USEB|USEC|USED | ubMinterm;
+	if(isMasked) {
+		pPass->uwBltCon0 |= USEA;
+	}
+	pPass->uwBltCon1 = uwBltCon1;
+	pPass->uwFirstMask = uwFirstMask;
+	pPass->uwLastMask = uwLastMask;
+	pPass->uwBlitWords = uwBlitWords;
 
 	if(isBlitInterleaved) {
-		wHeight *= pSrc->Depth;
-		wSrcModulo = bitmapGetByteWidth(pSrc) - uwBlitWords * 2;
-		wDstModulo = bitmapGetByteWidth(pDst) - uwBlitWords * 2;
+		pPass->wSrcModulo = bitmapGetByteWidth(pSrc) - uwBlitWords * 2;
+		pPass->wDstModulo = bitmapGetByteWidth(pDst) - uwBlitWords * 2;
+	}
+	else {
+		pPass->wSrcModulo = pSrc->BytesPerRow - uwBlitWords * 2;
+		pPass->wDstModulo = pDst->BytesPerRow - uwBlitWords * 2;
+	}
+}
 
-		blitWait(); // Don't modify registers when other blit is in progress
-		g_pCustom->bltcon0 = uwBltCon0;
-		g_pCustom->bltcon1 = uwBltCon1;
-		g_pCustom->bltafwm = uwFirstMask;
-		g_pCustom->bltalwm = uwLastMask;
-		g_pCustom->bltbmod = wSrcModulo;
-		g_pCustom->bltcmod = wDstModulo;
-		g_pCustom->bltdmod = wDstModulo;
-		g_pCustom->bltadat = 0xFFFF;
-		g_pCustom->bltbpt = &pSrc->Planes[0][ulSrcOffs];
-		g_pCustom->bltcpt = &pDst->Planes[0][ulDstOffs];
-		g_pCustom->bltdpt = &pDst->Planes[0][ulDstOffs];
-#if defined(ACE_USE_ECS_FEATURES)
-		g_pCustom->bltsizv = wHeight;
-		g_pCustom->bltsizh = uwBlitWords;
-#else
-		g_pCustom->bltsize = (wHeight << HSIZEBITS) | uwBlitWords;
+void blitPlanInit(
+	tBlitPlan *pPlan, const tBitMap *pSrc, WORD wSrcX, WORD wSrcY,
+	const tBitMap *pDst, UBYTE ubDstPhase, WORD wWidth, WORD wHeight,
+	UBYTE ubMinterm, const UBYTE *pMsk
+) {
+	UBYTE ubSrcDelta = wSrcX & 0xF;
+	UBYTE ubDstDelta = ubDstPhase & 0xF;
+	UBYTE isBlitInterleaved = (
+		bitmapIsInterleaved(pSrc) && bitmapIsInterleaved(pDst) &&
+		pSrc->Depth == pDst->Depth
+	);
+	UWORD uwDstWords = (wWidth + ubDstDelta + 15) >> 4;
+	UBYTE isSrcShorter = (uwDstWords << 4) - (wWidth + ubSrcDelta) > 16;
+
+	if(pMsk && isSrcShorter && uwDstWords > 2) {
+		// Last source word is shifted into last two destination words, so
+		// the first pass ends on the word boundary, taking only its part.
+		// The rest is a 1-word blit, with both source ends in a single word.
+		WORD wTailWidth = ((wWidth + ubDstDelta - 1) & 0xF) + 1;
+		WORD wMainWidth = wWidth - wTailWidth;
+		blitPassInit(
+			&pPlan->pPasses[0], pSrc, wSrcX, wSrcY, pDst, ubDstDelta,
+			wMainWidth, wHeight, ubMinterm, 1, isBlitInterleaved
+		);
+		blitPassInit(
+			&pPlan->pPasses[1], pSrc, wSrcX + wMainWidth, wSrcY, pDst, 0,
+			wTailWidth, wHeight, ubMinterm, 1, isBlitInterleaved
+		);
+		pPlan->pPasses[1].lDstOffs += (uwDstWords - 1) * 2;
+	}
+	else {
+		blitPassInit(
+			&pPlan->pPasses[0], pSrc, wSrcX, wSrcY, pDst, ubDstDelta,
+			wWidth, wHeight, ubMinterm, pMsk != 0, isBlitInterleaved
+		);
+		pPlan->pPasses[1].uwBltCon0 = 0;
+		pPlan->pPasses[1].uwBlitWords = 0;
+	}
+
+	pPlan->pSrc = pSrc;
+	pPlan->pMsk = pMsk;
+	pPlan->isInterleaved = isBlitInterleaved;
+	pPlan->ubDstPhase = ubDstDelta;
+#if defined(ACE_DEBUG)
+	pPlan->uwDstBytesPerRow = pDst->BytesPerRow;
 #endif
+
+	if(isBlitInterleaved) {
+		pPlan->uwBlitHeight = wHeight * pSrc->Depth;
+		pPlan->ubPlaneCount = 1;
 	}
 	else {
-		wSrcModulo = pSrc->BytesPerRow - uwBlitWords * 2;
-		wDstModulo = pDst->BytesPerRow - uwBlitWords * 2;
-		UBYTE ubPlane = MIN(pSrc->Depth, pDst->Depth);
+		pPlan->uwBlitHeight = wHeight;
+		pPlan->ubPlaneCount = MIN(pSrc->Depth, pDst->Depth);
+	}
+}
+
+void blitPlanExecute(
+	const tBlitPlan *pPlan, tBitMap *pDst, WORD wDstX, WORD wDstY
+) {
+#if defined(ACE_DEBUG)
+	if((wDstX & 0xF) != pPlan->ubDstPhase) {
+		logWrite(
+			"ERR: Blit plan made for X phase %hhu, got %hd\n",
+			pPlan->ubDstPhase, wDstX
+		);
+	}
+	if(pDst->BytesPerRow != pPlan->uwDstBytesPerRow) {
+		logWrite(
+			"ERR: Blit plan made for BytesPerRow %hu, got %hu\n",
+			pPlan->uwDstBytesPerRow, pDst->BytesPerRow
+		);
+	}
+#endif
+	const tBitMap *pSrc = pPlan->pSrc;
+	ULONG ulDstPos = pDst->BytesPerRow * wDstY + ((wDstX >> 4) << 1);
+
+	for(UBYTE ubPass = 0; ubPass < 2 && pPlan->pPasses[ubPass].uwBlitWords; ++ubPass) {
+		const tBlitPass *pPass = &pPlan->pPasses[ubPass];
+		ULONG ulSrcOffs = pPass->ulSrcOffs;
+		ULONG ulDstOffs = ulDstPos + pPass->lDstOffs;
+		UBYTE ubPlane = pPlan->ubPlaneCount;
 
 		blitWait(); // Don't modify registers when other blit is in progress
-		g_pCustom->bltcon0 = uwBltCon0;
-		g_pCustom->bltcon1 = uwBltCon1;
-		g_pCustom->bltafwm = uwFirstMask;
-		g_pCustom->bltalwm = uwLastMask;
-		g_pCustom->bltbmod = wSrcModulo;
-		g_pCustom->bltcmod = wDstModulo;
-		g_pCustom->bltdmod = wDstModulo;
-		g_pCustom->bltadat = 0xFFFF;
+		g_pCustom->bltcon0 = pPass->uwBltCon0;
+		g_pCustom->bltcon1 = pPass->uwBltCon1;
+		g_pCustom->bltafwm = pPass->uwFirstMask;
+		g_pCustom->bltalwm = pPass->uwLastMask;
+		g_pCustom->bltbmod = pPass->wSrcModulo;
+		g_pCustom->bltcmod = pPass->wDstModulo;
+		g_pCustom->bltdmod = pPass->wDstModulo;
+		if(pPlan->pMsk) {
+			g_pCustom->bltamod = pPass->wSrcModulo;
+		}
+		else {
+			g_pCustom->bltadat = 0xFFFF;
+		}
 #if defined(ACE_USE_ECS_FEATURES)
-		g_pCustom->bltsizv = wHeight;
+		g_pCustom->bltsizv = pPlan->uwBlitHeight;
 #endif
 		while(ubPlane--) {
 			blitWait();
 			// This hell of a casting must stay here or else large offsets get bugged!
+			if(pPlan->pMsk) {
+				g_pCustom->bltapt = (APTR)&pPlan->pMsk[ulSrcOffs];
+			}
 			g_pCustom->bltbpt = &pSrc->Planes[ubPlane][ulSrcOffs];
 			g_pCustom->bltcpt = &pDst->Planes[ubPlane][ulDstOffs];
 			g_pCustom->bltdpt = &pDst->Planes[ubPlane][ulDstOffs];
 #if defined(ACE_USE_ECS_FEATURES)
-			g_pCustom->bltsizh = uwBlitWords;
+			g_pCustom->bltsizh = pPass->uwBlitWords;
 #else
-			g_pCustom->bltsize = (wHeight << HSIZEBITS) | uwBlitWords;
+			g_pCustom->bltsize = (pPlan->uwBlitHeight << HSIZEBITS) | pPass->uwBlitWords;
 #endif
 		}
 	}
+}
 
+UBYTE blitUnsafeCopy(
+	const tBitMap *pSrc, WORD wSrcX, WORD wSrcY,
+	tBitMap *pDst, WORD wDstX, WORD wDstY, WORD wWidth, WORD wHeight,
+	UBYTE ubMinterm
+) {
+	tBlitPlan sPlan;
+	blitPlanInit(
+		&sPlan, pSrc, wSrcX, wSrcY, pDst, wDstX & 0xF, wWidth, wHeight,
+		ubMinterm, 0
+	);
+	blitPlanExecute(&sPlan, pDst, wDstX, wDstY);
 	return 1;
 }
 
@@ -362,126 +463,12 @@ UBYTE blitUnsafeCopyMask(
 	tBitMap *pDst, WORD wDstX, WORD wDstY,
 	WORD wWidth, WORD wHeight, const UBYTE *pMsk
 ) {
-	// Helper vars
-	UWORD uwBlitWords, uwBlitWidth;
-	ULONG ulSrcOffs, ulDstOffs;
-	UBYTE ubShift, ubSrcDelta, ubDstDelta, ubWidthDelta, ubMaskFShift, ubMaskLShift;
-	// Blitter register values
-	UWORD uwBltCon0, uwBltCon1, uwFirstMask, uwLastMask;
-	WORD wSrcModulo, wDstModulo;
-
-	ubSrcDelta = wSrcX & 0xF;
-	ubDstDelta = wDstX & 0xF;
-	ubWidthDelta = (ubSrcDelta + wWidth) & 0xF;
-	UBYTE isBlitInterleaved = (
-		bitmapIsInterleaved(pSrc) && bitmapIsInterleaved(pDst) &&
-		pSrc->Depth == pDst->Depth
+	tBlitPlan sPlan;
+	blitPlanInit(
+		&sPlan, pSrc, wSrcX, wSrcY, pDst, wDstX & 0xF, wWidth, wHeight,
+		MINTERM_COOKIE, pMsk
 	);
-
-	if(ubSrcDelta > ubDstDelta || ((wWidth+ubDstDelta+15) & 0xFFF0)-(wWidth+ubSrcDelta) > 16) {
-		uwBlitWidth = (wWidth+(ubSrcDelta>ubDstDelta?ubSrcDelta:ubDstDelta)+15) & 0xFFF0;
-		uwBlitWords = uwBlitWidth >> 4;
-
-		ubMaskFShift = ((ubWidthDelta+15)&0xF0)-ubWidthDelta;
-		ubMaskLShift = uwBlitWidth - (wWidth+ubMaskFShift);
-
-		// Position on the end of last row of the bitmap.
-		// For interleaved, position on the last row of last bitplane.
-		if(isBlitInterleaved) {
-			// TODO: fix duplicating bitmapIsInterleaved() check inside bitmapGetByteWidth()
-			ulSrcOffs = pSrc->BytesPerRow * (wSrcY + wHeight) - bitmapGetByteWidth(pSrc) + ((wSrcX + wWidth + ubMaskFShift - 1) / 16) * 2;
-			ulDstOffs = pDst->BytesPerRow * (wDstY + wHeight) - bitmapGetByteWidth(pDst) + ((wDstX + wWidth + ubMaskFShift - 1) / 16) * 2;
-		}
-		else {
-			ulSrcOffs = pSrc->BytesPerRow * (wSrcY + wHeight - 1) + ((wSrcX + wWidth + ubMaskFShift - 1) / 16) * 2;
-			ulDstOffs = pDst->BytesPerRow * (wDstY + wHeight - 1) + ((wDstX + wWidth + ubMaskFShift - 1) / 16) * 2;
-		}
-
-		uwFirstMask = 0xFFFF << ubMaskFShift;
-		uwLastMask = 0xFFFF >> ubMaskLShift;
-		if(ubMaskLShift > 16) { // Fix for 2-word blits
-			uwFirstMask &= 0xFFFF >> (ubMaskLShift-16);
-		}
-
-		ubShift = uwBlitWidth - (ubDstDelta+wWidth+ubMaskFShift);
-		uwBltCon1 = (ubShift << BSHIFTSHIFT) | BLITREVERSE;
-	}
-	else {
-		uwBlitWidth = (wWidth+ubDstDelta+15) & 0xFFF0;
-		uwBlitWords = uwBlitWidth >> 4;
-
-		ubMaskFShift = ubSrcDelta;
-		ubMaskLShift = uwBlitWidth-(wWidth+ubSrcDelta);
-
-		uwFirstMask = 0xFFFF >> ubMaskFShift;
-		uwLastMask = 0xFFFF << ubMaskLShift;
-
-		ubShift = ubDstDelta-ubSrcDelta;
-		uwBltCon1 = ubShift << BSHIFTSHIFT;
-
-		ulSrcOffs = pSrc->BytesPerRow * wSrcY + (wSrcX >> 3);
-		ulDstOffs = pDst->BytesPerRow * wDstY + (wDstX >> 3);
-	}
-
-	 uwBltCon0 = uwBltCon1 |USEA|USEB|USEC|USED | MINTERM_COOKIE;
-
-	if(isBlitInterleaved) {
-		wHeight *= pSrc->Depth;
-		wSrcModulo = bitmapGetByteWidth(pSrc) - uwBlitWords * 2;
-		wDstModulo = bitmapGetByteWidth(pDst) - uwBlitWords * 2;
-
-		blitWait(); // Don't modify registers when other blit is in progress
-		g_pCustom->bltcon0 = uwBltCon0;
-		g_pCustom->bltcon1 = uwBltCon1;
-		g_pCustom->bltafwm = uwFirstMask;
-		g_pCustom->bltalwm = uwLastMask;
-		g_pCustom->bltamod = wSrcModulo;
-		g_pCustom->bltbmod = wSrcModulo;
-		g_pCustom->bltcmod = wDstModulo;
-		g_pCustom->bltdmod = wDstModulo;
-		g_pCustom->bltapt = (APTR)&pMsk[ulSrcOffs];
-		g_pCustom->bltbpt = &pSrc->Planes[0][ulSrcOffs];
-		g_pCustom->bltcpt = &pDst->Planes[0][ulDstOffs];
-		g_pCustom->bltdpt = &pDst->Planes[0][ulDstOffs];
-#if defined(ACE_USE_ECS_FEATURES)
-		g_pCustom->bltsizv = wHeight;
-		g_pCustom->bltsizh = uwBlitWords;
-#else
-		g_pCustom->bltsize = (wHeight << HSIZEBITS) | uwBlitWords;
-#endif
-	}
-	else {
-		wSrcModulo = pSrc->BytesPerRow - uwBlitWords * 2;
-		wDstModulo = pDst->BytesPerRow - uwBlitWords * 2;
-		UBYTE ubPlane = MIN(pSrc->Depth, pDst->Depth);
-
-		blitWait(); // Don't modify registers when other blit is in progress
-		g_pCustom->bltcon0 = uwBltCon0;
-		g_pCustom->bltcon1 = uwBltCon1;
-		g_pCustom->bltafwm = uwFirstMask;
-		g_pCustom->bltalwm = uwLastMask;
-		g_pCustom->bltamod = wSrcModulo;
-		g_pCustom->bltbmod = wSrcModulo;
-		g_pCustom->bltcmod = wDstModulo;
-		g_pCustom->bltdmod = wDstModulo;
-#if defined(ACE_USE_ECS_FEATURES)
-		g_pCustom->bltsizv = wHeight;
-#endif
-		while(ubPlane--) {
-			blitWait();
-			// This hell of a casting must stay here or else large offsets get bugged!
-			g_pCustom->bltapt = (APTR)&pMsk[ulSrcOffs];
-			g_pCustom->bltbpt = &pSrc->Planes[ubPlane][ulSrcOffs];
-			g_pCustom->bltcpt = &pDst->Planes[ubPlane][ulDstOffs];
-			g_pCustom->bltdpt = &pDst->Planes[ubPlane][ulDstOffs];
-#if defined(ACE_USE_ECS_FEATURES)
-			g_pCustom->bltsizh = uwBlitWords;
-#else
-			g_pCustom->bltsize = (wHeight << HSIZEBITS) | uwBlitWords;
-#endif
-		}
-	}
-
+	blitPlanExecute(&sPlan, pDst, wDstX, wDstY);
 	return 1;
 }
 
@@ -670,13 +657,15 @@ void blitLine(
 	g_pCustom->bltbmod = wDy + wDy;
 	g_pCustom->bltcmod = pDst->BytesPerRow;
 	g_pCustom->bltdmod = pDst->BytesPerRow;
-	g_pCustom->bltcon1 = uwBltCon1;
-	g_pCustom->bltapt = (APTR)(LONG)wDerr;
 	for(UBYTE ubPlane = 0; ubPlane != pDst->Depth; ++ubPlane) {
 		UBYTE *pFirstLineWord = pDst->Planes[ubPlane] + ulDataOffs;
 		UWORD uwOp = ((ubColor & BV(ubPlane)) ? BLIT_LINE_MODE_OR : BLIT_LINE_MODE_ERASE);
 
 		blitWait();
+		// Blitter leaves error accumulator and sign of the line's end in BLTAPTL
+		// and BLTCON1, so they need to be set up again for each bitplane.
+		g_pCustom->bltcon1 = uwBltCon1;
+		g_pCustom->bltapt = (APTR)(LONG)wDerr;
 		g_pCustom->bltcon0 = uwBltCon0 | uwOp;
 		g_pCustom->bltcpt = pFirstLineWord;
 		g_pCustom->bltdpt = (APTR)(isOneDot ? pDst->Planes[pDst->Depth] : pFirstLineWord);
@@ -732,7 +721,7 @@ void blitLinePlane(
 	UWORD uwBltCon0 = ror16(wX1 & 15, 4);
 	ULONG ulDataOffs = pDst->BytesPerRow * wY1 + ((wX1 / 8) & ~1);
 	UBYTE *pFirstLineWord = pDst->Planes[ubPlane] + ulDataOffs;
-	UBYTE *pD = (APTR)(isOneDot ? pDst->Planes[pDst->Depth] : pFirstLineWord);
+	UBYTE *pD = (UBYTE*)(isOneDot ? pDst->Planes[pDst->Depth] : pFirstLineWord);
 
 	blitWait(); // Don't modify registers when other blit is in progress
 	g_pCustom->bltafwm = -1;
@@ -17,6 +17,10 @@
 #define BOB_WRAP_Y
 #endif
 
+#if defined(ACE_BOB_MERGE_UNDRAW) && !defined(ACE_BOB_PRISTINE_BUFFER)
+#error "ACE_BOB_MERGE_UNDRAW requires ACE_BOB_PRISTINE_BUFFER"
+#endif
+
 #if defined(ACE_BOB_ALWAYS_ON_SCROLL_BUFFER)
 #define HEIGHT_MODULO(x, h) SCROLLBUFFER_HEIGHT_MODULO(x, h)
 #else
@@ -35,6 +39,15 @@ typedef struct tBobQueue {
 	UBYTE ubUndrawCount;
 } tBobQueue;
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+typedef struct tBobUndrawRect {
+	UWORD uwTop;
+	UWORD uwBottom; ///< Exclusive, unused for open restore rects.
+	UWORD uwWordStart;
+	UWORD uwWordEnd; ///< Exclusive.
+} tBobUndrawRect;
+#endif
+
 static UBYTE s_ubBufferCurr;
 static UBYTE s_ubMaxBobCount;
 
@@ -54,6 +67,19 @@ static UWORD s_uwBgBufferLength;
 static UBYTE s_ubBobsSaved;
 #endif
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+// Each bob may be split in two by Y-wrap
+#define BOB_UNDRAW_RECTS_PER_BOB 2
+static tBobUndrawRect *s_pUndrawRects; // Sorted by top edge
+static tBobUndrawRect **s_pUndrawActive; // Covering current band, sorted by left edge
+static tBobUndrawRect *s_pUndrawSpans[2]; // Restore rects open in prev & curr band
+static UWORD s_uwUndrawRectsMax;
+static tBobUndrawStats s_sUndrawStats;
+#endif
+
+// Marks bob's cached draw registers as outdated - no X phase is that big
+#define BOB_DRAW_PHASE_INVALID 0xFF
+
 tBobQueue s_pQueues[2];
 
 //------------------------------------------------------------------ PRIVATE FNS
@@ -85,6 +111,15 @@ static void bobDeallocBuffers(void) {
 		s_pQueues[1].pBobs = 0;
 	}
 	s_ubMaxBobCount = 0;
+#if defined(ACE_BOB_MERGE_UNDRAW)
+	if(s_uwUndrawRectsMax) {
+		memFree(s_pUndrawRects, sizeof(tBobUndrawRect) * s_uwUndrawRectsMax);
+		memFree(s_pUndrawActive, sizeof(tBobUndrawRect*) * s_uwUndrawRectsMax);
+		memFree(s_pUndrawSpans[0], sizeof(tBobUndrawRect) * s_uwUndrawRectsMax);
+		memFree(s_pUndrawSpans[1], sizeof(tBobUndrawRect) * s_uwUndrawRectsMax);
+		s_uwUndrawRectsMax = 0;
+	}
+#endif
 #if !defined(ACE_BOB_PRISTINE_BUFFER)
 	if(s_pQueues[0].pBg) {
 		bitmapDestroy(s_pQueues[0].pBg);
@@ -112,6 +147,201 @@ static ULONG bobCalculateBitplaneOffset(const tBob *pBob, tBitMap *pDestination)
 	return ulBitplaneOffset;
 }
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+static void bobUndrawRect(
+	const tBitMap *pDst, UWORD uwTop, UWORD uwBottom,
+	UWORD uwWordStart, UWORD uwWordEnd
+) {
+	// Blit size is limited to 64 words and 1024 lines
+	const UWORD uwMaxRows = 1023 / s_ubBpp;
+	while(uwWordStart < uwWordEnd) {
+		UWORD uwWords = MIN(uwWordEnd - uwWordStart, 64);
+		WORD wModulo = s_uwDestByteWidth - uwWords * 2;
+		ULONG ulOffset = pDst->BytesPerRow * uwTop + uwWordStart * 2;
+		blitWait();
+		g_pCustom->bltamod = wModulo;
+		g_pCustom->bltdmod = wModulo;
+		g_pCustom->bltapt = &s_pPristineBuffer->Planes[0][ulOffset];
+		g_pCustom->bltdpt = &pDst->Planes[0][ulOffset];
+		UWORD uwRows = uwBottom - uwTop;
+		while(uwRows) {
+			// Pointers continue on next row after previous part
+			UWORD uwPartRows = MIN(uwRows, uwMaxRows);
+			blitWait();
+			// Width of 64 words is encoded as 0
+			g_pCustom->bltsize = ((uwPartRows * s_ubBpp) << HSIZEBITS) | (uwWords & HSIZEMASK);
+			uwRows -= uwPartRows;
+			++s_sUndrawStats.ulBlits;
+			s_sUndrawStats.ulBlitWords += (ULONG)uwWords * uwPartRows * s_ubBpp;
+		}
+		uwWordStart += uwWords;
+	}
+}
+
+static void bobAddUndrawRect(
+	UWORD *pRectCount, UWORD uwTop, UWORD uwBottom,
+	UWORD uwWordStart, UWORD uwWordEnd
+) {
+	if(uwTop >= uwBottom) {
+		return;
+	}
+	// Insertion sort by top edge - bobs are usually pushed in similar order
+	// each frame, so it's cheap
+	UWORD i = (*pRectCount)++;
+	while(i && s_pUndrawRects[i - 1].uwTop > uwTop) {
+		s_pUndrawRects[i] = s_pUndrawRects[i - 1];
+		--i;
+	}
+	s_pUndrawRects[i].uwTop = uwTop;
+	s_pUndrawRects[i].uwBottom = uwBottom;
+	s_pUndrawRects[i].uwWordStart = uwWordStart;
+	s_pUndrawRects[i].uwWordEnd = uwWordEnd;
+}
+
+/**
+ * @brief Restores the exact union of undraw rects of given queue's bobs,
+ * so that overlapping areas are restored only once.
+ *
+ * Rects are swept top to bottom in bands between their edges. Each band is
+ * split into horizontal spans covered by any bob, and spans which stay same
+ * in consecutive bands are restored with single blit.
+ */
+static void bobUndrawMerged(const tBobQueue *pQueue) {
+	UWORD uwRectCount = 0;
+	for(UBYTE i = 0; i < pQueue->ubUndrawCount; ++i) {
+		const tBob *pBob = pQueue->pBobs[i];
+		if(!pBob->isUndrawRequired) {
+			continue;
+		}
+		const tUwCoordYX *pOldPos = &pBob->pOldPositions[s_ubBufferCurr];
+		UWORD uwWordStart = pOldPos->uwX / 16;
+		UWORD uwWordEnd = uwWordStart + (pBob->_uwBlitSize & HSIZEMASK);
+#if defined(BOB_WRAP_Y)
+		UWORD uwTop = HEIGHT_MODULO(pOldPos->uwY, s_uwAvailHeight);
+#else
+		UWORD uwTop = pOldPos->uwY;
+#endif
+		UWORD uwBottom = uwTop + pBob->uwHeight;
+		++s_sUndrawStats.ulRects;
+		s_sUndrawStats.ulRectWords += (
+			(ULONG)(uwWordEnd - uwWordStart) * pBob->_uwInterleavedHeight
+		);
+#if defined(BOB_WRAP_Y)
+		if(uwBottom > s_uwAvailHeight) {
+			bobAddUndrawRect(
+				&uwRectCount, 0, uwBottom - s_uwAvailHeight, uwWordStart, uwWordEnd
+			);
+			uwBottom = s_uwAvailHeight;
+		}
+#endif
+		bobAddUndrawRect(&uwRectCount, uwTop, uwBottom, uwWordStart, uwWordEnd);
+	}
+
+	tBobUndrawRect *pOpen = s_pUndrawSpans[0];
+	tBobUndrawRect *pBand = s_pUndrawSpans[1];
+	UWORD uwOpenCount = 0, uwActiveCount = 0, uwNext = 0;
+	UWORD uwY = 0;
+	while(uwNext < uwRectCount || uwActiveCount) {
+		if(!uwActiveCount) {
+			uwY = s_pUndrawRects[uwNext].uwTop;
+		}
+
+		// Activate rects starting at band's top, keeping them sorted by left edge
+		while(uwNext < uwRectCount && s_pUndrawRects[uwNext].uwTop == uwY) {
+			tBobUndrawRect *pRect = &s_pUndrawRects[uwNext++];
+			UWORD i = uwActiveCount++;
+			while(i && s_pUndrawActive[i - 1]->uwWordStart > pRect->uwWordStart) {
+				s_pUndrawActive[i] = s_pUndrawActive[i - 1];
+				--i;
+			}
+			s_pUndrawActive[i] = pRect;
+		}
+
+		// Band ends where any active rect ends or the next one starts
+		UWORD uwBandBottom = (
+			uwNext < uwRectCount ? s_pUndrawRects[uwNext].uwTop : 0xFFFF
+		);
+		UWORD uwBandCount = 0;
+		for(UWORD i = 0; i < uwActiveCount; ++i) {
+			const tBobUndrawRect *pRect = s_pUndrawActive[i];
+			uwBandBottom = MIN(uwBandBottom, pRect->uwBottom);
+			if(uwBandCount && pRect->uwWordStart <= pBand[uwBandCount - 1].uwWordEnd) {
+				pBand[uwBandCount - 1].uwWordEnd = MAX(
+					pBand[uwBandCount - 1].uwWordEnd, pRect->uwWordEnd
+				);
+			}
+			else {
+				pBand[uwBandCount].uwTop = uwY;
+				pBand[uwBandCount].uwWordStart = pRect->uwWordStart;
+				pBand[uwBandCount].uwWordEnd = pRect->uwWordEnd;
+				++uwBandCount;
+			}
+		}
+
+		// Extend open rects which continue in this band, restore the rest
+		UWORD uwOpen = 0;
+		for(UWORD i = 0; i < uwBandCount; ++i) {
+			while(
+				uwOpen < uwOpenCount &&
+				pOpen[uwOpen].uwWordStart < pBand[i].uwWordStart
+			) {
+				bobUndrawRect(
+					pQueue->pDst, pOpen[uwOpen].uwTop, uwY,
+					pOpen[uwOpen].uwWordStart, pOpen[uwOpen].uwWordEnd
+				);
+				++uwOpen;
+			}
+			if(
+				uwOpen < uwOpenCount &&
+				pOpen[uwOpen].uwWordStart == pBand[i].uwWordStart
+			) {
+				if(pOpen[uwOpen].uwWordEnd == pBand[i].uwWordEnd) {
+					pBand[i].uwTop = pOpen[uwOpen].uwTop;
+				}
+				else {
+					bobUndrawRect(
+						pQueue->pDst, pOpen[uwOpen].uwTop, uwY,
+						pOpen[uwOpen].uwWordStart, pOpen[uwOpen].uwWordEnd
+					);
+				}
+				++uwOpen;
+			}
+		}
+		while(uwOpen < uwOpenCount) {
+			bobUndrawRect(
+				pQueue->pDst, pOpen[uwOpen].uwTop, uwY,
+				pOpen[uwOpen].uwWordStart, pOpen[uwOpen].uwWordEnd
+			);
+			++uwOpen;
+		}
+		tBobUndrawRect *pTmp = pOpen;
+		pOpen = pBand;
+		pBand = pTmp;
+		uwOpenCount = uwBandCount;
+
+		// Deactivate rects ending at band's bottom
+		uwY = uwBandBottom;
+		UWORD uwKeptCount = 0;
+		for(UWORD i = 0; i < uwActiveCount; ++i) {
+			if(s_pUndrawActive[i]->uwBottom != uwY) {
+				s_pUndrawActive[uwKeptCount++] = s_pUndrawActive[i];
+			}
+		}
+		uwActiveCount = uwKeptCount;
+		if(!uwActiveCount) {
+			// Gap until next rect or end of all rects - restore all open ones
+			for(UWORD i = 0; i < uwOpenCount; ++i) {
+				bobUndrawRect(
+					pQueue->pDst, pOpen[i].uwTop, uwY,
+					pOpen[i].uwWordStart, pOpen[i].uwWordEnd
+				);
+			}
+			uwOpenCount = 0;
+		}
+	}
+}
+#endif
+
 //------------------------------------------------------------------- PUBLIC FNS
 
 void bobManagerReset(void) {
@@ -169,6 +399,9 @@ void bobManagerCreate(
 	s_ubBufferCurr = 0;
 	s_uwAvailHeight = uwAvailHeight;
 	s_uwDestByteWidth = bitmapGetByteWidth(pBack);
+#if defined(ACE_BOB_MERGE_UNDRAW)
+	bobResetUndrawStats();
+#endif
 
 	logBlockEnd("bobManagerCreate()");
 }
@@ -193,6 +426,13 @@ void bobReallocateBuffers(void) {
 	s_pQueues[0].pBg = bitmapCreate(16, s_uwBgBufferLength, s_ubBpp, BMF_INTERLEAVED);
 	s_pQueues[1].pBg = bitmapCreate(16, s_uwBgBufferLength, s_ubBpp, BMF_INTERLEAVED);
 	logWrite("Undraw bg buffer length: %hu\n", s_uwBgBufferLength);
+#endif
+#if defined(ACE_BOB_MERGE_UNDRAW)
+	s_uwUndrawRectsMax = s_ubMaxBobCount * BOB_UNDRAW_RECTS_PER_BOB;
+	s_pUndrawRects = memAllocFast(sizeof(tBobUndrawRect) * s_uwUndrawRectsMax);
+	s_pUndrawActive = memAllocFast(sizeof(tBobUndrawRect*) * s_uwUndrawRectsMax);
+	s_pUndrawSpans[0] = memAllocFast(sizeof(tBobUndrawRect) * s_uwUndrawRectsMax);
+	s_pUndrawSpans[1] = memAllocFast(sizeof(tBobUndrawRect) * s_uwUndrawRectsMax);
 #endif
 	logBlockEnd("bobReallocateBuffers()");
 	systemUnuse();
@@ -227,9 +467,11 @@ void bobInit(
 	UWORD uwBlitWords = (uwWidth+15) / 16 + 1; // One word more for aligned copy
 	pBob->_wModuloUndrawSave = s_uwDestByteWidth - uwBlitWords * 2;
 	pBob->_uwBlitSize = uwBlitWords; // Height compontent is set later on
+	pBob->pMaskData = 0;
 	bobSetFrame(pBob, pFrameData, pMaskData);
 	bobSetWidth(pBob, uwWidth);
 	bobSetHeight(pBob, uwHeight);
+	pBob->_ubDrawPhase = BOB_DRAW_PHASE_INVALID;
 
 	pBob->sPos.uwX = uwX;
 	pBob->sPos.uwY = uwY;
@@ -253,6 +495,10 @@ void bobInit(
 }
 
 void bobSetFrame(tBob *pBob, UBYTE *pFrameData, UBYTE *pMaskData) {
+	if(!pMaskData != !pBob->pMaskData) {
+		// Mask usage changes the channels used by draw blit
+		pBob->_ubDrawPhase = BOB_DRAW_PHASE_INVALID;
+	}
 	pBob->pFrameData = pFrameData;
 	pBob->pMaskData = pMaskData;
 }
@@ -271,6 +517,7 @@ void bobSetWidth(tBob *pBob, UWORD uwWidth)
 	pBob->uwWidth = uwWidth;
 	UWORD uwBlitWords = (uwWidth + 15) / 16 + 1; // One word more for aligned copy
 	pBob->_uwBlitSize = (pBob->_uwBlitSize & VSIZEMASK) | uwBlitWords;
+	pBob->_ubDrawPhase = BOB_DRAW_PHASE_INVALID;
 }
 
 void bobSetHeight(tBob *pBob, UWORD uwHeight)
@@ -287,6 +534,7 @@ void bobSetHeight(tBob *pBob, UWORD uwHeight)
 	pBob->uwHeight = uwHeight;
 	pBob->_uwInterleavedHeight = uwHeight * s_ubBpp;
 	pBob->_uwBlitSize = ((pBob->_uwInterleavedHeight) << HSIZEBITS) | (pBob->_uwBlitSize & HSIZEMASK);
+	pBob->_ubDrawPhase = BOB_DRAW_PHASE_INVALID;
 }
 
 UBYTE *bobCalcFrameAddress(tBitMap *pBitmap, UWORD uwOffsetY) {
@@ -362,20 +610,26 @@ UBYTE bobProcessNext(void) {
 		const tUwCoordYX * pPos = &pBob->sPos;
 		++s_ubBobsDrawn;
 		UBYTE ubDstOffs = pPos->uwX & 0xF;
-		UWORD uwBlitWidth = (pBob->uwWidth + ubDstOffs + 15) & 0xFFF0;
-		UWORD uwBlitWords = uwBlitWidth / 16;
-		UWORD uwBlitSize = ((pBob->_uwInterleavedHeight) << HSIZEBITS) | uwBlitWords;
-		WORD wSrcModulo = pBob->uwWidth / 8 - uwBlitWords * 2;
-		UWORD uwBltCon1 = ubDstOffs << BSHIFTSHIFT;
-		UWORD uwBltCon0;
-		if(pBob->pMaskData) {
-			uwBltCon0 = uwBltCon1 | USEA|USEB|USEC|USED | MINTERM_COOKIE;
-		}
-		else {
-			uwBltCon0 = uwBltCon1 | USEB|USEC|USED | MINTERM_COOKIE;
+		if(pBob->_ubDrawPhase != ubDstOffs) {
+			// Bobs tend to stay on same phase for many frames, e.g. when moving
+			// vertically or by 16px, so the register values are worth caching.
+			UWORD uwBlitWidth = (pBob->uwWidth + ubDstOffs + 15) & 0xFFF0;
+			UWORD uwBlitWords = uwBlitWidth / 16;
+			pBob->_uwDrawBlitSize = ((pBob->_uwInterleavedHeight) << HSIZEBITS) | uwBlitWords;
+			pBob->_wDrawSrcModulo = pBob->uwWidth / 8 - uwBlitWords * 2;
+			pBob->_wDrawDstModulo = s_uwDestByteWidth - uwBlitWords * 2;
+			pBob->_uwDrawLastMask = 0xFFFF << (uwBlitWidth-pBob->uwWidth);
+			if(pBob->pMaskData) {
+				pBob->_uwDrawBltCon0 = (ubDstOffs << ASHIFTSHIFT) | USEA|USEB|USEC|USED | MINTERM_COOKIE;
+			}
+			else {
+				pBob->_uwDrawBltCon0 = (ubDstOffs << ASHIFTSHIFT) | USEB|USEC|USED | MINTERM_COOKIE;
+			}
+			pBob->_ubDrawPhase = ubDstOffs;
 		}
+		WORD wSrcModulo = pBob->_wDrawSrcModulo;
+		WORD wDstModulo = pBob->_wDrawDstModulo;
 
-		WORD wDstModulo = s_uwDestByteWidth - uwBlitWords * 2;
 		UBYTE *pB = pBob->pFrameData;
 #if defined(ACE_BOB_PRISTINE_BUFFER)
 		ULONG ulDestinationOffset = bobCalculateBitplaneOffset(pBob, pQueue->pDst);
@@ -388,12 +642,11 @@ UBYTE bobProcessNext(void) {
 		UWORD uwPartHeight = s_uwAvailHeight - HEIGHT_MODULO(pBob->sPos.uwY, s_uwAvailHeight);
 #endif
 
-		UWORD uwLastMask = 0xFFFF << (uwBlitWidth-pBob->uwWidth);
 		blitWait();
-		g_pCustom->bltcon0 = uwBltCon0;
-		g_pCustom->bltcon1 = uwBltCon1;
+		g_pCustom->bltcon0 = pBob->_uwDrawBltCon0;
+		g_pCustom->bltcon1 = ubDstOffs << BSHIFTSHIFT;
 
-		g_pCustom->bltalwm = uwLastMask;
+		g_pCustom->bltalwm = pBob->_uwDrawLastMask;
 		if(pBob->pMaskData) {
 			UBYTE *pA = pBob->pMaskData;
 			g_pCustom->bltamod = wSrcModulo;
@@ -412,9 +665,10 @@ UBYTE bobProcessNext(void) {
 		g_pCustom->bltdpt = (APTR)pCD;
 #if defined(BOB_WRAP_Y)
 		if(uwPartHeight >= pBob->uwHeight) {
-			g_pCustom->bltsize = uwBlitSize;
+			g_pCustom->bltsize = pBob->_uwDrawBlitSize;
 		}
 		else {
+			UWORD uwBlitWords = pBob->_uwDrawBlitSize & HSIZEMASK;
 			UWORD uwInterleavedPartHeight = uwPartHeight * s_ubBpp;
 			g_pCustom->bltsize = (uwInterleavedPartHeight << HSIZEBITS) | uwBlitWords;
 			pCD = &pQueue->pDst->Planes[0][pBob->sPos.uwX / 8];
@@ -424,7 +678,7 @@ UBYTE bobProcessNext(void) {
 			g_pCustom->bltsize =((pBob->_uwInterleavedHeight - uwInterleavedPartHeight) << HSIZEBITS) | uwBlitWords;
 		}
 #else
-		g_pCustom->bltsize = uwBlitSize;
+		g_pCustom->bltsize = pBob->_uwDrawBlitSize;
 #endif
 		pBob->pOldPositions[s_ubBufferCurr].ulYX = pPos->ulYX;
 		return 1;
@@ -445,6 +699,9 @@ void bobBegin(tBitMap *pBuffer) {
 	g_pCustom->bltafwm = 0xFFFF;
 	g_pCustom->bltalwm = 0xFFFF;
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+	bobUndrawMerged(pQueue);
+#else
 	for(UBYTE i = 0; i < pQueue->ubUndrawCount; ++i) {
 		const tBob *pBob = pQueue->pBobs[i];
 		if(!pBob->isUndrawRequired) {
@@ -480,6 +737,7 @@ void bobBegin(tBitMap *pBuffer) {
 		g_pCustom->bltsize = pBob->_uwBlitSize;
 #endif
 	}
+#endif
 #else
 	// Prepare for undraw
 	UBYTE *pA = pQueue->pBg->Planes[0];
@@ -573,6 +831,19 @@ void bobDiscardUndraw(void) {
 	s_pQueues[1].ubUndrawCount = 0;
 }
 
+#if defined(ACE_BOB_MERGE_UNDRAW)
+const tBobUndrawStats *bobGetUndrawStats(void) {
+	return &s_sUndrawStats;
+}
+
+void bobResetUndrawStats(void) {
+	s_sUndrawStats.ulRects = 0;
+	s_sUndrawStats.ulRectWords = 0;
+	s_sUndrawStats.ulBlits = 0;
+	s_sUndrawStats.ulBlitWords = 0;
+}
+#endif
+
 void bobSetCurrentBuffer(tBitMap *pCurrent) {
 	if(s_pQueues[!s_ubBufferCurr].pDst == pCurrent) {
 		s_ubBufferCurr = !s_ubBufferCurr;
@@ -13,8 +13,37 @@
 // Globals
 tLogManager g_sLogManager = {0};
 
+// Size of write-behind buffer for file logs. Each file write requires OS,
+// so messages are gathered here and written in bulk at safe points.
+#define LOG_FILE_BUFFER_SIZE 8192
+
 // This can't be created on stack because it's only 10k by default under ks1.3.
 static char s_szMsg[1024];
+static char s_pFileBuffer[LOG_FILE_BUFFER_SIZE];
+static UWORD s_uwFileBufferFill;
+
+#if defined(ACE_DEBUG_LOG_BINARY)
+// Binary log file format, decoded by tools/log_decode. All values are BE.
+// - ULONG magic
+// - records, each starting with UBYTE tag:
+//   - FORMAT: ULONG pointer, UWORD length, format string without terminator.
+//     Emitted when the pointer is used for the first time.
+//   - MESSAGE: UWORD size of rest of record, ULONG format pointer,
+//     UBYTE indent or LOG_BINARY_NO_INDENT, then args in format order: ULONG
+//     each, 8 bytes for %ll and floats, UWORD length and chars for %s.
+//     Args which didn't fit in LOG_BINARY_RECORD_MAX_SIZE are omitted.
+//   - TRIM_NEWLINE: removes last newline from output, for collapsed blocks.
+#define LOG_BINARY_MAGIC 0x41434542 // "ACEB"
+#define LOG_BINARY_TAG_FORMAT 1
+#define LOG_BINARY_TAG_MESSAGE 2
+#define LOG_BINARY_TAG_TRIM_NEWLINE 3
+#define LOG_BINARY_NO_INDENT 0xFF
+#define LOG_BINARY_RECORD_MAX_SIZE 1024
+#define LOG_BINARY_KNOWN_FORMAT_COUNT 256 // Must be power of two
+
+// Format strings already stored in log file, indexed by pointer hash.
+static const char *s_pKnownFormats[LOG_BINARY_KNOWN_FORMAT_COUNT];
+#endif
 
 #ifdef ACE_DEBUG_UAE
 
@@ -54,6 +83,198 @@ static UBYTE isWritingToFileAllowed(void) {
 	return g_sLogManager.pFile && !g_sLogManager.wInterruptDepth;
 }
 
+static void logFileBufferFlush(void) {
+	if(!s_uwFileBufferFill) {
+		return;
+	}
+
+	++g_sLogManager.ubShutUp;
+	systemUse();
+	fileWriteBytes(g_sLogManager.pFile, (const UBYTE*)s_pFileBuffer, s_uwFileBufferFill);
+	fileFlush(g_sLogManager.pFile);
+	systemUnuse();
+	s_uwFileBufferFill = 0;
+	--g_sLogManager.ubShutUp;
+}
+
+static void logFileBufferAppend(const char *szMsg) {
+	UWORD uwLength = strlen(szMsg);
+	if(s_uwFileBufferFill + uwLength > LOG_FILE_BUFFER_SIZE) {
+		logFileBufferFlush();
+	}
+	memcpy(&s_pFileBuffer[s_uwFileBufferFill], szMsg, uwLength);
+	s_uwFileBufferFill += uwLength;
+}
+
+#if defined(ACE_DEBUG_LOG_BINARY)
+
+static UBYTE *logBinaryRecordBegin(void) {
+	if(s_uwFileBufferFill + LOG_BINARY_RECORD_MAX_SIZE > LOG_FILE_BUFFER_SIZE) {
+		logFileBufferFlush();
+	}
+	return (UBYTE*)&s_pFileBuffer[s_uwFileBufferFill];
+}
+
+static void logBinaryRecordEnd(const UBYTE *pRecordEnd) {
+	s_uwFileBufferFill = pRecordEnd - (const UBYTE*)s_pFileBuffer;
+}
+
+// Buffer isn't aligned, so store byte by byte - this also makes it BE
+// regardless of platform.
+static UBYTE *logBinaryPutWord(UBYTE *pDest, UWORD uwValue) {
+	*(pDest++) = uwValue >> 8;
+	*(pDest++) = uwValue;
+	return pDest;
+}
+
+static UBYTE *logBinaryPutLong(UBYTE *pDest, ULONG ulValue) {
+	*(pDest++) = ulValue >> 24;
+	*(pDest++) = ulValue >> 16;
+	*(pDest++) = ulValue >> 8;
+	*(pDest++) = ulValue;
+	return pDest;
+}
+
+static UBYTE *logBinaryPutString(
+	UBYTE *pDest, const char *szStr, const UBYTE *pRecordLimit
+) {
+	// Caller ensures there's room for the length. Space is signed so that it
+	// can't wrap around when the record is almost full.
+	ULONG ulLength = strlen(szStr);
+	LONG lSpaceLeft = (LONG)(pRecordLimit - pDest) - (LONG)sizeof(UWORD);
+	if(lSpaceLeft < 0) {
+		lSpaceLeft = 0;
+	}
+	UWORD uwLength = MIN(ulLength, (ULONG)lSpaceLeft);
+	pDest = logBinaryPutWord(pDest, uwLength);
+	memcpy(pDest, szStr, uwLength);
+	return pDest + uwLength;
+}
+
+static void logBinaryWriteFormat(const char *szFormat) {
+	UWORD uwHash = ((ULONG)szFormat ^ ((ULONG)szFormat >> 8)) & (LOG_BINARY_KNOWN_FORMAT_COUNT - 1);
+	if(s_pKnownFormats[uwHash] == szFormat) {
+		return;
+	}
+	s_pKnownFormats[uwHash] = szFormat;
+
+	UBYTE *pRecord = logBinaryRecordBegin();
+	const UBYTE *pRecordLimit = pRecord + LOG_BINARY_RECORD_MAX_SIZE;
+	*(pRecord++) = LOG_BINARY_TAG_FORMAT;
+	pRecord = logBinaryPutLong(pRecord, (ULONG)szFormat);
+	pRecord = logBinaryPutString(pRecord, szFormat, pRecordLimit);
+	logBinaryRecordEnd(pRecord);
+}
+
+/**
+ * @brief Stores format pointer and raw args instead of formatted text.
+ * Only the format is scanned to find out arg sizes and strings to be copied,
+ * which is much cheaper than actual formatting.
+ */
+static void logBinaryWriteMessage(
+	const char *szFormat, va_list vaArgs, UBYTE ubIndent
+) {
+	logBinaryWriteFormat(szFormat);
+
+	UBYTE *pRecord = logBinaryRecordBegin();
+	const UBYTE *pRecordLimit = pRecord + LOG_BINARY_RECORD_MAX_SIZE;
+	*(pRecord++) = LOG_BINARY_TAG_MESSAGE;
+	UBYTE *pRecordSize = pRecord;
+	pRecord += sizeof(UWORD);
+	pRecord = logBinaryPutLong(pRecord, (ULONG)szFormat);
+	*(pRecord++) = ubIndent;
+
+	// Args which don't fit are dropped - the decoder marks them as missing.
+	UBYTE isFull = 0;
+	for(const char *pFmt = szFormat; *pFmt && !isFull; ++pFmt) {
+		if(*pFmt != '%') {
+			continue;
+		}
+		++pFmt;
+		if(*pFmt == '%') {
+			continue;
+		}
+
+		UBYTE isLongLong = 0;
+		while(*pFmt) {
+			char c = *pFmt;
+			UBYTE ubArgSize = 0;
+			if(c == '*' || c == 'p') {
+				ubArgSize = sizeof(ULONG);
+			}
+			else if(c == 's') {
+				ubArgSize = sizeof(UWORD);
+			}
+			else if(c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G') {
+				ubArgSize = sizeof(double);
+			}
+			else if(
+				c == 'd' || c == 'i' || c == 'u' || c == 'x' || c == 'X' ||
+				c == 'o' || c == 'b' || c == 'c'
+			) {
+				ubArgSize = isLongLong ? 2 * sizeof(ULONG) : sizeof(ULONG);
+			}
+			if(pRecordLimit - pRecord < ubArgSize) {
+				isFull = 1;
+				break;
+			}
+
+			if(c == '*') {
+				pRecord = logBinaryPutLong(pRecord, va_arg(vaArgs, int));
+			}
+			else if(c == 'l' && pFmt[1] == 'l') {
+				isLongLong = 1;
+				++pFmt;
+			}
+			else if(c == 's') {
+				const char *szArg = va_arg(vaArgs, const char*);
+				pRecord = logBinaryPutString(
+					pRecord, szArg ? szArg : "(null)", pRecordLimit
+				);
+				break;
+			}
+			else if(c == 'p') {
+				pRecord = logBinaryPutLong(pRecord, (ULONG)va_arg(vaArgs, void*));
+				break;
+			}
+			else if(c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G') {
+				double fArg = va_arg(vaArgs, double);
+				memcpy(pRecord, &fArg, sizeof(fArg));
+				pRecord += sizeof(fArg);
+				break;
+			}
+			else if(
+				c == 'd' || c == 'i' || c == 'u' || c == 'x' || c == 'X' ||
+				c == 'o' || c == 'b' || c == 'c'
+			) {
+				if(isLongLong) {
+					long long llArg = va_arg(vaArgs, long long);
+					pRecord = logBinaryPutLong(pRecord, (ULONG)(llArg >> 32));
+					pRecord = logBinaryPutLong(pRecord, (ULONG)llArg);
+				}
+				else {
+					pRecord = logBinaryPutLong(pRecord, va_arg(vaArgs, ULONG));
+				}
+				break;
+			}
+			++pFmt;
+		}
+		if(!*pFmt || isFull) {
+			break;
+		}
+	}
+	logBinaryPutWord(pRecordSize, pRecord - pRecordSize - sizeof(UWORD));
+	logBinaryRecordEnd(pRecord);
+}
+
+static void logBinaryWriteTrimNewline(void) {
+	UBYTE *pRecord = logBinaryRecordBegin();
+	*(pRecord++) = LOG_BINARY_TAG_TRIM_NEWLINE;
+	logBinaryRecordEnd(pRecord);
+}
+
+#endif // ACE_DEBUG_LOG_BINARY
+
 /**
  * Base debug functions
  */
@@ -61,6 +282,11 @@ static UBYTE isWritingToFileAllowed(void) {
 void _logOpen(const char *szFilePath) {
 	g_sLogManager.ubShutUp = 1; // Prevent log message for diskFileOpen()
 	g_sLogManager.pFile = szFilePath ? diskFileOpen(szFilePath, DISK_FILE_MODE_WRITE, 0) : 0;
+	s_uwFileBufferFill = 0;
+#if defined(ACE_DEBUG_LOG_BINARY)
+	memset(s_pKnownFormats, 0, sizeof(s_pKnownFormats));
+	logBinaryRecordEnd(logBinaryPutLong(logBinaryRecordBegin(), LOG_BINARY_MAGIC));
+#endif
 	g_sLogManager.ubIndent = 0;
 	g_sLogManager.wasLastInline = 0;
 	g_sLogManager.isBlockEmpty = 1;
@@ -97,19 +323,33 @@ void _logWriteVa(char *szFormat, va_list vaArgs) {
 	// logging to file) due to static nature of the buffer.
 	++g_sLogManager.ubShutUp;
 
+	g_sLogManager.isBlockEmpty = 0;
+	UBYTE isIndented = !g_sLogManager.wasLastInline;
+	g_sLogManager.wasLastInline = szFormat[strlen(szFormat) - 1] != '\n';
+
+#if defined(ACE_DEBUG_LOG_BINARY)
+	if(isWritingToFileAllowed()) {
+		va_list vaArgsCopy;
+		va_copy(vaArgsCopy, vaArgs);
+		logBinaryWriteMessage(
+			szFormat, vaArgsCopy,
+			isIndented ? g_sLogManager.ubIndent : LOG_BINARY_NO_INDENT
+		);
+		va_end(vaArgsCopy);
+	}
+#endif
+
+#if !defined(ACE_DEBUG_LOG_BINARY) || defined(ACE_DEBUG_UAE) || defined(ACE_DEBUG_SERIAL)
 	// Bartman's UAE logger appends newline to each print, so the message must
 	// be emitted in one print with indentation.
 	UWORD uwOffs = 0;
-	g_sLogManager.isBlockEmpty = 0;
-	if (!g_sLogManager.wasLastInline) {
+	if (isIndented) {
 		UBYTE ubLogIndent = g_sLogManager.ubIndent;
 		while (ubLogIndent--) {
 			s_szMsg[uwOffs++] = '\t';
 		}
 	}
 
-	g_sLogManager.wasLastInline = szFormat[strlen(szFormat) - 1] != '\n';
-
 	vsprintf(&s_szMsg[uwOffs], szFormat, vaArgs);
 	printUae(s_szMsg);
 #if defined(ACE_DEBUG_SERIAL)
@@ -118,19 +358,33 @@ void _logWriteVa(char *szFormat, va_list vaArgs) {
 	}
 #endif
 
+#if !defined(ACE_DEBUG_LOG_BINARY)
 	if(isWritingToFileAllowed()) {
-		systemUse();
-		fileWriteStr(g_sLogManager.pFile, s_szMsg);
-		fileFlush(g_sLogManager.pFile);
-		systemUnuse();
+		logFileBufferAppend(s_szMsg);
 	}
+#endif
+#endif
 
 	--g_sLogManager.ubShutUp;
 }
 
+void _logFlush(void) {
+	if(isWritingToFileAllowed()) {
+		logFileBufferFlush();
+	}
+}
+
+void _logFlushOnIdle(void) {
+	// Don't waste OS calls on every idle frame, wait for decent amount of data
+	if(s_uwFileBufferFill >= LOG_FILE_BUFFER_SIZE / 2) {
+		_logFlush();
+	}
+}
+
 void _logClose(void) {
 	logWrite("Log closed successfully\n");
 	if(g_sLogManager.pFile) {
+		logFileBufferFlush();
 		fileClose(g_sLogManager.pFile);
 		g_sLogManager.pFile = 0;
 	}
@@ -151,9 +405,6 @@ void _logBlockBegin(char *szBlockName, ...) {
 	if(g_sLogManager.ubShutUp) {
 		return;
 	}
-	if(isWritingToFileAllowed()) {
-		systemUse();
-	}
 
 	logWrite("Block begin: ");
 	va_list vaArgs;
@@ -166,19 +417,12 @@ void _logBlockBegin(char *szBlockName, ...) {
 	logPushIndent();
 	g_sLogManager.isBlockEmpty = 1;
 	memCheckIntegrity();
-
-	if(isWritingToFileAllowed()) {
-		systemUnuse();
-	}
 }
 
 void _logBlockEnd(char *szBlockName) {
 	if(g_sLogManager.ubShutUp) {
 		return;
 	}
-	if(isWritingToFileAllowed()) {
-		systemUse();
-	}
 
 	memCheckIntegrity();
 	logPopIndent();
@@ -192,18 +436,26 @@ void _logBlockEnd(char *szBlockName) {
 	if(g_sLogManager.isBlockEmpty) {
 		// empty block - collapse to single line
 		g_sLogManager.wasLastInline = 1;
-		if(g_sLogManager.pFile) {
+#if defined(ACE_DEBUG_LOG_BINARY)
+		if(isWritingToFileAllowed()) {
+			logBinaryWriteTrimNewline();
+		}
+#else
+		if(s_uwFileBufferFill) {
+			--s_uwFileBufferFill;
+		}
+		else if(isWritingToFileAllowed()) {
+			systemUse();
 			fileSeek(g_sLogManager.pFile, -1, SEEK_CUR);
+			systemUnuse();
 		}
+#endif
 		logWrite("...OK, time: %s\n", g_sLogManager.szTimeBfr);
 	}
 	else {
 		logWrite("Block end: %s, time: %s\n", szBlockName, g_sLogManager.szTimeBfr);
 	}
 	g_sLogManager.isBlockEmpty = 0;
-	if(isWritingToFileAllowed()) {
-		systemUnuse();
-	}
 }
 
 // Average logging
@@ -7,28 +7,139 @@
 #include <ace/managers/memory.h>
 #include <ace/managers/system.h>
 #include <ace/managers/log.h>
+#include <ace/macros.h>
 
 #ifdef AMIGA
 #include <clib/exec_protos.h> // AvailMem, AllocMem, FreeMem, etc.
 #endif
 
+//---------------------------------------------------------------------- DEFINES
+
+// Initial number of slots in tracked allocation table, as power of two.
+// Table doubles its size when it gets 3/4 full.
+#define MEM_ENTRY_COUNT_INITIAL_BITS 10
+
 //------------------------------------------------------------------------ TYPES
 
 typedef struct _tMemEntry {
-	void *pAddr;
+	void *pAddr; ///< Zero if slot is free.
 	ULONG ulSize;
 	UWORD uwId;
-	struct _tMemEntry *pNext;
+	UBYTE ubMemType; ///< Cached memType() result of pAddr.
 } tMemEntry;
 
+typedef struct tMemArena {
+	UBYTE *pData;
+	ULONG ulSize;
+	ULONG ulUsed;
+	ULONG ulPeak; ///< High-water mark, kept after arena is destroyed.
+} tMemArena;
+
 //----------------------------------------------------------------- PRIVATE VARS
 
 static UWORD s_uwLastId = 0;
-static tMemEntry *s_pMemTail;
+static tMemEntry *s_pMemEntries; ///< Open-addressing table, linear probing.
+static ULONG s_ulMemEntryCapacity, s_ulMemEntryCount;
+static UBYTE s_ubMemEntryBits;
 static ULONG s_ulChipUsage, s_ulChipPeakUsage, s_ulFastUsage, s_ulFastPeakUsage;
+static tMemArena s_sFrameArenaFast, s_sFrameArenaChip;
 
 //---------------------------------------------------------------- MEM ENTRY FNS
 
+static void memEntryCheckTrash(
+	const tMemEntry *pEntry, UWORD uwLine, const char *szFile
+) {
+	UBYTE *pCafe = (UBYTE*)(pEntry->pAddr - 4*sizeof(UBYTE));
+	UBYTE *pDead = (UBYTE*)(pEntry->pAddr + pEntry->ulSize);
+	if(pCafe[0] != 0xCA || pCafe[1] != 0xFE || pCafe[2] != 0xBA || pCafe[3] != 0xBE) {
+		logWrite(
+			"[MEM] ERR: Left mem trashed: %hu@%p (%s:%u)\n",
+			pEntry->uwId, pEntry->pAddr, szFile, uwLine
+		);
+	}
+	if(pDead[0] != 0xDE || pDead[1] != 0xAD || pDead[2] != 0xBE || pDead[3] != 0xEF) {
+		logWrite(
+			"[MEM] ERR: Right mem trashed: %hu@%p (%s:%u)\n",
+			pEntry->uwId, pEntry->pAddr, szFile, uwLine
+		);
+	}
+}
+
+static inline ULONG memEntryGetHome(const void *pAddr) {
+	// Fibonacci hashing - low bits of addresses are mostly the same due to
+	// alignment, so mix them all into the top ones and use those.
+	return ((ULONG)pAddr * 2654435761u) >> (32 - s_ubMemEntryBits);
+}
+
+static tMemEntry *memEntryFind(const void *pAddr) {
+	if(!s_pMemEntries) {
+		return 0;
+	}
+	ULONG ulMask = s_ulMemEntryCapacity - 1;
+	for(ULONG i = memEntryGetHome(pAddr); s_pMemEntries[i].pAddr; i = (i + 1) & ulMask) {
+		if(s_pMemEntries[i].pAddr == pAddr) {
+			return &s_pMemEntries[i];
+		}
+	}
+	return 0;
+}
+
+static void memEntryInsert(const tMemEntry *pEntry) {
+	ULONG ulMask = s_ulMemEntryCapacity - 1;
+	ULONG i = memEntryGetHome(pEntry->pAddr);
+	while(s_pMemEntries[i].pAddr) {
+		i = (i + 1) & ulMask;
+	}
+	s_pMemEntries[i] = *pEntry;
+	++s_ulMemEntryCount;
+}
+
+static UBYTE memEntryResize(UBYTE ubNewBits) {
+	// Table itself isn't tracked, so it doesn't pollute its own stats.
+	tMemEntry *pOldEntries = s_pMemEntries;
+	ULONG ulOldCapacity = s_ulMemEntryCapacity;
+	ULONG ulNewCapacity = 1UL << ubNewBits;
+	tMemEntry *pNewEntries = _memAllocRls(
+		ulNewCapacity * sizeof(tMemEntry), MEMF_ANY
+	);
+	if(!pNewEntries) {
+		return 0;
+	}
+	for(ULONG i = 0; i < ulNewCapacity; ++i) {
+		pNewEntries[i].pAddr = 0;
+	}
+
+	s_pMemEntries = pNewEntries;
+	s_ulMemEntryCapacity = ulNewCapacity;
+	s_ubMemEntryBits = ubNewBits;
+	s_ulMemEntryCount = 0;
+	if(pOldEntries) {
+		for(ULONG i = 0; i < ulOldCapacity; ++i) {
+			if(pOldEntries[i].pAddr) {
+				memEntryInsert(&pOldEntries[i]);
+			}
+		}
+		_memFreeRls(pOldEntries, ulOldCapacity * sizeof(tMemEntry));
+	}
+	return 1;
+}
+
+static void memEntryRemove(tMemEntry *pEntry) {
+	// Backward-shift deletion, so that lookups don't need tombstones
+	ULONG ulMask = s_ulMemEntryCapacity - 1;
+	ULONG ulHole = pEntry - s_pMemEntries;
+	for(ULONG i = (ulHole + 1) & ulMask; s_pMemEntries[i].pAddr; i = (i + 1) & ulMask) {
+		// Move the entry to the hole only if it won't land before its home slot
+		ULONG ulHome = memEntryGetHome(s_pMemEntries[i].pAddr);
+		if(((i - ulHome) & ulMask) >= ((i - ulHole) & ulMask)) {
+			s_pMemEntries[ulHole] = s_pMemEntries[i];
+			ulHole = i;
+		}
+	}
+	s_pMemEntries[ulHole].pAddr = 0;
+	--s_ulMemEntryCount;
+}
+
 static void _memEntryAdd(
 	void *pAddr, ULONG ulSize, UWORD uwLine, const char *szFile
 ) {
@@ -40,23 +151,33 @@ static void _memEntryAdd(
 	// in case it needs other components on some exotic configs.
 
 	systemUse();
-	tMemEntry *pNext;
+	if(
+		(s_ulMemEntryCount + 1) * 4 > s_ulMemEntryCapacity * 3 &&
+		!memEntryResize(s_ubMemEntryBits ? s_ubMemEntryBits + 1 : MEM_ENTRY_COUNT_INITIAL_BITS)
+	) {
+		logWrite(
+			"[MEM] ERR: can't grow entry table, memory %p won't be tracked (%s:%u)\n",
+			pAddr, szFile, uwLine
+		);
+		systemUnuse();
+		return;
+	}
+
 	// Add mem usage entry
-	pNext = s_pMemTail;
-	s_pMemTail = _memAllocRls(sizeof(tMemEntry), MEMF_CLEAR);
-	s_pMemTail->pAddr = pAddr;
-	s_pMemTail->ulSize = ulSize;
-	s_pMemTail->uwId = s_uwLastId++;
-	s_pMemTail->pNext = pNext;
+	tMemEntry sEntry = {
+		.pAddr = pAddr, .ulSize = ulSize, .uwId = s_uwLastId++,
+		.ubMemType = memType(pAddr)
+	};
+	memEntryInsert(&sEntry);
 
 	logWrite(
 		"[MEM] Allocated %s memory %hu@%p, size %lu (%s:%u)\n",
-		(memType(pAddr) & MEMF_CHIP) ? "CHIP" : "FAST",
-		s_pMemTail->uwId, pAddr, ulSize, szFile, uwLine
+		(sEntry.ubMemType & MEMF_CHIP) ? "CHIP" : "FAST",
+		sEntry.uwId, pAddr, ulSize, szFile, uwLine
 	);
 
 	// Update mem usage counter
-	if(memType(pAddr) & MEMF_CHIP) {
+	if(sEntry.ubMemType & MEMF_CHIP) {
 		s_ulChipUsage += ulSize;
 		if(s_ulChipUsage > s_ulChipPeakUsage) {
 			s_ulChipPeakUsage = s_ulChipUsage;
@@ -74,87 +195,59 @@ static void _memEntryAdd(
 static ULONG _memEntryDelete(
 	void *pAddr, ULONG ulSize, UWORD uwLine, const char *szFile
 ) {
-	tMemEntry *pPrev = 0;
-	tMemEntry *pCurr = s_pMemTail;
-
 	// find memory entry
-	while(pCurr && pCurr->pAddr != pAddr) {
-		pPrev = pCurr;
-		pCurr = pCurr->pNext;
-	}
-	if(!pCurr) {
+	tMemEntry *pEntry = memEntryFind(pAddr);
+	if(!pEntry) {
 		logWrite(
 			"[MEM] ERR: can't find memory allocated at %p (%s:%u)\n", pAddr, szFile, uwLine
 		);
 		return 0;
 	}
 
-	// unlink entry from list
-	if(pPrev) {
-		pPrev->pNext = pCurr->pNext;
-	}
-	else {
-		s_pMemTail = pCurr->pNext;
-	}
-
 	// remove entry
-	systemUse();
-	if(ulSize != pCurr->ulSize) {
+	memEntryCheckTrash(pEntry, uwLine, szFile);
+	tMemEntry sEntry = *pEntry;
+	memEntryRemove(pEntry);
+	if(ulSize != sEntry.ulSize) {
 		logWrite(
 			"[MEM] ERR: memFree size mismatch at memory %hu@%p: %lu, should be %lu (%s:%u)\n",
-			pCurr->uwId, pAddr, ulSize, pCurr->ulSize, szFile, uwLine
+			sEntry.uwId, pAddr, ulSize, sEntry.ulSize, szFile, uwLine
 		);
 	}
 	logWrite(
 		"[MEM] Freed memory %hu@%p, size %lu (%s:%u)\n",
-		pCurr->uwId, pAddr, ulSize, szFile, uwLine
+		sEntry.uwId, pAddr, ulSize, szFile, uwLine
 	);
 
 	// Update mem usage counter
-	if(memType(pAddr) & MEMF_CHIP) {
+	if(sEntry.ubMemType & MEMF_CHIP) {
 		s_ulChipUsage -= ulSize;
 	}
 	else {
 		s_ulFastUsage -= ulSize;
 	}
 
-	systemUnuse();
-	return pCurr->ulSize;
-}
-
-static void memEntryCheckTrash(
-	const tMemEntry *pEntry, UWORD uwLine, const char *szFile
-) {
-	UBYTE *pCafe = (UBYTE*)(pEntry->pAddr - 4*sizeof(UBYTE));
-	UBYTE *pDead = (UBYTE*)(pEntry->pAddr + pEntry->ulSize);
-	if(pCafe[0] != 0xCA || pCafe[1] != 0xFE || pCafe[2] != 0xBA || pCafe[3] != 0xBE) {
-		logWrite(
-			"[MEM] ERR: Left mem trashed: %hu@%p (%s:%u)\n",
-			pEntry->uwId, pEntry->pAddr, szFile, uwLine
-		);
-	}
-	if(pDead[0] != 0xDE || pDead[1] != 0xAD || pDead[2] != 0xBE || pDead[3] != 0xEF) {
-		logWrite(
-			"[MEM] ERR: Right mem trashed: %hu@%p (%s:%u)\n",
-			pEntry->uwId, pEntry->pAddr, szFile, uwLine
-		);
-	}
+	return sEntry.ulSize;
 }
 
 //---------------------------------------------------------------------- MEM FNS
 
 void _memCheckIntegrity(UWORD uwLine, const char *szFile) {
-	tMemEntry *pEntry = s_pMemTail;
-	while(pEntry) {
-		memEntryCheckTrash(pEntry, uwLine, szFile);
-		pEntry = pEntry->pNext;
+	for(ULONG i = 0; i < s_ulMemEntryCapacity; ++i) {
+		if(s_pMemEntries[i].pAddr) {
+			memEntryCheckTrash(&s_pMemEntries[i], uwLine, szFile);
+		}
 	}
 
 	systemCheckStack();
 }
 
 void _memCreate(void) {
-	s_pMemTail = 0;
+	s_pMemEntries = 0;
+	s_ulMemEntryCapacity = 0;
+	s_ulMemEntryCount = 0;
+	s_ubMemEntryBits = 0;
+	memEntryResize(MEM_ENTRY_COUNT_INITIAL_BITS);
 	s_ulChipUsage = 0;
 	s_ulChipPeakUsage = 0;
 	s_ulFastUsage = 0;
@@ -166,13 +259,24 @@ void _memDestroy(void) {
 	systemUse();
 	logWrite("\n=============== MEMORY MANAGER DESTROY ==============\n");
 	logWrite("If something is deallocated past here, you're a wuss!\n");
-	while(s_pMemTail) {
-		_memFreeDbg(s_pMemTail->pAddr, s_pMemTail->ulSize, 0, "memoryDestroy");
+	for(ULONG i = 0; i < s_ulMemEntryCapacity;) {
+		if(s_pMemEntries[i].pAddr) {
+			// Removal may shift other entry into this slot, so check it again
+			_memFreeDbg(
+				s_pMemEntries[i].pAddr, s_pMemEntries[i].ulSize, 0, "memoryDestroy"
+			);
+		}
+		else {
+			++i;
+		}
+	}
+	_memLogPeak();
+	if(s_pMemEntries) {
+		_memFreeRls(s_pMemEntries, s_ulMemEntryCapacity * sizeof(tMemEntry));
+		s_pMemEntries = 0;
+		s_ulMemEntryCapacity = 0;
+		s_ubMemEntryBits = 0;
 	}
-	logWrite(
-		"[MEM] Peak usage: CHIP: %lu, FAST: %lu\n",
-		s_ulChipPeakUsage, s_ulFastPeakUsage
-	);
 	systemUnuse();
 }
 
@@ -213,7 +317,9 @@ void _memFreeDbg(
 	void *pMem, ULONG ulSize, UWORD uwLine, const char *szFile
 ) {
 	systemUse();
-	_memCheckIntegrity(uwLine, szFile);
+	// Only the freed block is checked here - scanning all of them on each free
+	// would be too slow with lots of allocations. Log blocks still do that.
+	systemCheckStack();
 	ulSize = _memEntryDelete(pMem, ulSize, uwLine, szFile);
 	if(ulSize) {
 		_memFreeRls(pMem - sizeof(ULONG), ulSize + 2 * sizeof(ULONG));
@@ -250,11 +356,8 @@ void _memFreeRls(void *pMem, ULONG ulSize) {
 
 void _memCheckTrashAtAddr(void *pMem, UWORD uwLine, const char *szFile) {
 	// find memory entry
-	tMemEntry *pEntry = s_pMemTail;
-	while(pEntry && pEntry->pAddr != pMem) {
-		pEntry = pEntry->pNext;
-	}
-	if(pEntry->pAddr != pMem) {
+	tMemEntry *pEntry = memEntryFind(pMem);
+	if(!pEntry) {
 		logWrite(
 			"[MEM] ERR: can't find memory allocated at %p (%s:%u)\n",
 			pMem, szFile, uwLine
@@ -269,6 +372,10 @@ void _memLogPeak(void) {
 		"[MEM] Peak usage: CHIP: %lu, FAST: %lu\n",
 		s_ulChipPeakUsage, s_ulFastPeakUsage
 	);
+	logWrite(
+		"[MEM] Frame arena peak usage: CHIP: %lu, FAST: %lu\n",
+		s_sFrameArenaChip.ulPeak, s_sFrameArenaFast.ulPeak
+	);
 }
 
 UBYTE memType(const void *pMem) {
@@ -290,3 +397,184 @@ ULONG memGetFreeChipSize(void) {
 ULONG memGetFreeSize(void) {
 	return AvailMem(MEMF_ANY);
 }
+
+//--------------------------------------------------------------------- POOL FNS
+
+tMemPool *memPoolCreate(ULONG ulElemSize, UWORD uwElemCount, ULONG ulMemType) {
+	logBlockBegin(
+		"memPoolCreate(ulElemSize: %lu, uwElemCount: %hu, ulMemType: %lu)",
+		ulElemSize, uwElemCount, ulMemType
+	);
+	if(!ulElemSize || !uwElemCount) {
+		logWrite("ERR: Zero element size or count\n");
+		logBlockEnd("memPoolCreate()");
+		return 0;
+	}
+
+	tMemPool *pPool = memAllocFast(sizeof(*pPool));
+	if(!pPool) {
+		logBlockEnd("memPoolCreate()");
+		return 0;
+	}
+
+	// Free elements store the next free element pointer, so they must fit it.
+	// Round up to longword so that all elements stay aligned.
+	ulElemSize = MAX(ulElemSize, sizeof(void*));
+	pPool->ulElemSize = (ulElemSize + 3) & ~3UL;
+	pPool->uwElemCount = uwElemCount;
+	pPool->uwUsedCount = 0;
+	pPool->uwPeakCount = 0;
+	pPool->pData = memAlloc(pPool->ulElemSize * uwElemCount, ulMemType);
+	if(!pPool->pData) {
+		memFree(pPool, sizeof(*pPool));
+		logBlockEnd("memPoolCreate()");
+		return 0;
+	}
+#if defined(ACE_DEBUG)
+	pPool->pUsed = memAllocFastClear(uwElemCount);
+#endif
+
+	// Link all elements into free list, in address order
+	UBYTE *pElem = pPool->pData;
+	for(UWORD i = 0; i < uwElemCount - 1; ++i) {
+		*(void**)pElem = pElem + pPool->ulElemSize;
+		pElem += pPool->ulElemSize;
+	}
+	*(void**)pElem = 0;
+	pPool->pFreeHead = pPool->pData;
+
+	logWrite("Pool: %p, data: %p\n", pPool, pPool->pData);
+	logBlockEnd("memPoolCreate()");
+	return pPool;
+}
+
+void memPoolDestroy(tMemPool *pPool) {
+	logBlockBegin("memPoolDestroy(pPool: %p)", pPool);
+	if(pPool->uwUsedCount) {
+		logWrite(
+			"ERR: %hu elements still in use (%lu bytes each)\n",
+			pPool->uwUsedCount, pPool->ulElemSize
+		);
+	}
+	logWrite("Peak usage: %hu/%hu elements\n", pPool->uwPeakCount, pPool->uwElemCount);
+#if defined(ACE_DEBUG)
+	memFree(pPool->pUsed, pPool->uwElemCount);
+#endif
+	memFree(pPool->pData, pPool->ulElemSize * pPool->uwElemCount);
+	memFree(pPool, sizeof(*pPool));
+	logBlockEnd("memPoolDestroy()");
+}
+
+void *memPoolAlloc(tMemPool *pPool) {
+	void *pElem = pPool->pFreeHead;
+	if(!pElem) {
+#if defined(ACE_DEBUG)
+		logWrite(
+			"[MEM] ERR: Pool %p is full (%hu elements)\n", pPool, pPool->uwElemCount
+		);
+#endif
+		return 0;
+	}
+	pPool->pFreeHead = *(void**)pElem;
+	if(++pPool->uwUsedCount > pPool->uwPeakCount) {
+		pPool->uwPeakCount = pPool->uwUsedCount;
+	}
+#if defined(ACE_DEBUG)
+	pPool->pUsed[((UBYTE*)pElem - pPool->pData) / pPool->ulElemSize] = 1;
+#endif
+	return pElem;
+}
+
+void memPoolFree(tMemPool *pPool, void *pElem) {
+#if defined(ACE_DEBUG)
+	ULONG ulOffs = (UBYTE*)pElem - pPool->pData;
+	if(
+		(UBYTE*)pElem < pPool->pData ||
+		ulOffs >= pPool->ulElemSize * pPool->uwElemCount ||
+		ulOffs % pPool->ulElemSize
+	) {
+		logWrite("[MEM] ERR: %p isn't an element of pool %p\n", pElem, pPool);
+		return;
+	}
+	UWORD uwIdx = ulOffs / pPool->ulElemSize;
+	if(!pPool->pUsed[uwIdx]) {
+		logWrite("[MEM] ERR: Double free of %p in pool %p\n", pElem, pPool);
+		return;
+	}
+	pPool->pUsed[uwIdx] = 0;
+#endif
+	*(void**)pElem = pPool->pFreeHead;
+	pPool->pFreeHead = pElem;
+	--pPool->uwUsedCount;
+}
+
+//-------------------------------------------------------------------- ARENA FNS
+
+static void memArenaCreate(tMemArena *pArena, ULONG ulSize, ULONG ulMemType) {
+	pArena->pData = ulSize ? memAlloc(ulSize, ulMemType) : 0;
+	pArena->ulSize = pArena->pData ? ulSize : 0;
+	pArena->ulUsed = 0;
+	pArena->ulPeak = 0;
+}
+
+static void memArenaDestroy(tMemArena *pArena) {
+	if(pArena->pData) {
+		memFree(pArena->pData, pArena->ulSize);
+		pArena->pData = 0;
+	}
+	pArena->ulSize = 0;
+	pArena->ulUsed = 0;
+}
+
+static inline void *memArenaAlloc(tMemArena *pArena, ULONG ulSize) {
+	// Keep all allocations longword-aligned
+	ULONG ulUsed = pArena->ulUsed + ((ulSize + 3) & ~3UL);
+	if(ulUsed > pArena->ulSize) {
+		logWrite(
+			"[MEM] ERR: Frame arena %p full, can't allocate %lu bytes (used %lu/%lu)\n",
+			pArena, ulSize, pArena->ulUsed, pArena->ulSize
+		);
+		return 0;
+	}
+	void *pMem = &pArena->pData[pArena->ulUsed];
+	pArena->ulUsed = ulUsed;
+	if(ulUsed > pArena->ulPeak) {
+		pArena->ulPeak = ulUsed;
+	}
+	return pMem;
+}
+
+void memFrameArenaCreate(ULONG ulFastSize, ULONG ulChipSize) {
+	logBlockBegin(
+		"memFrameArenaCreate(ulFastSize: %lu, ulChipSize: %lu)",
+		ulFastSize, ulChipSize
+	);
+	memArenaCreate(&s_sFrameArenaFast, ulFastSize, MEMF_ANY);
+	memArenaCreate(&s_sFrameArenaChip, ulChipSize, MEMF_CHIP);
+	logBlockEnd("memFrameArenaCreate()");
+}
+
+void memFrameArenaDestroy(void) {
+	logBlockBegin("memFrameArenaDestroy()");
+	logWrite(
+		"Peak usage: CHIP: %lu/%lu, FAST: %lu/%lu\n",
+		s_sFrameArenaChip.ulPeak, s_sFrameArenaChip.ulSize,
+		s_sFrameArenaFast.ulPeak, s_sFrameArenaFast.ulSize
+	);
+	memArenaDestroy(&s_sFrameArenaFast);
+	memArenaDestroy(&s_sFrameArenaChip);
+	logBlockEnd("memFrameArenaDestroy()");
+}
+
+void memFrameReset(void) {
+	s_sFrameArenaFast.ulUsed = 0;
+	s_sFrameArenaChip.ulUsed = 0;
+}
+
+void *memFrameAllocFast(ULONG ulSize) {
+	return memArenaAlloc(&s_sFrameArenaFast, ulSize);
+}
+
+void *memFrameAllocChip(ULONG ulSize) {
+	return memArenaAlloc(&s_sFrameArenaChip, ulSize);
+}
@@ -14,6 +14,7 @@
 #include <ace/managers/system.h>
 #include <ace/utils/custom.h>
 #include <ace/utils/disk_file.h>
+#include <ace/utils/mem_file.h>
 #include <hardware/intbits.h>
 #include <hardware/dmabits.h>
 
@@ -2725,9 +2726,9 @@ static inline ULONG getClockConstant(void) {
 }
 
 static void ptplayerSfxDecompress(
-	UBYTE *pCompressed, UBYTE *pDecompressed, ULONG ulDecompressedSize
+	const UBYTE *pCompressed, UBYTE *pDecompressed, ULONG ulDecompressedSize
 ) {
-	UBYTE *pRead = pCompressed;
+	const UBYTE *pRead = pCompressed;
 	const UBYTE *pDecompressedEnd = &pDecompressed[ulDecompressedSize];
 	ULONG ulCtl;
 	BYTE bLastSample = 0;
@@ -2979,10 +2980,19 @@ tPtplayerSfx *ptplayerSfxCreateFromFd(tFile *pFileSfx, UBYTE isFast)
 		}
 
 		if(ulCompressedSize) {
-			UBYTE *pCompressed = memAllocFast(ulByteSize);
-			fileReadBytes(pFileSfx, pCompressed, ulCompressedSize);
-			ptplayerSfxDecompress(pCompressed, (UBYTE*)pSfx->pData, ulByteSize);
-			memFree(pCompressed, ulByteSize);
+			// Memory files allow decompressing straight from their buffer
+			const UBYTE *pCompressedInFile = memFileTakePtr(
+				pFileSfx, ulCompressedSize, MEMF_ANY
+			);
+			if(pCompressedInFile) {
+				ptplayerSfxDecompress(pCompressedInFile, (UBYTE*)pSfx->pData, ulByteSize);
+			}
+			else {
+				UBYTE *pCompressed = memAllocFast(ulByteSize);
+				fileReadBytes(pFileSfx, pCompressed, ulCompressedSize);
+				ptplayerSfxDecompress(pCompressed, (UBYTE*)pSfx->pData, ulByteSize);
+				memFree(pCompressed, ulByteSize);
+			}
 		}
 		else {
 			fileReadBytes(pFileSfx, (UBYTE*)pSfx->pData, ulByteSize);
@@ -3327,13 +3337,21 @@ tPtplayerSamplePack *ptplayerSampleDataCreateFromFd(tFile *pFileSamples)
 			goto fail;
 		}
 		if(ulCompressedLength) {
-			UBYTE *pCompressed = memAllocFast(ulCompressedLength);
-			if(!pCompressed) {
-				goto fail;
+			const UBYTE *pCompressedInFile = memFileTakePtr(
+				pFileSamples, ulCompressedLength, MEMF_ANY
+			);
+			if(pCompressedInFile) {
+				ptplayerSfxDecompress(pCompressedInFile, (UBYTE*)pSample->pData, pSample->uwWordLength * sizeof(UWORD));
+			}
+			else {
+				UBYTE *pCompressed = memAllocFast(ulCompressedLength);
+				if(!pCompressed) {
+					goto fail;
+				}
+				fileReadBytes(pFileSamples, pCompressed, ulCompressedLength);
+				ptplayerSfxDecompress(pCompressed, (UBYTE*)pSample->pData, pSample->uwWordLength * sizeof(UWORD));
+				memFree(pCompressed, ulCompressedLength);
 			}
-			fileReadBytes(pFileSamples, pCompressed, ulCompressedLength);
-			ptplayerSfxDecompress(pCompressed, (UBYTE*)pSample->pData, pSample->uwWordLength * sizeof(UWORD));
-			memFree(pCompressed, ulCompressedLength);
 		}
 		else {
 			fileReadBytes(pFileSamples, (UBYTE*)pSample->pData, pSample->uwWordLength * sizeof(UWORD));
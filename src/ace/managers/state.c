@@ -104,6 +104,7 @@ void statePush(tStateManager *pStateManager, tState *pState) {
 	}
 
 	logBlockEnd("statePush()");
+	logFlush();
 }
 
 void statePop(tStateManager *pStateManager) {
@@ -123,6 +124,7 @@ void statePop(tStateManager *pStateManager) {
 	}
 
 	logBlockEnd("statePop()");
+	logFlush();
 }
 
 void statePopAll(tStateManager *pStateManager) {
@@ -139,6 +141,7 @@ void statePopAll(tStateManager *pStateManager) {
 	}
 
 	logBlockEnd("statePopAll()");
+	logFlush();
 }
 
 void stateChange(tStateManager *pStateManager, tState *pState) {
@@ -171,6 +174,7 @@ void stateChange(tStateManager *pStateManager, tState *pState) {
 	}
 
 	logBlockEnd("stateChange()");
+	logFlush();
 }
 
 void stateProcess(tStateManager *pStateManager) {
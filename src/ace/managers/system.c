@@ -1310,6 +1310,7 @@ void systemDump(void) {
 }
 
 void systemIdleBegin(void) {
+	logFlushOnIdle();
 #if defined(BARTMAN_GCC)
 	debug_start_idle();
 #endif
@@ -3,6 +3,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include <ace/utils/bitmap.h>
+#include <string.h>
 #include <ace/managers/blit.h>
 #include <ace/managers/log.h>
 #include <ace/managers/memory.h>
@@ -12,6 +13,18 @@
 #include <ace/utils/custom.h>
 #include <ace/utils/disk_file.h>
 
+// Max size of buffer used for batching row reads of partial-width bitmaps
+#define BITMAP_LOAD_STAGING_SIZE 4096
+// Size of buffer for packed data read from file when unpacking ByteRun1 rows
+#define BITMAP_UNPACK_BUFFER_SIZE 1024
+
+typedef struct tBitmapUnpacker {
+	tFile *pFile;
+	UBYTE *pBuffer;
+	UWORD uwFill;
+	UWORD uwPos;
+} tBitmapUnpacker;
+
 #if defined(ACE_USE_AGA_FEATURES) && defined(ACE_DEBUG)
 static PLANEPTR bitmapAllocChipAligned(ULONG ulSize) {
 	// In ACE_DEBUG, memAllocChip user pointer is shifted by one ULONG due to
@@ -235,6 +248,143 @@ fail:
 #endif // AMIGA
 }
 
+/**
+ * @brief Reads consecutive rows from file to dest, which may have other row
+ * stride. Avoids lots of small reads by reading all rows at once if possible,
+ * or in batches through staging buffer otherwise.
+ */
+static void bitmapLoadRows(
+	tFile *pFile, UBYTE *pDest, UWORD uwRowSize, UWORD uwDestStride,
+	ULONG ulRowCount
+) {
+	if(uwRowSize == uwDestStride) {
+		fileReadBytes(pFile, pDest, uwRowSize * ulRowCount);
+		return;
+	}
+
+	UWORD uwBatchRows = MIN(ulRowCount, BITMAP_LOAD_STAGING_SIZE / uwRowSize);
+	ULONG ulStagingSize = (ULONG)uwBatchRows * uwRowSize;
+	UBYTE *pStaging = (uwBatchRows > 1) ? memAllocFast(ulStagingSize) : 0;
+	if(!pStaging) {
+		// Rows are too big for batching to help or there's no mem for staging
+		while(ulRowCount--) {
+			fileReadBytes(pFile, pDest, uwRowSize);
+			pDest += uwDestStride;
+		}
+		return;
+	}
+
+	while(ulRowCount) {
+		UWORD uwRows = MIN(ulRowCount, uwBatchRows);
+		fileReadBytes(pFile, pStaging, (ULONG)uwRows * uwRowSize);
+		const UBYTE *pSrc = pStaging;
+		for(UWORD i = uwRows; i--;) {
+			memcpy(pDest, pSrc, uwRowSize);
+			pSrc += uwRowSize;
+			pDest += uwDestStride;
+		}
+		ulRowCount -= uwRows;
+	}
+	memFree(pStaging, ulStagingSize);
+}
+
+static UBYTE bitmapUnpackerCreate(tBitmapUnpacker *pUnpacker, tFile *pFile) {
+	pUnpacker->pFile = pFile;
+	pUnpacker->pBuffer = memAllocFast(BITMAP_UNPACK_BUFFER_SIZE);
+	pUnpacker->uwFill = 0;
+	pUnpacker->uwPos = 0;
+	return pUnpacker->pBuffer != 0;
+}
+
+static void bitmapUnpackerDestroy(tBitmapUnpacker *pUnpacker) {
+	memFree(pUnpacker->pBuffer, BITMAP_UNPACK_BUFFER_SIZE);
+}
+
+/**
+ * @brief Ensures that there's at least one packed byte in unpacker's buffer.
+ * @return 1 on success, 0 if the file has ended.
+ */
+static inline UBYTE bitmapUnpackerFill(tBitmapUnpacker *pUnpacker) {
+	if(pUnpacker->uwPos < pUnpacker->uwFill) {
+		return 1;
+	}
+	pUnpacker->uwFill = fileReadBytes(
+		pUnpacker->pFile, pUnpacker->pBuffer, BITMAP_UNPACK_BUFFER_SIZE
+	);
+	pUnpacker->uwPos = 0;
+	return pUnpacker->uwFill != 0;
+}
+
+/**
+ * @brief Unpacks consecutive ByteRun1-packed rows from file straight to dest,
+ * which may have other row stride. Runs can't cross row boundaries, so only
+ * the packed data is buffered - there's no need for unpacked intermediate.
+ * @return 1 on success, 0 if packed data is truncated or malformed.
+ */
+static UBYTE bitmapUnpackRows(
+	tBitmapUnpacker *pUnpacker, UBYTE *pDest, UWORD uwRowSize,
+	UWORD uwDestStride, ULONG ulRowCount
+) {
+	while(ulRowCount--) {
+		UBYTE *pRowDest = pDest;
+		UWORD uwRowLeft = uwRowSize;
+		while(uwRowLeft) {
+			if(!bitmapUnpackerFill(pUnpacker)) {
+				return 0;
+			}
+			BYTE bControl = pUnpacker->pBuffer[pUnpacker->uwPos++];
+			if(bControl >= 0) {
+				// Copy next bControl + 1 bytes literally
+				UWORD uwCount = bControl + 1;
+				if(uwCount > uwRowLeft) {
+					return 0;
+				}
+				uwRowLeft -= uwCount;
+				while(uwCount) {
+					if(!bitmapUnpackerFill(pUnpacker)) {
+						return 0;
+					}
+					UWORD uwChunk = MIN(uwCount, pUnpacker->uwFill - pUnpacker->uwPos);
+					memcpy(pRowDest, &pUnpacker->pBuffer[pUnpacker->uwPos], uwChunk);
+					pUnpacker->uwPos += uwChunk;
+					pRowDest += uwChunk;
+					uwCount -= uwChunk;
+				}
+			}
+			else if(bControl != -128) {
+				// Repeat next byte -bControl + 1 times
+				UWORD uwCount = 1 - bControl;
+				if(uwCount > uwRowLeft || !bitmapUnpackerFill(pUnpacker)) {
+					return 0;
+				}
+				memset(pRowDest, pUnpacker->pBuffer[pUnpacker->uwPos++], uwCount);
+				pRowDest += uwCount;
+				uwRowLeft -= uwCount;
+			}
+		}
+		pDest += uwDestStride;
+	}
+	return 1;
+}
+
+/**
+ * @brief Reads rows of raw or packed .bm file, depending on whether unpacker
+ * is passed.
+ * @return 1 on success, 0 on malformed packed data.
+ */
+static UBYTE bitmapReadRows(
+	tFile *pFile, tBitmapUnpacker *pUnpacker, UBYTE *pDest, UWORD uwRowSize,
+	UWORD uwDestStride, ULONG ulRowCount
+) {
+	if(pUnpacker) {
+		return bitmapUnpackRows(
+			pUnpacker, pDest, uwRowSize, uwDestStride, ulRowCount
+		);
+	}
+	bitmapLoadRows(pFile, pDest, uwRowSize, uwDestStride, ulRowCount);
+	return 1;
+}
+
 void bitmapLoadFromPath(tBitMap *pBitMap, const char *szPath, UWORD uwStartX, UWORD uwStartY) {
 	return bitmapLoadFromFd(pBitMap, diskFileOpen(szPath, DISK_FILE_MODE_READ, 1), uwStartX, uwStartY);
 }
@@ -244,9 +394,7 @@ void bitmapLoadFromFd(
 {
 	UWORD uwSrcWidth, uwDstWidth, uwSrcHeight;
 	UBYTE ubSrcFlags, ubSrcBpp, ubSrcVersion;
-	UWORD y;
 	UWORD uwWidth;
-	UBYTE ubPlane;
 
 	systemUse();
 	logBlockBegin(
@@ -275,7 +423,7 @@ void bitmapLoadFromFd(
 	fileReadBytes(pFile, &ubSrcVersion, 1);
 	fileReadBytes(pFile, &ubSrcFlags, 1);
 	fileSeek(pFile, 2 * sizeof(UBYTE), FILE_SEEK_CURRENT); // Skip unused 2 bytes
-	if(ubSrcVersion != 0) {
+	if(ubSrcVersion != BITMAP_VERSION_RAW && ubSrcVersion != BITMAP_VERSION_BYTERUN1) {
 		fileClose(pFile);
 		logWrite("ERR: Unknown file version: %hu\n", ubSrcVersion);
 		logBlockEnd("bitmapLoadFromFd()");
@@ -323,44 +471,59 @@ void bitmapLoadFromFd(
 		return;
 	}
 
-	// Read data
+	tBitmapUnpacker sUnpacker;
+	tBitmapUnpacker *pUnpacker = 0;
+	if(ubSrcVersion == BITMAP_VERSION_BYTERUN1) {
+		if(!bitmapUnpackerCreate(&sUnpacker, pFile)) {
+			logWrite("ERR: Couldn't allocate unpack buffer\n");
+			fileClose(pFile);
+			logBlockEnd("bitmapLoadFromFd()");
+			systemUnuse();
+			return;
+		}
+		pUnpacker = &sUnpacker;
+	}
+
+	// Read data - file rows are packed, so they're contiguous in dest only
+	// when loading full-width.
 	uwWidth = bitmapGetByteWidth(pBitMap);
 	UWORD uwReadBytesPerRow = (uwSrcWidth + 7) / 8;
+	UBYTE isOk = 1;
 	if(bitmapIsInterleaved(pBitMap)) {
-		UWORD uwDestOffs = uwWidth * (uwStartY * pBitMap->Depth) + (uwStartX / 8);
-		if(uwStartX == 0 && uwSrcWidth == uwDstWidth) {
-			fileReadBytes(
-				pFile,
-				&pBitMap->Planes[0][uwDestOffs],
-				pBitMap->BytesPerRow * uwSrcHeight
+		UBYTE *pDest = &pBitMap->Planes[0][
+			(ULONG)uwWidth * uwStartY * pBitMap->Depth + (uwStartX / 8)
+		];
+		if(ubSrcBpp == pBitMap->Depth) {
+			isOk = bitmapReadRows(
+				pFile, pUnpacker, pDest, uwReadBytesPerRow, uwWidth,
+				(ULONG)uwSrcHeight * ubSrcBpp
 			);
 		}
 		else {
-			for(y = 0; y < uwSrcHeight; ++y) {
-				for(ubPlane = 0; ubPlane != pBitMap->Depth; ++ubPlane) {
-					fileReadBytes(
-						pFile,
-						&pBitMap->Planes[0][uwDestOffs],
-						uwReadBytesPerRow
-					);
-					uwDestOffs += uwWidth;
-				}
+			// Dest has more planes than file - skip the extra ones after each row
+			for(UWORD y = 0; y < uwSrcHeight && isOk; ++y) {
+				isOk = bitmapReadRows(
+					pFile, pUnpacker, pDest, uwReadBytesPerRow, uwWidth, ubSrcBpp
+				);
+				pDest += pBitMap->BytesPerRow;
 			}
 		}
 	}
 	else {
-		for(ubPlane = 0; ubPlane != pBitMap->Depth; ++ubPlane) {
-			for(y = 0; y != uwSrcHeight; ++y) {
-				UWORD uwDestOffs = uwWidth * uwStartY + (uwStartX / 8);
-				fileReadBytes(
-					pFile,
-					&pBitMap->Planes[ubPlane][uwDestOffs],
-					uwReadBytesPerRow
-				);
-				uwDestOffs += uwWidth;
-			}
+		ULONG ulDestOffs = (ULONG)uwWidth * uwStartY + (uwStartX / 8);
+		for(UBYTE ubPlane = 0; ubPlane != ubSrcBpp && isOk; ++ubPlane) {
+			isOk = bitmapReadRows(
+				pFile, pUnpacker, &pBitMap->Planes[ubPlane][ulDestOffs],
+				uwReadBytesPerRow, uwWidth, uwSrcHeight
+			);
 		}
 	}
+	if(!isOk) {
+		logWrite("ERR: Malformed packed bitmap data\n");
+	}
+	if(pUnpacker) {
+		bitmapUnpackerDestroy(pUnpacker);
+	}
 	fileClose(pFile);
 	logBlockEnd("bitmapLoadFromFd()");
 	systemUnuse();
@@ -393,7 +556,7 @@ tBitMap *bitmapCreateFromFd(tFile *pFile, UBYTE isFast) {
 	fileReadBytes(pFile, &ubVersion, 1);
 	fileReadBytes(pFile, &ubFlags, 1);
 	fileSeek(pFile, 2 * sizeof(UBYTE), SEEK_CUR); // Skip unused 2 bytes
-	if(ubVersion != 0) {
+	if(ubVersion != BITMAP_VERSION_RAW && ubVersion != BITMAP_VERSION_BYTERUN1) {
 		logWrite("ERR: Unknown file version: %hu\n", ubVersion);
 		fileClose(pFile);
 		logBlockEnd("bitmapCreateFromFd()");
@@ -401,8 +564,22 @@ tBitMap *bitmapCreateFromFd(tFile *pFile, UBYTE isFast) {
 		return 0;
 	}
 
+	tBitmapUnpacker sUnpacker;
+	tBitmapUnpacker *pUnpacker = 0;
+	if(ubVersion == BITMAP_VERSION_BYTERUN1) {
+		if(!bitmapUnpackerCreate(&sUnpacker, pFile)) {
+			logWrite("ERR: Couldn't allocate unpack buffer\n");
+			fileClose(pFile);
+			logBlockEnd("bitmapCreateFromFd()");
+			systemUnuse();
+			return 0;
+		}
+		pUnpacker = &sUnpacker;
+	}
+
 	// Init bitmap
 	UBYTE ubBitmapFlags = 0;
+	UBYTE isOk = 1;
 	if(isFast) {
 		ubBitmapFlags |= BMF_FASTMEM;
 	}
@@ -412,27 +589,56 @@ tBitMap *bitmapCreateFromFd(tFile *pFile, UBYTE isFast) {
 		);
 		if(!pBitMap) {
 			logWrite("ERR: bitmap alloc failed (%hux%hu)\n", uwWidth, uwHeight);
+			if(pUnpacker) {
+				bitmapUnpackerDestroy(pUnpacker);
+			}
 			fileClose(pFile);
 			logBlockEnd("bitmapCreateFromFd()");
 			systemUnuse();
 			return 0;
 		}
-		fileReadBytes(pFile, pBitMap->Planes[0], (uwWidth >> 3) * uwHeight * ubPlaneCount);
+		if(pUnpacker) {
+			UWORD uwByteWidth = bitmapGetByteWidth(pBitMap);
+			isOk = bitmapUnpackRows(
+				pUnpacker, pBitMap->Planes[0], uwWidth >> 3, uwByteWidth,
+				(ULONG)uwHeight * ubPlaneCount
+			);
+		}
+		else {
+			fileReadBytes(pFile, pBitMap->Planes[0], (uwWidth >> 3) * uwHeight * ubPlaneCount);
+		}
 	}
 	else {
 		pBitMap = bitmapCreate(uwWidth, uwHeight, ubPlaneCount, ubBitmapFlags);
 		if(!pBitMap) {
 			logWrite("ERR: bitmap alloc failed (%hux%hu)\n", uwWidth, uwHeight);
+			if(pUnpacker) {
+				bitmapUnpackerDestroy(pUnpacker);
+			}
 			fileClose(pFile);
 			logBlockEnd("bitmapCreateFromFd()");
 			systemUnuse();
 			return 0;
 		}
-		for (i = 0; i != ubPlaneCount; ++i) {
-			fileReadBytes(pFile, pBitMap->Planes[i], (uwWidth >> 3) * uwHeight);
+		for (i = 0; i != ubPlaneCount && isOk; ++i) {
+			if(pUnpacker) {
+				isOk = bitmapUnpackRows(
+					pUnpacker, pBitMap->Planes[i], uwWidth >> 3, pBitMap->BytesPerRow,
+					uwHeight
+				);
+			}
+			else {
+				fileReadBytes(pFile, pBitMap->Planes[i], (uwWidth >> 3) * uwHeight);
+			}
 		}
 	}
+	if(pUnpacker) {
+		bitmapUnpackerDestroy(pUnpacker);
+	}
 	fileClose(pFile);
+	if(!isOk) {
+		logWrite("ERR: Malformed packed bitmap data\n");
+	}
 
 	logWrite(
 		"Dimensions: %ux%u@%uBPP, version: %hu, flags: %hu\n",
@@ -3,22 +3,29 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include <ace/utils/disk_file.h>
+#include <stddef.h>
 #include <ace/managers/system.h>
 #include <ace/managers/memory.h>
 #include <ace/managers/log.h>
 #include <ace/utils/disk_file_private.h>
 
-#define DISK_FILE_BUFFER_SIZE 512
-
 typedef struct tDiskFileData {
 	FILE *pFileHandle;
 	tDiskFileMode eMode;
-	UBYTE pBuffer[DISK_FILE_BUFFER_SIZE];
-	UWORD uwBufferFill;
-	UWORD uwBufferReadPos;
 	UBYTE isUninterrupted;
+	UBYTE pad[3]; ///< Keeps pBuffer longword-aligned for fast copies.
+	ULONG ulBufferSize;
+	ULONG ulBufferFill;
+	ULONG ulBufferReadPos;
+	ULONG ulHandlePos; ///< Pos of OS file handle, saves ftell() calls.
+	UBYTE pBuffer[]; ///< ulBufferSize bytes long.
 } tDiskFileData;
 
+_Static_assert(
+	(offsetof(tDiskFileData, pBuffer) & 3) == 0,
+	"Disk file buffer should be longword-aligned"
+);
+
 #if !defined(ACE_FILE_USE_ONLY_DISK)
 static const tFileCallbacks s_sDiskFileCallbacks = {
 	.cbFileClose = diskFileClose,
@@ -68,14 +75,14 @@ DISKFILE_PRIVATE void diskFileClose(void *pData) {
 	if(pDiskFileData->eMode == DISK_FILE_MODE_WRITE) {
 		// write remaining data
 		fwrite(
-			pDiskFileData->pBuffer, pDiskFileData->uwBufferFill, 1,
+			pDiskFileData->pBuffer, pDiskFileData->ulBufferFill, 1,
 			pDiskFileData->pFileHandle
 		);
 		fflush(pDiskFileData->pFileHandle);
 	}
 
 	fclose(pDiskFileData->pFileHandle);
-	memFree(pDiskFileData, sizeof(*pDiskFileData));
+	memFree(pDiskFileData, sizeof(*pDiskFileData) + pDiskFileData->ulBufferSize);
 	fileAccessDisable();
 }
 
@@ -89,59 +96,57 @@ DISKFILE_PRIVATE ULONG diskFileRead(void *pData, void *pDest, ULONG ulSize) {
 	}
 
 	// copy some data from buffer
-	UWORD uwReadyBytes = pDiskFileData->uwBufferFill - pDiskFileData->uwBufferReadPos;
-	UWORD uwBytesToCopy = MIN(uwReadyBytes, ulSize);
-	if(uwBytesToCopy) {
-		for(UWORD i = 0; i < uwBytesToCopy; ++i) {
-			*(pDestBytes++) = pDiskFileData->pBuffer[pDiskFileData->uwBufferReadPos + i];
-		}
-		ulReadCount += uwBytesToCopy;
-		pDiskFileData->uwBufferReadPos += uwBytesToCopy;
-		ulSize -= uwBytesToCopy;
+	ULONG ulReadyBytes = pDiskFileData->ulBufferFill - pDiskFileData->ulBufferReadPos;
+	ULONG ulBytesToCopy = MIN(ulReadyBytes, ulSize);
+	if(ulBytesToCopy) {
+		memcpy(pDestBytes, &pDiskFileData->pBuffer[pDiskFileData->ulBufferReadPos], ulBytesToCopy);
+		pDestBytes += ulBytesToCopy;
+		ulReadCount += ulBytesToCopy;
+		pDiskFileData->ulBufferReadPos += ulBytesToCopy;
+		ulSize -= ulBytesToCopy;
 	}
 
-	if(ulSize && ulSize > DISK_FILE_BUFFER_SIZE) {
-		// if remaining data is bigger than buffer, read rest directly
+	if(ulSize >= pDiskFileData->ulBufferSize) {
+		// if remaining data is as big as buffer, read rest directly - also saves
+		// copying when reading straight to CHIP mem
 		if(!pDiskFileData->isUninterrupted) {
 			fileAccessEnable();
 		}
 		ULONG ulReadPartSize = fread(pDestBytes, 1, ulSize, pDiskFileData->pFileHandle);
-		pDestBytes += ulReadPartSize;
+		pDiskFileData->ulHandlePos += ulReadPartSize;
 		ulReadCount += ulReadPartSize;
-		ulSize -= ulReadPartSize;
+
+		// Buffer contents no longer precede handle pos, so they can't be used for
+		// seeking back
+		pDiskFileData->ulBufferFill = 0;
+		pDiskFileData->ulBufferReadPos = 0;
 
 		if(!pDiskFileData->isUninterrupted) {
 			fileAccessDisable();
 		}
 	}
+	else if(ulSize) {
+		// if not, fill the empty buffer and read remaining data from it
+		if(!pDiskFileData->isUninterrupted) {
+			fileAccessEnable();
+		}
 
-	if(ulSize) {
-		// if not, fill the buffer and read remaining data from buffer
-		if(pDiskFileData->uwBufferFill == pDiskFileData->uwBufferReadPos) {
-			if(!pDiskFileData->isUninterrupted) {
-				fileAccessEnable();
-			}
-
-			pDiskFileData->uwBufferFill = fread(
-				pDiskFileData->pBuffer, 1, DISK_FILE_BUFFER_SIZE,
-				pDiskFileData->pFileHandle
-			);
+		pDiskFileData->ulBufferFill = fread(
+			pDiskFileData->pBuffer, 1, pDiskFileData->ulBufferSize,
+			pDiskFileData->pFileHandle
+		);
+		pDiskFileData->ulHandlePos += pDiskFileData->ulBufferFill;
 
-			if(!pDiskFileData->isUninterrupted) {
-				fileAccessDisable();
-			}
-			pDiskFileData->uwBufferReadPos = 0;
+		if(!pDiskFileData->isUninterrupted) {
+			fileAccessDisable();
 		}
+		pDiskFileData->ulBufferReadPos = 0;
 
-		uwReadyBytes = pDiskFileData->uwBufferFill - pDiskFileData->uwBufferReadPos;
-		uwBytesToCopy = MIN(uwReadyBytes, ulSize);
-		if(uwBytesToCopy) {
-			for(UWORD i = 0; i < uwBytesToCopy; ++i) {
-				*(pDestBytes++) = pDiskFileData->pBuffer[i];
-			}
-			ulReadCount += uwBytesToCopy;
-			ulSize -= uwBytesToCopy;
-			pDiskFileData->uwBufferReadPos += uwBytesToCopy;
+		ulBytesToCopy = MIN(pDiskFileData->ulBufferFill, ulSize);
+		if(ulBytesToCopy) {
+			memcpy(pDestBytes, pDiskFileData->pBuffer, ulBytesToCopy);
+			ulReadCount += ulBytesToCopy;
+			pDiskFileData->ulBufferReadPos = ulBytesToCopy;
 		}
 	}
 
@@ -156,9 +161,9 @@ DISKFILE_PRIVATE ULONG diskFileWrite(void *pData, const void *pSrc, ULONG ulSize
 		logWrite("ERR: Attempting to write file not opened for write\n");
 	}
 
-	if(pDiskFileData->uwBufferFill + ulSize < DISK_FILE_BUFFER_SIZE) {
-		memcpy(&pDiskFileData->pBuffer[pDiskFileData->uwBufferFill], pSrc, ulSize);
-		pDiskFileData->uwBufferFill += ulSize;
+	if(pDiskFileData->ulBufferFill + ulSize < pDiskFileData->ulBufferSize) {
+		memcpy(&pDiskFileData->pBuffer[pDiskFileData->ulBufferFill], pSrc, ulSize);
+		pDiskFileData->ulBufferFill += ulSize;
 		ulWritten = ulSize;
 	}
 	else {
@@ -168,20 +173,25 @@ DISKFILE_PRIVATE ULONG diskFileWrite(void *pData, const void *pSrc, ULONG ulSize
 
 		// NOTE: Don't take previously buffered data into account in return value.
 		// TODO: Make sure that all was written to disk?
-		fwrite(
-			pDiskFileData->pBuffer, pDiskFileData->uwBufferFill, 1,
+		if(fwrite(
+			pDiskFileData->pBuffer, pDiskFileData->ulBufferFill, 1,
 			pDiskFileData->pFileHandle
-		);
-		pDiskFileData->uwBufferFill = 0;
+		)) {
+			pDiskFileData->ulHandlePos += pDiskFileData->ulBufferFill;
+		}
+		pDiskFileData->ulBufferFill = 0;
 
 		// Only allow small write here so that big write will go to the file directly
-		if(ulSize < DISK_FILE_BUFFER_SIZE) {
-			memcpy(&pDiskFileData->pBuffer[pDiskFileData->uwBufferFill], pSrc, ulSize);
-			pDiskFileData->uwBufferFill = ulSize;
+		if(ulSize < pDiskFileData->ulBufferSize) {
+			memcpy(&pDiskFileData->pBuffer[pDiskFileData->ulBufferFill], pSrc, ulSize);
+			pDiskFileData->ulBufferFill = ulSize;
 			ulWritten = ulSize;
 		}
 		else {
 			ulWritten = fwrite(pSrc, ulSize, 1, pDiskFileData->pFileHandle);
+			if(ulWritten) {
+				pDiskFileData->ulHandlePos += ulSize;
+			}
 		}
 
 		if(!pDiskFileData->isUninterrupted) {
@@ -195,22 +205,22 @@ DISKFILE_PRIVATE ULONG diskFileWrite(void *pData, const void *pSrc, ULONG ulSize
 DISKFILE_PRIVATE ULONG diskFileSeek(void *pData, LONG lPos, WORD wMode) {
 	tDiskFileData *pDiskFileData = (tDiskFileData*)pData;
 
-	if(wMode == SEEK_SET) {
+	if(pDiskFileData->eMode == DISK_FILE_MODE_READ && wMode == SEEK_SET) {
 		LONG lDelta = lPos - diskFileGetPos(pData);
 		if(
-			(lDelta <= 0 && -lDelta < pDiskFileData->uwBufferReadPos) ||
-			(lDelta > 0 && lDelta < pDiskFileData->uwBufferFill - pDiskFileData->uwBufferReadPos)
+			(lDelta <= 0 && -lDelta < (LONG)pDiskFileData->ulBufferReadPos) ||
+			(lDelta > 0 && lDelta < (LONG)(pDiskFileData->ulBufferFill - pDiskFileData->ulBufferReadPos))
 		) {
-			pDiskFileData->uwBufferReadPos += lDelta;
+			pDiskFileData->ulBufferReadPos += lDelta;
 			return 0;
 		}
 	}
 
-	if(wMode == SEEK_CUR && (
-		(lPos > 0 && lPos < pDiskFileData->uwBufferFill - pDiskFileData->uwBufferReadPos) ||
-		(lPos < pDiskFileData->uwBufferReadPos)
+	if(pDiskFileData->eMode == DISK_FILE_MODE_READ && wMode == SEEK_CUR && (
+		(lPos > 0 && lPos < (LONG)(pDiskFileData->ulBufferFill - pDiskFileData->ulBufferReadPos)) ||
+		(lPos <= 0 && -lPos < (LONG)pDiskFileData->ulBufferReadPos)
 	)) {
-		pDiskFileData->uwBufferReadPos += lPos;
+		pDiskFileData->ulBufferReadPos += lPos;
 		return 0;
 	}
 
@@ -223,12 +233,27 @@ DISKFILE_PRIVATE ULONG diskFileSeek(void *pData, LONG lPos, WORD wMode) {
 		wMode = SEEK_SET;
 		lPos += diskFileGetPos(pData);
 	}
+	if(pDiskFileData->eMode == DISK_FILE_MODE_WRITE && pDiskFileData->ulBufferFill) {
+		// Pending data must land before the handle moves
+		fwrite(
+			pDiskFileData->pBuffer, pDiskFileData->ulBufferFill, 1,
+			pDiskFileData->pFileHandle
+		);
+	}
 
 	ULONG ulResult = fseek(pDiskFileData->pFileHandle, lPos, wMode);
-	if(pDiskFileData->uwBufferFill) {
-		logWrite("WARN: slow - read buffer discard\n");
-		pDiskFileData->uwBufferReadPos = 0;
-		pDiskFileData->uwBufferFill = 0;
+	if(wMode == SEEK_SET && !ulResult) {
+		pDiskFileData->ulHandlePos = lPos;
+	}
+	else {
+		pDiskFileData->ulHandlePos = ftell(pDiskFileData->pFileHandle);
+	}
+	if(pDiskFileData->ulBufferFill) {
+		if(pDiskFileData->eMode == DISK_FILE_MODE_READ) {
+			logWrite("WARN: slow - read buffer discard\n");
+		}
+		pDiskFileData->ulBufferReadPos = 0;
+		pDiskFileData->ulBufferFill = 0;
 	}
 
 	if(!pDiskFileData->isUninterrupted) {
@@ -241,17 +266,14 @@ DISKFILE_PRIVATE ULONG diskFileSeek(void *pData, LONG lPos, WORD wMode) {
 DISKFILE_PRIVATE ULONG diskFileGetPos(void *pData) {
 	tDiskFileData *pDiskFileData = (tDiskFileData*)pData;
 
-	if(!pDiskFileData->isUninterrupted) {
-		fileAccessEnable();
+	// Handle pos is tracked, so there's no need to wake up the OS for ftell()
+	ULONG ulResult = pDiskFileData->ulHandlePos;
+	if(pDiskFileData->eMode == DISK_FILE_MODE_WRITE) {
+		ulResult += pDiskFileData->ulBufferFill;
 	}
-
-	ULONG ulResult = ftell(pDiskFileData->pFileHandle);
-	ulResult -= pDiskFileData->uwBufferFill - pDiskFileData->uwBufferReadPos;
-
-	if(!pDiskFileData->isUninterrupted) {
-		fileAccessDisable();
+	else {
+		ulResult -= pDiskFileData->ulBufferFill - pDiskFileData->ulBufferReadPos;
 	}
-
 	return ulResult;
 }
 
@@ -287,7 +309,7 @@ DISKFILE_PRIVATE UBYTE diskFileIsEof(void *pData) {
 	}
 
 	UBYTE isEof = (
-		(pDiskFileData->uwBufferReadPos == pDiskFileData->uwBufferFill) &&
+		(pDiskFileData->ulBufferReadPos == pDiskFileData->ulBufferFill) &&
 		feof(pDiskFileData->pFileHandle)
 	);
 
@@ -315,10 +337,26 @@ DISKFILE_PRIVATE void diskFileFlush(void *pData) {
 //------------------------------------------------------------------- PUBLIC FNS
 
 tFile *diskFileOpen(const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupted) {
+	return diskFileOpenBuffered(
+		szPath, eMode, isUninterrupted, DISK_FILE_BUFFER_SIZE_DEFAULT
+	);
+}
+
+tFile *diskFileOpenBuffered(
+	const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupted,
+	ULONG ulBufferSize
+) {
 	logBlockBegin(
-		"diskFileOpen(szPath: '%s', eMode: %d, isUninterrupted: %hhu)",
-		szPath, eMode, isUninterrupted
+		"diskFileOpenBuffered(szPath: '%s', eMode: %d, isUninterrupted: %hhu, ulBufferSize: %lu)",
+		szPath, eMode, isUninterrupted, ulBufferSize
 	);
+	if(ulBufferSize < DISK_FILE_BUFFER_SIZE_MIN || ulBufferSize > DISK_FILE_BUFFER_SIZE_MAX) {
+		logWrite(
+			"WARN: Buffer size out of range %u..%lu\n",
+			DISK_FILE_BUFFER_SIZE_MIN, DISK_FILE_BUFFER_SIZE_MAX
+		);
+		ulBufferSize = CLAMP(ulBufferSize, DISK_FILE_BUFFER_SIZE_MIN, DISK_FILE_BUFFER_SIZE_MAX);
+	}
 	// TODO check if disk is read protected when szMode has 'a'/'r'/'x'
 	// TODO: disable buffering in a/w/x modes
 	fileAccessEnable();
@@ -329,11 +367,13 @@ tFile *diskFileOpen(const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupt
 		fileAccessDisable();
 	}
 	else {
-		tDiskFileData *pData = memAllocFast(sizeof(*pData));
+		tDiskFileData *pData = memAllocFast(sizeof(*pData) + ulBufferSize);
 		pData->pFileHandle = pFileHandle;
 		pData->eMode = eMode;
-		pData->uwBufferFill = 0;
-		pData->uwBufferReadPos = 0;
+		pData->ulBufferSize = ulBufferSize;
+		pData->ulBufferFill = 0;
+		pData->ulBufferReadPos = 0;
+		pData->ulHandlePos = 0;
 		pData->isUninterrupted = isUninterrupted;
 #if defined(ACE_FILE_USE_ONLY_DISK) // TODO: verify if still viable
 		pFile = (tFile*)pData;
@@ -347,7 +387,7 @@ tFile *diskFileOpen(const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupt
 			fileAccessDisable();
 		}
 	}
-	logBlockEnd("diskFileOpen()");
+	logBlockEnd("diskFileOpenBuffered()");
 	return pFile;
 }
 
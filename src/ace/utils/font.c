@@ -3,6 +3,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include <proto/graphics.h> // Bartman's compiler needs this
+#include <string.h>
 #include <ace/macros.h>
 #include <ace/managers/system.h>
 #include <ace/utils/font.h>
@@ -100,6 +101,11 @@ tTextBitMap *fontCreateTextBitMap(UWORD uwWidth, UWORD uwHeight) {
 	// Mark pTextBitMap as without any text
 	pTextBitMap->uwActualWidth = 0;
 	pTextBitMap->uwActualHeight = 0;
+	pTextBitMap->pColorBitMap = 0;
+	pTextBitMap->pMaskBitMap = 0;
+	pTextBitMap->ubColorCached = 0;
+	pTextBitMap->isColorValid = 0;
+	pTextBitMap->isMaskValid = 0;
 	logBlockEnd("fontCreateTextBitmap()");
 	systemUnuse();
 	return pTextBitMap;
@@ -116,6 +122,39 @@ fail:
 	return 0;
 }
 
+tTextBitMap *fontCreateTextBitMapInterleaved(
+	UWORD uwWidth, UWORD uwHeight, UBYTE ubDepth
+) {
+	systemUse();
+	logBlockBegin(
+		"fontCreateTextBitMapInterleaved(uwWidth: %hu, uwHeight: %hu, ubDepth: %hhu)",
+		uwWidth, uwHeight, ubDepth
+	);
+
+	tTextBitMap *pTextBitMap = fontCreateTextBitMap(uwWidth, uwHeight);
+	if(!pTextBitMap) {
+		logBlockEnd("fontCreateTextBitMapInterleaved()");
+		systemUnuse();
+		return 0;
+	}
+
+	pTextBitMap->pColorBitMap = bitmapCreate(
+		uwWidth, uwHeight, ubDepth, BMF_INTERLEAVED
+	);
+	pTextBitMap->pMaskBitMap = bitmapCreate(
+		uwWidth, uwHeight, ubDepth, BMF_INTERLEAVED
+	);
+	if(!pTextBitMap->pColorBitMap || !pTextBitMap->pMaskBitMap) {
+		logWrite("ERR: Couldn't alloc interleaved buffers\n");
+		fontDestroyTextBitMap(pTextBitMap);
+		pTextBitMap = 0;
+	}
+
+	logBlockEnd("fontCreateTextBitMapInterleaved()");
+	systemUnuse();
+	return pTextBitMap;
+}
+
 UBYTE fontTextFitsInTextBitmap(
 	const tFont *pFont, const tTextBitMap *pTextBitmap, const char *szText
 ) {
@@ -233,15 +272,162 @@ void fontFillTextBitMap(
 	tUwCoordYX sBounds = fontDrawStr1bpp(pFont, pTextBitMap->pBitMap, 0, 0, szText);
 	pTextBitMap->uwActualWidth = sBounds.uwX;
 	pTextBitMap->uwActualHeight = sBounds.uwY;
+	pTextBitMap->isColorValid = 0;
+	pTextBitMap->isMaskValid = 0;
 }
 
 void fontDestroyTextBitMap(tTextBitMap *pTextBitMap) {
 	systemUse();
+	if(pTextBitMap->pColorBitMap) {
+		bitmapDestroy(pTextBitMap->pColorBitMap);
+	}
+	if(pTextBitMap->pMaskBitMap) {
+		bitmapDestroy(pTextBitMap->pMaskBitMap);
+	}
 	bitmapDestroy(pTextBitMap->pBitMap);
 	memFree(pTextBitMap, sizeof(tTextBitMap));
 	systemUnuse();
 }
 
+/**
+ * @brief Copies text onto bitplanes of interleaved buffer selected
+ * by ubPlaneMask and clears the rest of them.
+ */
+static void fontSpreadTextBitMap(
+	const tTextBitMap *pTextBitMap, tBitMap *pDest, UBYTE ubPlaneMask
+) {
+	tBitMap sPlaneDest;
+	sPlaneDest.BytesPerRow = pDest->BytesPerRow;
+	sPlaneDest.Rows = pDest->Rows;
+	sPlaneDest.Depth = 1;
+	sPlaneDest.Planes[0] = pDest->Planes[0];
+
+	tBlitPlan sPlan;
+	blitPlanInit(
+		&sPlan, pTextBitMap->pBitMap, 0, 0, &sPlaneDest, 0,
+		pTextBitMap->uwActualWidth, pTextBitMap->uwActualHeight, MINTERM_COPY, 0
+	);
+	for(UBYTE i = 0; i < pDest->Depth; ++i) {
+		sPlaneDest.Planes[0] = pDest->Planes[i];
+		blitPlanSetMinterm(&sPlan, (ubPlaneMask & BV(i)) ? MINTERM_COPY : 0x00);
+		blitPlanExecute(&sPlan, &sPlaneDest, 0, 0);
+	}
+}
+
+/**
+ * @brief Draws text on all bitplanes of interleaved bitmap with single blit,
+ * using text bitmap's interleaved buffers.
+ */
+static void fontDrawTextBitMapInterleaved(
+	tBitMap *pDest, tTextBitMap *pTextBitMap,
+	UWORD uwX, UWORD uwY, UBYTE ubColor, UBYTE isCookie
+) {
+	UBYTE ubAllPlanes = BV(pDest->Depth) - 1;
+	ubColor &= ubAllPlanes;
+
+	const tBitMap *pSrc;
+	const UBYTE *pMsk = 0;
+	UBYTE ubMinterm;
+	if(isCookie && (ubColor == 0 || ubColor == ubAllPlanes)) {
+		// Same operation on all bitplanes - only the text shape is needed
+		if(!pTextBitMap->isMaskValid) {
+			fontSpreadTextBitMap(pTextBitMap, pTextBitMap->pMaskBitMap, ubAllPlanes);
+			pTextBitMap->isMaskValid = 1;
+		}
+		pSrc = pTextBitMap->pMaskBitMap;
+		ubMinterm = ubColor ? 0xEA : 0x2A;
+	}
+	else {
+		if(!pTextBitMap->isColorValid || pTextBitMap->ubColorCached != ubColor) {
+			fontSpreadTextBitMap(pTextBitMap, pTextBitMap->pColorBitMap, ubColor);
+			pTextBitMap->ubColorCached = ubColor;
+			pTextBitMap->isColorValid = 1;
+		}
+		pSrc = pTextBitMap->pColorBitMap;
+		if(isCookie) {
+			// Text shape selects between colored text and background
+			if(!pTextBitMap->isMaskValid) {
+				fontSpreadTextBitMap(pTextBitMap, pTextBitMap->pMaskBitMap, ubAllPlanes);
+				pTextBitMap->isMaskValid = 1;
+			}
+			pMsk = pTextBitMap->pMaskBitMap->Planes[0];
+			ubMinterm = MINTERM_COOKIE;
+		}
+		else {
+			ubMinterm = MINTERM_COPY;
+		}
+	}
+
+	if(!blitCheck(
+		pSrc, 0, 0, pDest, uwX, uwY,
+		pTextBitMap->uwActualWidth, pTextBitMap->uwActualHeight,
+		__LINE__, __FILE__
+	)) {
+		return;
+	}
+
+	tBlitPlan sPlan;
+	blitPlanInit(
+		&sPlan, pSrc, 0, 0, pDest, uwX & 0xF,
+		pTextBitMap->uwActualWidth, pTextBitMap->uwActualHeight, ubMinterm, pMsk
+	);
+	blitPlanExecute(&sPlan, pDest, uwX, uwY);
+}
+
+/**
+ * @brief Draws horizontal span of text bitmap with one blit per bitplane.
+ *
+ * @param ubMintermSet Minterm for bitplanes set in ubColor.
+ * @param ubMintermClear Minterm for the other bitplanes. MINTERM_C leaves them
+ * intact, so they're skipped entirely.
+ */
+static void fontDrawTextBitMapPlanes(
+	tBitMap *pDest, tTextBitMap *pTextBitMap, UWORD uwSrcX,
+	UWORD uwX, UWORD uwY, UWORD uwWidth, UBYTE ubColor,
+	UBYTE ubMintermSet, UBYTE ubMintermClear
+) {
+	// Helper destination bitmap
+#if defined(AMIGA)
+	s_sTmpDest.BytesPerRow = pDest->BytesPerRow;
+	s_sTmpDest.Rows = pDest->Rows;
+	s_sTmpDest.Depth = 1;
+	s_sTmpDest.Planes[0] = pDest->Planes[0];
+#else
+#error "Something is missing here!"
+#endif
+
+	if(!blitCheck(
+		pTextBitMap->pBitMap, uwSrcX, 0, &s_sTmpDest, uwX, uwY,
+		uwWidth, pTextBitMap->uwActualHeight,
+		__LINE__, __FILE__
+	)) {
+		return;
+	}
+
+	// All bitplanes share the blit geometry - only minterm & plane differ
+	tBlitPlan sPlan;
+	blitPlanInit(
+		&sPlan, pTextBitMap->pBitMap, uwSrcX, 0, &s_sTmpDest, uwX & 0xF,
+		uwWidth, pTextBitMap->uwActualHeight, MINTERM_COPY, 0
+	);
+
+	// Text-drawing loop
+	for (UBYTE i = 0; i != pDest->Depth; ++i) {
+		// Determine minterm for given bitplane
+		UBYTE ubMinterm = ubColor & 1 ? ubMintermSet : ubMintermClear;
+		if(ubMinterm == MINTERM_C) {
+			ubColor >>= 1;
+			continue;
+		}
+
+		// Blit on given bitplane
+		s_sTmpDest.Planes[0] = pDest->Planes[i];
+		blitPlanSetMinterm(&sPlan, ubMinterm);
+		blitPlanExecute(&sPlan, &s_sTmpDest, uwX, uwY);
+		ubColor >>= 1;
+	}
+}
+
 void fontDrawTextBitMap(
 	tBitMap *pDest, tTextBitMap *pTextBitMap,
 	UWORD uwX, UWORD uwY, UBYTE ubColor, UBYTE ubFlags
@@ -272,47 +458,34 @@ void fontDrawTextBitMap(
 		fontDrawTextBitMap(pDest, pTextBitMap, uwX, uwY+1, 0, FONT_COOKIE);
 	}
 
-	// Helper destination bitmap
-#if defined(AMIGA)
-	s_sTmpDest.BytesPerRow = pDest->BytesPerRow;
-	s_sTmpDest.Rows = pDest->Rows;
-	s_sTmpDest.Depth = 1;
-#else
-#error "Something is missing here!"
-#endif
-
-	// Text-drawing loop
-	UBYTE isCookie = ubFlags & FONT_COOKIE;
-	UBYTE isLazy = ubFlags & FONT_LAZY;
-	UBYTE ubMinterm;
-	for (UBYTE i = 0; i != pDest->Depth; ++i) {
-		// Determine minterm for given bitplane
-		if(isCookie) {
-			ubMinterm = ubColor & 1 ? 0xEA : 0x2A;
-		}
-		else {
-			if(ubColor & 1) {
-				ubMinterm = MINTERM_COPY;
-			}
-			else {
-				if(isLazy) {
-					ubColor >>= 1;
-					continue;
-				}
-				ubMinterm = 0x00;
-			}
-		}
-
-		// Blit on given bitplane
-		// OPTIMIZE: blitCopy does lots of calculations which are essentially the
-		// same for all bitplanes since they share dimensions. Get rid of it.
-		s_sTmpDest.Planes[0] = pDest->Planes[i];
-		blitCopy(
-			pTextBitMap->pBitMap, 0, 0, &s_sTmpDest, uwX, uwY,
-			pTextBitMap->uwActualWidth, pTextBitMap->uwActualHeight, ubMinterm
+	// Lazy drawing must leave bitplanes unused by color intact, so it can only
+	// be done with single blit if color uses all of them
+	if(
+		pTextBitMap->pColorBitMap && bitmapIsInterleaved(pDest) &&
+		pDest->Depth == pTextBitMap->pColorBitMap->Depth && (
+			!(ubFlags & FONT_LAZY) || (ubFlags & FONT_COOKIE) ||
+			(ubColor & (BV(pDest->Depth) - 1)) == BV(pDest->Depth) - 1
+		)
+	) {
+		fontDrawTextBitMapInterleaved(
+			pDest, pTextBitMap, uwX, uwY, ubColor, ubFlags & FONT_COOKIE
 		);
-		ubColor >>= 1;
+		return;
+	}
+
+	UBYTE ubMintermSet, ubMintermClear;
+	if(ubFlags & FONT_COOKIE) {
+		ubMintermSet = 0xEA;
+		ubMintermClear = 0x2A;
+	}
+	else {
+		ubMintermSet = MINTERM_COPY;
+		ubMintermClear = (ubFlags & FONT_LAZY) ? MINTERM_C : 0x00;
 	}
+	fontDrawTextBitMapPlanes(
+		pDest, pTextBitMap, 0, uwX, uwY, pTextBitMap->uwActualWidth,
+		ubColor, ubMintermSet, ubMintermClear
+	);
 }
 
 void fontDrawStr(
@@ -325,3 +498,232 @@ void fontDrawStr(
 	fontFillTextBitMap(pFont, pTextBitMap, szText);
 	fontDrawTextBitMap(pDest, pTextBitMap, uwX, uwY, ubColor, ubFlags);
 }
+
+static ULONG fontGetTextCacheStateSize(UBYTE ubMaxLength) {
+	// Keep glyph positions of the next state word-aligned
+	return ((ubMaxLength + 1) * sizeof(UWORD) + ubMaxLength + 1) & ~1;
+}
+
+/**
+ * @brief Finds the glyph range and pixel span which differ between two text
+ * states. Glyphs before the first change are the same and at same positions,
+ * so are the trailing ones which didn't move.
+ *
+ * @return 1 if any pixel may differ, otherwise 0.
+ */
+static UBYTE fontGetTextCacheSpan(
+	const tTextCacheState *pOld, const tTextCacheState *pNew,
+	UBYTE *pFirst, UBYTE *pEndNew, UWORD *pStartX, UWORD *pEndX
+) {
+	UBYTE ubMinLength = MIN(pOld->ubLength, pNew->ubLength);
+	UBYTE ubFirst = 0;
+	while(
+		ubFirst < ubMinLength && pOld->pChars[ubFirst] == pNew->pChars[ubFirst]
+	) {
+		++ubFirst;
+	}
+
+	UBYTE ubEndOld = pOld->ubLength;
+	UBYTE ubEndNew = pNew->ubLength;
+	while(
+		ubEndOld > ubFirst && ubEndNew > ubFirst &&
+		pOld->pChars[ubEndOld - 1] == pNew->pChars[ubEndNew - 1] &&
+		pOld->pGlyphX[ubEndOld - 1] == pNew->pGlyphX[ubEndNew - 1]
+	) {
+		--ubEndOld;
+		--ubEndNew;
+	}
+
+	*pFirst = ubFirst;
+	*pEndNew = ubEndNew;
+	*pStartX = pNew->pGlyphX[ubFirst];
+	*pEndX = MAX(pOld->pGlyphX[ubEndOld], pNew->pGlyphX[ubEndNew]);
+	return *pEndX > *pStartX;
+}
+
+static void fontCopyTextCacheState(
+	tTextCacheState *pDst, const tTextCacheState *pSrc
+) {
+	memcpy(pDst->pChars, pSrc->pChars, pSrc->ubLength);
+	memcpy(pDst->pGlyphX, pSrc->pGlyphX, (pSrc->ubLength + 1) * sizeof(UWORD));
+	pDst->ubLength = pSrc->ubLength;
+}
+
+tTextCache *fontCreateTextCache(
+	const tFont *pFont, UWORD uwWidth, UBYTE ubMaxLength
+) {
+	logBlockBegin(
+		"fontCreateTextCache(pFont: %p, uwWidth: %hu, ubMaxLength: %hhu)",
+		pFont, uwWidth, ubMaxLength
+	);
+
+	tTextCache *pCache = memAllocFastClear(sizeof(*pCache));
+	if(!pCache) {
+		goto fail;
+	}
+	pCache->pFont = pFont;
+	pCache->ubMaxLength = ubMaxLength;
+
+	pCache->pTextBitMap = fontCreateTextBitMap(uwWidth, pFont->uwHeight);
+	if(!pCache->pTextBitMap) {
+		goto fail;
+	}
+
+	// Current, next & per-slot states share single allocation
+	ULONG ulStateSize = fontGetTextCacheStateSize(ubMaxLength);
+	pCache->pStateData = memAllocFast(ulStateSize * (2 + FONT_TEXT_CACHE_SLOTS));
+	if(!pCache->pStateData) {
+		goto fail;
+	}
+	tTextCacheState *pStates[2 + FONT_TEXT_CACHE_SLOTS] = {
+		&pCache->sCurr, &pCache->sNext
+	};
+	for(UBYTE i = 0; i < FONT_TEXT_CACHE_SLOTS; ++i) {
+		pStates[2 + i] = &pCache->pSlots[i].sState;
+	}
+	UBYTE *pData = pCache->pStateData;
+	for(UBYTE i = 0; i < 2 + FONT_TEXT_CACHE_SLOTS; ++i) {
+		pStates[i]->pGlyphX = (UWORD*)pData;
+		pStates[i]->pChars = (char*)&pData[(ubMaxLength + 1) * sizeof(UWORD)];
+		pStates[i]->pGlyphX[0] = 0;
+		pStates[i]->ubLength = 0;
+		pData += ulStateSize;
+	}
+
+	logBlockEnd("fontCreateTextCache()");
+	return pCache;
+
+fail:
+	logWrite("ERR: Couldn't create text cache\n");
+	if(pCache) {
+		if(pCache->pTextBitMap) {
+			fontDestroyTextBitMap(pCache->pTextBitMap);
+		}
+		memFree(pCache, sizeof(*pCache));
+	}
+	logBlockEnd("fontCreateTextCache()");
+	return 0;
+}
+
+void fontDestroyTextCache(tTextCache *pCache) {
+	logBlockBegin("fontDestroyTextCache(pCache: %p)", pCache);
+	memFree(
+		pCache->pStateData,
+		fontGetTextCacheStateSize(pCache->ubMaxLength) * (2 + FONT_TEXT_CACHE_SLOTS)
+	);
+	fontDestroyTextBitMap(pCache->pTextBitMap);
+	memFree(pCache, sizeof(*pCache));
+	logBlockEnd("fontDestroyTextCache()");
+}
+
+void fontFillTextCache(tTextCache *pCache, const char *szText) {
+	const tFont *pFont = pCache->pFont;
+	tTextCacheState *pNext = &pCache->sNext;
+	UWORD uwX = 0;
+	UBYTE ubLength = 0;
+	for(const char *p = szText; *p; ++p) {
+		if(ubLength >= pCache->ubMaxLength) {
+			logWrite(
+				"ERR: Text '%s' exceeds text cache length %hhu\n",
+				szText, pCache->ubMaxLength
+			);
+			break;
+		}
+		pNext->pChars[ubLength] = *p;
+		pNext->pGlyphX[ubLength] = uwX;
+		uwX += fontGlyphWidth(pFont, *p) + 1;
+		++ubLength;
+	}
+	pNext->pGlyphX[ubLength] = uwX;
+	pNext->ubLength = ubLength;
+
+#if defined(ACE_DEBUG)
+	if(uwX > bitmapGetByteWidth(pCache->pTextBitMap->pBitMap) * 8) {
+		logWrite(
+			"ERR: Text '%s' doesn't fit in text cache, needs width %hu\n",
+			szText, uwX
+		);
+		return;
+	}
+#endif
+
+	// Re-render only the changed glyphs, clearing leftovers of the old ones
+	UBYTE ubFirst, ubEndNew;
+	UWORD uwStartX, uwEndX;
+	if(fontGetTextCacheSpan(
+		&pCache->sCurr, pNext, &ubFirst, &ubEndNew, &uwStartX, &uwEndX
+	)) {
+		tTextBitMap *pTextBitMap = pCache->pTextBitMap;
+		blitRect(
+			pTextBitMap->pBitMap, uwStartX, 0, uwEndX - uwStartX, pFont->uwHeight, 0
+		);
+		for(UBYTE i = ubFirst; i < ubEndNew; ++i) {
+			UBYTE ubGlyphWidth = fontGlyphWidth(pFont, pNext->pChars[i]);
+			if(ubGlyphWidth) {
+				blitCopy(
+					pFont->pRawData, pFont->pCharOffsets[(UBYTE)pNext->pChars[i]], 0,
+					pTextBitMap->pBitMap, pNext->pGlyphX[i], 0,
+					ubGlyphWidth, pFont->uwHeight, MINTERM_COOKIE
+				);
+			}
+		}
+		pTextBitMap->uwActualWidth = uwX;
+		pTextBitMap->uwActualHeight = pFont->uwHeight;
+	}
+
+	tTextCacheState sPrev = pCache->sCurr;
+	pCache->sCurr = *pNext;
+	pCache->sNext = sPrev;
+}
+
+void fontDrawTextCache(
+	tTextCache *pCache, tBitMap *pDest, UWORD uwX, UWORD uwY, UBYTE ubColor
+) {
+	tTextCacheSlot *pSlot = 0;
+	for(UBYTE i = 0; i < FONT_TEXT_CACHE_SLOTS; ++i) {
+		if(pCache->pSlots[i].pDest == pDest) {
+			pSlot = &pCache->pSlots[i];
+			break;
+		}
+	}
+
+	UBYTE ubFirst, ubEndNew;
+	UWORD uwStartX, uwEndX;
+	if(
+		pSlot && pSlot->uwX == uwX && pSlot->uwY == uwY &&
+		pSlot->ubColor == ubColor
+	) {
+		if(!fontGetTextCacheSpan(
+			&pSlot->sState, &pCache->sCurr, &ubFirst, &ubEndNew, &uwStartX, &uwEndX
+		)) {
+			return;
+		}
+	}
+	else {
+		// Unknown contents of the destination - redraw whole text
+		uwStartX = 0;
+		uwEndX = pCache->sCurr.pGlyphX[pCache->sCurr.ubLength];
+		if(!pSlot) {
+			pSlot = &pCache->pSlots[pCache->ubNextSlot];
+			pCache->ubNextSlot = (pCache->ubNextSlot + 1) % FONT_TEXT_CACHE_SLOTS;
+			pSlot->pDest = pDest;
+		}
+		else if(pSlot->uwX == uwX && pSlot->uwY == uwY) {
+			// Only color has changed - also clear the rest of previous, longer text
+			uwEndX = MAX(uwEndX, pSlot->sState.pGlyphX[pSlot->sState.ubLength]);
+		}
+		pSlot->uwX = uwX;
+		pSlot->uwY = uwY;
+		pSlot->ubColor = ubColor;
+	}
+
+	if(uwEndX > uwStartX) {
+		// Span may share words with unchanged glyphs, so pixels outside
+		// of it must be kept, unlike on regular opaque draw
+		fontDrawTextBitMapPlanes(
+			pDest, pCache->pTextBitMap, uwStartX, uwX + uwStartX, uwY,
+			uwEndX - uwStartX, ubColor, MINTERM_COOKIE, MINTERM_NA_AND_C
+		);
+	}
+	fontCopyTextCacheState(&pSlot->sState, &pCache->sCurr);
+}
@@ -0,0 +1,155 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ace/utils/mem_file.h>
+#include <string.h>
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+
+#if !defined(ACE_FILE_USE_ONLY_DISK)
+
+typedef struct tMemFileData {
+	const UBYTE *pData;
+	ULONG ulSize;
+	ULONG ulPos;
+	UBYTE ubMemType; ///< Cached result of memType() on pData.
+} tMemFileData;
+
+static void memFileClose(void *pData);
+static ULONG memFileRead(void *pData, void *pDest, ULONG ulSize);
+static ULONG memFileWrite(UNUSED_ARG void *pData, UNUSED_ARG const void *pSrc, UNUSED_ARG ULONG ulSize);
+static ULONG memFileSeek(void *pData, LONG lPos, WORD wMode);
+static ULONG memFileGetPos(void *pData);
+static ULONG memFileGetSize(void *pData);
+static UBYTE memFileIsEof(void *pData);
+static void memFileFlush(UNUSED_ARG void *pData);
+
+static const tFileCallbacks s_sMemFileCallbacks = {
+	.cbFileClose = memFileClose,
+	.cbFileRead = memFileRead,
+	.cbFileWrite = memFileWrite,
+	.cbFileSeek = memFileSeek,
+	.cbFileGetPos = memFileGetPos,
+	.cbFileGetSize = memFileGetSize,
+	.cbFileIsEof = memFileIsEof,
+	.cbFileFlush = memFileFlush,
+};
+
+//------------------------------------------------------------------ PRIVATE FNS
+
+static void memFileClose(void *pData) {
+	memFree(pData, sizeof(tMemFileData));
+}
+
+static ULONG memFileRead(void *pData, void *pDest, ULONG ulSize) {
+	tMemFileData *pMemFileData = (tMemFileData*)pData;
+
+	// Enforce upper bound of the file size
+	ULONG ulRemaining = pMemFileData->ulSize - pMemFileData->ulPos;
+	if(ulRemaining < ulSize) {
+		ulSize = ulRemaining;
+	}
+
+	memcpy(pDest, &pMemFileData->pData[pMemFileData->ulPos], ulSize);
+	pMemFileData->ulPos += ulSize;
+	return ulSize;
+}
+
+static ULONG memFileWrite(
+	UNUSED_ARG void *pData, UNUSED_ARG const void *pSrc, UNUSED_ARG ULONG ulSize
+) {
+	logWrite("ERR: Unsupported: memFileWrite()\n");
+	return 0;
+}
+
+static ULONG memFileSeek(void *pData, LONG lPos, WORD wMode) {
+	tMemFileData *pMemFileData = (tMemFileData*)pData;
+
+	if(wMode == FILE_SEEK_SET) {
+		pMemFileData->ulPos = lPos;
+	}
+	else if(wMode == FILE_SEEK_CURRENT) {
+		pMemFileData->ulPos += lPos;
+	}
+	else if(wMode == FILE_SEEK_END) {
+		pMemFileData->ulPos = pMemFileData->ulSize + lPos;
+	}
+
+	if(pMemFileData->ulPos > pMemFileData->ulSize) {
+		logWrite("ERR: Seek position %lu out of range %lu for memFile data %p\n",
+			pMemFileData->ulPos, pMemFileData->ulSize, pMemFileData
+		);
+		pMemFileData->ulPos = pMemFileData->ulSize;
+		return 0;
+	}
+	return 1;
+}
+
+static ULONG memFileGetPos(void *pData) {
+	tMemFileData *pMemFileData = (tMemFileData*)pData;
+
+	return pMemFileData->ulPos;
+}
+
+static ULONG memFileGetSize(void *pData) {
+	tMemFileData *pMemFileData = (tMemFileData*)pData;
+
+	return pMemFileData->ulSize;
+}
+
+static UBYTE memFileIsEof(void *pData) {
+	tMemFileData *pMemFileData = (tMemFileData*)pData;
+
+	return pMemFileData->ulPos >= pMemFileData->ulSize;
+}
+
+static void memFileFlush(UNUSED_ARG void *pData) {
+	// no-op
+}
+
+//------------------------------------------------------------------- PUBLIC FNS
+
+tFile *memFileOpen(const void *pData, ULONG ulSize) {
+	logBlockBegin("memFileOpen(pData: %p, ulSize: %lu)", pData, ulSize);
+	if(!pData) {
+		logWrite("ERR: Null data pointer\n");
+		logBlockEnd("memFileOpen()");
+		return 0;
+	}
+
+	tMemFileData *pMemFileData = memAllocFast(sizeof(*pMemFileData));
+	pMemFileData->pData = (const UBYTE*)pData;
+	pMemFileData->ulSize = ulSize;
+	pMemFileData->ulPos = 0;
+	pMemFileData->ubMemType = memType(pData);
+
+	tFile *pFile = memAllocFast(sizeof(*pFile));
+	pFile->pCallbacks = &s_sMemFileCallbacks;
+	pFile->pData = pMemFileData;
+
+	logBlockEnd("memFileOpen()");
+	return pFile;
+}
+
+const void *memFileTakePtr(tFile *pFile, ULONG ulSize, ULONG ulMemType) {
+	if(!pFile || pFile->pCallbacks != &s_sMemFileCallbacks) {
+		return 0;
+	}
+
+	tMemFileData *pMemFileData = (tMemFileData*)pFile->pData;
+	if(
+		(ulMemType & MEMF_CHIP) && !(pMemFileData->ubMemType & MEMF_CHIP)
+	) {
+		return 0;
+	}
+	if(pMemFileData->ulSize - pMemFileData->ulPos < ulSize) {
+		return 0;
+	}
+
+	const void *pPtr = &pMemFileData->pData[pMemFileData->ulPos];
+	pMemFileData->ulPos += ulSize;
+	return pPtr;
+}
+
+#endif // !defined(ACE_FILE_USE_ONLY_DISK)
@@ -4,53 +4,92 @@
 
 #include <ace/utils/pak_file.h>
 #include <string.h>
+#include <stddef.h>
 #include <ace/utils/disk_file.h>
 #include <ace/managers/memory.h>
 #include <ace/managers/log.h>
+#include <ace/managers/timer.h>
 
 #if !defined(ACE_FILE_USE_ONLY_DISK)
 #define ADLER32_MODULO 65521
-
-typedef UBYTE (*tCbCompressReadByte)(UBYTE *pOut, void *pData);
-
-typedef enum tCompressUnpackStateKind {
-	COMPRESS_UNPACK_STATE_KIND_READ_CTL,
-	COMPRESS_UNPACK_STATE_KIND_PROCESS_CTL_BIT,
-	COMPRESS_UNPACK_STATE_KIND_END_CTL,
-	COMPRESS_UNPACK_STATE_KIND_WRITE_RLE,
-	COMPRESS_UNPACK_STATE_KIND_DONE,
-} tCompressUnpackStateKind;
+#define PREFETCH_CHUNK_SIZE 1024
+// Subfiles are read in small chunks and interleaved with seeks, so a buffer
+// bigger than the default one saves lots of OS calls.
+#define PAK_DISK_BUFFER_SIZE 4096
 
 #define UNPACKER_CTL_BITS 8
 #define UNPACKER_RLE_CTL_BYTES 2
-#define UNPACKER_RLE_MAX_LENGTH (15 + 3)
-#define UNPACKER_PACKED_BUFFER_SIZE (UNPACKER_CTL_BITS * UNPACKER_RLE_CTL_BYTES + (UNPACKER_CTL_BITS / 8))
-#define UNPACKER_UNPACKED_BUFFER_SIZE (UNPACKER_CTL_BITS * UNPACKER_RLE_MAX_LENGTH)
+#define UNPACKER_RLE_MIN_LENGTH 3
+#define UNPACKER_TOKEN_MAX_BYTES (1 + UNPACKER_RLE_CTL_BYTES)
+#define UNPACKER_PACKED_BUFFER_SIZE 1024
+#define UNPACKER_LOOKUP_SIZE 0x1000
+#define UNPACKER_LOOKUP_MASK (UNPACKER_LOOKUP_SIZE - 1)
+
+// PAK_FILE_CODEC_LZ_FAST stream consists of blocks, each unpacking to
+// UNPACKER_FAST_BLOCK_SIZE bytes (last one of a segment may be shorter) and
+// prefixed with BE UWORD packed size. Block is a sequence of:
+// - token byte: literal count in upper nibble, match length minus
+//   UNPACKER_FAST_MIN_MATCH in lower one. Nibble value of 15 is followed by
+//   bytes added to it, up to and including the first one which isn't 255,
+// - literals,
+// - BE UWORD match distance, unless the block ends after the literals.
+// Blocks are decoded into alternating halves of the ring and packer ensures
+// that no match source wraps around it, so that copies use linear pointers.
+#define UNPACKER_FAST_BLOCK_SIZE 0x1000
+#define UNPACKER_FAST_BLOCK_HEADER_SIZE 2
+#define UNPACKER_FAST_PACKED_BLOCK_MAX (UNPACKER_FAST_BLOCK_SIZE + 32)
+#define UNPACKER_FAST_RING_SIZE (2 * UNPACKER_FAST_BLOCK_SIZE)
+#define UNPACKER_FAST_RING_MASK (UNPACKER_FAST_RING_SIZE - 1)
+#define UNPACKER_FAST_MIN_MATCH 4
+#define UNPACKER_FAST_LENGTH_EXTENDED 15
 
 typedef struct tCompressUnpacker {
 	void *pSubfileData;
 	ULONG ulCompressedSize;
 	ULONG ulUncompressedSize;
 	ULONG ulUnpackedCount;
-	UWORD uwLookupPos;
-
-	UBYTE ubUnpackedChunkPos;
-	UBYTE ubUnpackedChunkSize;
-	UBYTE *pPackedCurrent;
-	UBYTE pLookup[0x1000];
-	UBYTE pUnpacked[UNPACKER_UNPACKED_BUFFER_SIZE];
-	UBYTE pPacked[UNPACKER_PACKED_BUFFER_SIZE];
+	ULONG ulRestartInterval; ///< Distance between restart points, 0 if none.
+	ULONG ulNextRestartPos; ///< Unpacked pos at which the dictionary resets.
+	UBYTE ubCodec;
+	union {
+		struct { // PAK_FILE_CODEC_LZSS
+			UWORD uwLookupPos;
+			UWORD uwRlePos; ///< Lookup read pos of currently copied RLE sequence.
+			UWORD uwRleRemaining; ///< Bytes left to copy from current RLE sequence.
+			UBYTE ubCtl;
+			UBYTE ubCtlBitsRemaining;
+			UBYTE *pPackedCurrent;
+			UBYTE *pPackedEnd;
+			UBYTE pLookup[UNPACKER_LOOKUP_SIZE];
+			UBYTE pPacked[UNPACKER_PACKED_BUFFER_SIZE]; ///< Must be last.
+		};
+		struct { // PAK_FILE_CODEC_LZ_FAST
+			ULONG ulSegmentStart; ///< Unpacked pos of most recent restart point.
+			UBYTE *pBlock; ///< Decoded data of current block, inside pRing.
+			UWORD uwBlockPos;
+			UWORD uwBlockSize;
+			UWORD uwNextPackedSize; ///< Packed size of next block, 0 if not read yet.
+			UBYTE pRing[UNPACKER_FAST_RING_SIZE];
+			UBYTE pBlockPacked[UNPACKER_FAST_PACKED_BLOCK_MAX + UNPACKER_FAST_BLOCK_HEADER_SIZE];
+		};
+	};
 } tCompressUnpacker;
 
 typedef struct tPakFileSubfileData {
 	tPakFile *pPak;
 	tPakFileEntry *pEntry;
 	ULONG ulPos;
+	ULONG ulTraceOpenTime;
+	ULONG ulTraceBytesRead;
 } tPakFileSubfileData;
 
 typedef struct tPakFileCompressedData {
-	tCompressUnpacker sUnpacker;
 	tFile *pSubfile;
+	ULONG *pRestartOffsets; ///< Packed stream offsets of restart points 1..n.
+	ULONG ulRestartCount;
+	ULONG ulPackedStart; ///< Subfile offset of packed stream, past restart table.
+	ULONG ulAllocSize; ///< Only the part of sUnpacker used by codec is allocated.
+	tCompressUnpacker sUnpacker; ///< Must be last.
 } tPakFileCompressedData;
 
 static void pakSubfileClose(void *pData);
@@ -95,102 +134,264 @@ static const tFileCallbacks s_sPakCompressedCallbacks = {
 
 //------------------------------------------------------------------ PRIVATE FNS
 
+/**
+ * @brief Resets the unpacker state so that it continues from given unpacked
+ * position, which must be either 0 or a restart point. Packed data is then
+ * read from the current position of the subfile.
+ */
+static void compressUnpackerReset(tCompressUnpacker *pUnpacker, ULONG ulUnpackedPos) {
+	pUnpacker->ulUnpackedCount = ulUnpackedPos;
+	pUnpacker->ulNextRestartPos = (
+		pUnpacker->ulRestartInterval ?
+		ulUnpackedPos + pUnpacker->ulRestartInterval : ULONG_MAX
+	);
+	if(pUnpacker->ubCodec == PAK_FILE_CODEC_LZ_FAST) {
+		pUnpacker->ulSegmentStart = ulUnpackedPos;
+		pUnpacker->pBlock = pUnpacker->pRing;
+		pUnpacker->uwBlockPos = 0;
+		pUnpacker->uwBlockSize = 0;
+		pUnpacker->uwNextPackedSize = 0;
+	}
+	else {
+		pUnpacker->uwLookupPos = 0;
+		pUnpacker->uwRlePos = 0;
+		pUnpacker->uwRleRemaining = 0;
+		pUnpacker->ubCtl = 0;
+		pUnpacker->ubCtlBitsRemaining = 0;
+		pUnpacker->pPackedCurrent = &pUnpacker->pPacked[UNPACKER_PACKED_BUFFER_SIZE];
+		pUnpacker->pPackedEnd = &pUnpacker->pPacked[UNPACKER_PACKED_BUFFER_SIZE];
+	}
+}
+
 void compressUnpackerInit(
-	tCompressUnpacker *pUnpacker, ULONG ulCompressedSize, size_t ulUncompressedSize,
-	void *pSubfileData
+	tCompressUnpacker *pUnpacker, UBYTE ubCodec, ULONG ulCompressedSize,
+	size_t ulUncompressedSize, ULONG ulRestartInterval, void *pSubfileData
 ) {
-	pUnpacker->ulUnpackedCount = 0;
-	pUnpacker->uwLookupPos = 0;
-	pUnpacker->ubUnpackedChunkPos = 0;
-	pUnpacker->ubUnpackedChunkSize = 0;
-
+	pUnpacker->ubCodec = ubCodec;
 	pUnpacker->ulCompressedSize = ulCompressedSize;
 	pUnpacker->ulUncompressedSize = ulUncompressedSize;
+	pUnpacker->ulRestartInterval = ulRestartInterval;
 	pUnpacker->pSubfileData = pSubfileData;
-	pUnpacker->pPackedCurrent = &pUnpacker->pPacked[UNPACKER_PACKED_BUFFER_SIZE];
+	compressUnpackerReset(pUnpacker, 0);
 }
 
-static void rleTableWrite(UBYTE *pTable, UWORD *pPos, UBYTE ubData) {
-	pTable[*pPos] = ubData;
-	(*pPos)++;
-	(*pPos) &= 0xfff;
+static void compressUnpackerRefill(tCompressUnpacker *pUnpacker) {
+	// Move unparsed bytes to beginning, fill up the rest of packed buffer
+	// with one big read
+	UBYTE *pPackedCurrent = pUnpacker->pPackedCurrent;
+	UBYTE *pDst = &pUnpacker->pPacked[0];
+	while(pPackedCurrent < pUnpacker->pPackedEnd) {
+		*(pDst++) = *(pPackedCurrent++);
+	}
+
+	// Read might return 0 if only unparsed bytes are remaining to process
+	pUnpacker->pPackedEnd = pDst + pakSubfileRead(
+		pUnpacker->pSubfileData, pDst,
+		&pUnpacker->pPacked[UNPACKER_PACKED_BUFFER_SIZE] - pDst
+	);
+	pUnpacker->pPackedCurrent = &pUnpacker->pPacked[0];
 }
 
-static UBYTE rleTableRead(const UBYTE *pTable, UWORD *pPos) {
-	UBYTE ubData;
+/**
+ * @brief Decodes exactly ulSize bytes straight into pDest.
+ *
+ * Decoding stops as soon as pDest is filled, even in the middle of a control
+ * byte or RLE sequence - state is kept in pUnpacker so that next call resumes
+ * from that point. Caller must ensure that there's no restart point inside
+ * decoded range.
+ */
+static void compressUnpackerDecode(tCompressUnpacker *pUnpacker, UBYTE *pDest, ULONG ulSize) {
+	UBYTE *pLookup = pUnpacker->pLookup;
+	UWORD uwLookupPos = pUnpacker->uwLookupPos;
+	UBYTE *pOut = pDest;
+	UBYTE *pOutEnd = pDest + ulSize;
+	while(pOut < pOutEnd) {
+		if(pUnpacker->uwRleRemaining) {
+			// Continue copying RLE sequence
+			UWORD uwCopySize = pUnpacker->uwRleRemaining;
+			if(uwCopySize > pOutEnd - pOut) {
+				uwCopySize = pOutEnd - pOut;
+			}
+			pUnpacker->uwRleRemaining -= uwCopySize;
+			UWORD uwRlePos = pUnpacker->uwRlePos;
+			while(uwCopySize--) {
+				UBYTE ubRawByte = pLookup[uwRlePos];
+				uwRlePos = (uwRlePos + 1) & UNPACKER_LOOKUP_MASK;
+				pLookup[uwLookupPos] = ubRawByte;
+				uwLookupPos = (uwLookupPos + 1) & UNPACKER_LOOKUP_MASK;
+				*(pOut++) = ubRawByte;
+			}
+			pUnpacker->uwRlePos = uwRlePos;
+			continue;
+		}
+
+		if(pUnpacker->pPackedEnd - pUnpacker->pPackedCurrent < UNPACKER_TOKEN_MAX_BYTES) {
+			compressUnpackerRefill(pUnpacker);
+		}
+		UBYTE *pPackedCurrent = pUnpacker->pPackedCurrent;
+		if(!pUnpacker->ubCtlBitsRemaining) {
+			pUnpacker->ubCtl = *(pPackedCurrent++);
+			pUnpacker->ubCtlBitsRemaining = UNPACKER_CTL_BITS;
+		}
 
-	ubData = pTable[*pPos];
-	(*pPos)++;
-	(*pPos) &= 0xfff;
+		if(pUnpacker->ubCtl & 1) {
+			UBYTE ubRawByte = *(pPackedCurrent++);
+			pLookup[uwLookupPos] = ubRawByte;
+			uwLookupPos = (uwLookupPos + 1) & UNPACKER_LOOKUP_MASK;
+			*(pOut++) = ubRawByte;
+		}
+		else {
+			UBYTE ubHi = *(pPackedCurrent++);
+			UBYTE ubLo = *(pPackedCurrent++);
+			UWORD uwRleCtl = (ubHi << 8) | ubLo;
+			pUnpacker->uwRleRemaining = (uwRleCtl & 0xF) + UNPACKER_RLE_MIN_LENGTH;
+			pUnpacker->uwRlePos = uwRleCtl >> 4;
+		}
+		pUnpacker->ubCtl >>= 1;
+		--pUnpacker->ubCtlBitsRemaining;
+		pUnpacker->pPackedCurrent = pPackedCurrent;
+	}
 
-	return ubData;
+	pUnpacker->uwLookupPos = uwLookupPos;
+	pUnpacker->ulUnpackedCount += ulSize;
 }
 
-static WORD compressUnpackerReadNext(tCompressUnpacker *pUnpacker, UBYTE *pOut, ULONG ulReadSize) {
-	UBYTE ubReadSize = MIN((UBYTE)(pUnpacker->ubUnpackedChunkSize - pUnpacker->ubUnpackedChunkPos), ulReadSize);
-	UBYTE ubReadPos = pUnpacker->ubUnpackedChunkPos;
-	for(UWORD i = 0; i < ubReadSize; ++i) {
-		*(pOut++) = pUnpacker->pUnpacked[ubReadPos++];
-	}
-	if(ubReadSize) {
-		pUnpacker->ulUnpackedCount += ubReadSize;
-		pUnpacker->ubUnpackedChunkPos = ubReadPos;
-		return ubReadSize;
+static ULONG compressUnpackerLzssRead(tCompressUnpacker *pUnpacker, UBYTE *pDest, ULONG ulSize) {
+	ULONG ulRemaining = ulSize;
+	while(ulRemaining) {
+		ULONG ulChunkSize = pUnpacker->ulNextRestartPos - pUnpacker->ulUnpackedCount;
+		if(ulChunkSize > ulRemaining) {
+			ulChunkSize = ulRemaining;
+		}
+		compressUnpackerDecode(pUnpacker, pDest, ulChunkSize);
+		pDest += ulChunkSize;
+		ulRemaining -= ulChunkSize;
+
+		if(pUnpacker->ulUnpackedCount == pUnpacker->ulNextRestartPos) {
+			// Packed stream continues with new segment with fresh dictionary
+			// and control byte - drop unused bits of current one.
+			pUnpacker->uwLookupPos = 0;
+			pUnpacker->ubCtlBitsRemaining = 0;
+			pUnpacker->ulNextRestartPos += pUnpacker->ulRestartInterval;
+		}
 	}
+	return ulSize;
+}
 
-	if(pUnpacker->ulUnpackedCount >= pUnpacker->ulUncompressedSize) {
-		return -1;
+/**
+ * @brief Reads next LZ_FAST block and decodes it into the ring.
+ */
+static void compressUnpackerFastDecodeBlock(tCompressUnpacker *pUnpacker) {
+	ULONG ulBlockStart = pUnpacker->ulUnpackedCount;
+	if(ulBlockStart == pUnpacker->ulNextRestartPos) {
+		// New segment doesn't refer to any of the previous blocks
+		pUnpacker->ulSegmentStart = ulBlockStart;
+		pUnpacker->ulNextRestartPos += pUnpacker->ulRestartInterval;
 	}
-
-	// Move unparsed bytes to beginning, fill up the packed buffer
-	UBYTE *pPackedCurrent = pUnpacker->pPackedCurrent;
-	UBYTE *pDst = &pUnpacker->pPacked[0];
-	UBYTE *pEnd = &pUnpacker->pPacked[UNPACKER_PACKED_BUFFER_SIZE];
-	while(pPackedCurrent < pEnd) {
-		*(pDst++) = *(pPackedCurrent++);
+	ULONG ulBlockEnd = MIN(pUnpacker->ulNextRestartPos, pUnpacker->ulUncompressedSize);
+	UWORD uwBlockSize = MIN(UNPACKER_FAST_BLOCK_SIZE, ulBlockEnd - ulBlockStart);
+
+	// Size of the next block is read along with current one, so that there's
+	// only one subfile read per block.
+	UBYTE *pIn = pUnpacker->pBlockPacked;
+	UWORD uwPackedSize = pUnpacker->uwNextPackedSize;
+	if(!uwPackedSize) {
+		pakSubfileRead(pUnpacker->pSubfileData, pIn, UNPACKER_FAST_BLOCK_HEADER_SIZE);
+		uwPackedSize = (pIn[0] << 8) | pIn[1];
+	}
+	ULONG ulReadSize = uwPackedSize + UNPACKER_FAST_BLOCK_HEADER_SIZE;
+	ULONG ulRead = pakSubfileRead(pUnpacker->pSubfileData, pIn, ulReadSize);
+	pUnpacker->uwNextPackedSize = 0;
+	if(ulRead == ulReadSize) {
+		pUnpacker->uwNextPackedSize = (pIn[uwPackedSize] << 8) | pIn[uwPackedSize + 1];
 	}
 
-	// Read might return 0 if only unparsed bytes are remaining to process
-	pEnd = pDst + pakSubfileRead(pUnpacker->pSubfileData, pDst, pEnd - pDst);
-
-	// Decode next portion of data
-	pPackedCurrent = &pUnpacker->pPacked[0];
-	UBYTE ubCtl = *(pPackedCurrent++);
-	UBYTE ubBits = UNPACKER_CTL_BITS;
-	UBYTE *pUnpacked = pUnpacker->pUnpacked;
+	UBYTE *pRing = pUnpacker->pRing;
+	UBYTE *pOut = &pRing[(ulBlockStart - pUnpacker->ulSegmentStart) & UNPACKER_FAST_RING_MASK];
+	UBYTE *pOutEnd = pOut + uwBlockSize;
+	pUnpacker->pBlock = pOut;
+	pUnpacker->uwBlockPos = 0;
+	pUnpacker->uwBlockSize = uwBlockSize;
+	while(pOut < pOutEnd) {
+		UBYTE ubToken = *(pIn++);
+		UWORD uwLength = ubToken >> 4;
+		if(uwLength == UNPACKER_FAST_LENGTH_EXTENDED) {
+			UBYTE ubExtra;
+			do {
+				ubExtra = *(pIn++);
+				uwLength += ubExtra;
+			} while(ubExtra == 0xFF);
+		}
+		memcpy(pOut, pIn, uwLength);
+		pOut += uwLength;
+		pIn += uwLength;
+		if(pOut >= pOutEnd) {
+			break;
+		}
 
-	while(ubBits--) {
-		if(ubCtl & 1) {
-			UBYTE ubRawByte = *(pPackedCurrent++);
-			rleTableWrite(pUnpacker->pLookup, &pUnpacker->uwLookupPos, ubRawByte);
-			*(pUnpacked++) = ubRawByte;
+		UWORD uwDistance = (pIn[0] << 8) | pIn[1];
+		pIn += 2;
+		uwLength = ubToken & 0xF;
+		if(uwLength == UNPACKER_FAST_LENGTH_EXTENDED) {
+			UBYTE ubExtra;
+			do {
+				ubExtra = *(pIn++);
+				uwLength += ubExtra;
+			} while(ubExtra == 0xFF);
+		}
+		uwLength += UNPACKER_FAST_MIN_MATCH;
+		const UBYTE *pSrc = pOut - uwDistance;
+		if(pSrc < pRing) {
+			pSrc += UNPACKER_FAST_RING_SIZE;
+		}
+		if(uwDistance >= uwLength) {
+			memcpy(pOut, pSrc, uwLength);
+			pOut += uwLength;
 		}
 		else {
-			UBYTE ubHi = *(pPackedCurrent++);
-			UBYTE ubLo = *(pPackedCurrent++);
-			ULONG ulRleCtl = (ubHi << 8) | ubLo;
-
-			UWORD uwRleLength = (ulRleCtl & 0xF) + 3;
-			UWORD uwRlePos = ulRleCtl >> 4;
-			while(uwRleLength--) {
-				UBYTE ubRawByte = rleTableRead(pUnpacker->pLookup, &uwRlePos);
-				rleTableWrite(pUnpacker->pLookup, &pUnpacker->uwLookupPos, ubRawByte);
-				*(pUnpacked++) = ubRawByte;
+			// Overlapping match repeats bytes it has just written
+			UBYTE *pMatchEnd = pOut + uwLength;
+			while(pOut < pMatchEnd) {
+				*(pOut++) = *(pSrc++);
 			}
 		}
-		if(pPackedCurrent == pEnd) {
-			// TODO: optimize packing so that there are always 8 bits to process
-			// at the end - would allow removing this cmp.
-			// Might be impossible for some files? E.g. one with no RLE sequences -
-			// perhaps don't ever use compression for them.
-			break;
+	}
+}
+
+static ULONG compressUnpackerFastRead(tCompressUnpacker *pUnpacker, UBYTE *pDest, ULONG ulSize) {
+	ULONG ulRemaining = ulSize;
+	while(ulRemaining) {
+		if(pUnpacker->uwBlockPos == pUnpacker->uwBlockSize) {
+			compressUnpackerFastDecodeBlock(pUnpacker);
+		}
+		UWORD uwCopySize = pUnpacker->uwBlockSize - pUnpacker->uwBlockPos;
+		if(uwCopySize > ulRemaining) {
+			uwCopySize = ulRemaining;
 		}
-		ubCtl >>= 1;
+		memcpy(pDest, &pUnpacker->pBlock[pUnpacker->uwBlockPos], uwCopySize);
+		pDest += uwCopySize;
+		ulRemaining -= uwCopySize;
+		pUnpacker->uwBlockPos += uwCopySize;
+		pUnpacker->ulUnpackedCount += uwCopySize;
 	}
-	pUnpacker->ubUnpackedChunkSize = pUnpacked - pUnpacker->pUnpacked;
-	pUnpacker->pPackedCurrent = pPackedCurrent;
-	pUnpacker->ubUnpackedChunkPos = 0;
-	return 0;
+	return ulSize;
+}
+
+/**
+ * @brief Decodes up to ulSize bytes straight into pDest.
+ *
+ * @return Number of bytes written to pDest.
+ */
+static ULONG compressUnpackerRead(tCompressUnpacker *pUnpacker, UBYTE *pDest, ULONG ulSize) {
+	ULONG ulRemainingInFile = pUnpacker->ulUncompressedSize - pUnpacker->ulUnpackedCount;
+	if(ulSize > ulRemainingInFile) {
+		ulSize = ulRemainingInFile;
+	}
+
+	if(pUnpacker->ubCodec == PAK_FILE_CODEC_LZ_FAST) {
+		return compressUnpackerFastRead(pUnpacker, pDest, ulSize);
+	}
+	return compressUnpackerLzssRead(pUnpacker, pDest, ulSize);
 }
 
 static ULONG adler32Buffer(const UBYTE *pData, ULONG ulDataSize) {
@@ -210,6 +411,15 @@ static ULONG adler32Buffer(const UBYTE *pData, ULONG ulDataSize) {
 
 static void pakSubfileClose(void *pData) {
 	tPakFileSubfileData *pSubfileData = (tPakFileSubfileData*)pData;
+	tFile *pTraceFile = pSubfileData->pPak->pTraceFile;
+	if(pTraceFile) {
+		ULONG pRecord[3] = {
+			pSubfileData->pEntry->ulPathChecksum,
+			pSubfileData->ulTraceOpenTime,
+			pSubfileData->ulTraceBytesRead
+		};
+		fileWriteLongs(pTraceFile, pRecord, 3);
+	}
 
 	memFree(pSubfileData, sizeof(*pSubfileData));
 }
@@ -239,6 +449,7 @@ static ULONG pakSubfileRead(void *pData, void *pDest, ULONG ulSize) {
 
 	ULONG ulRead = fileReadBytes(pPak->pFile, (UBYTE*)pDest, ulSize);
 	pSubfileData->ulPos += ulRead;
+	pSubfileData->ulTraceBytesRead += ulRead;
 	return ulRead;
 }
 
@@ -299,24 +510,18 @@ static void pakSubfileFlush(UNUSED_ARG void *pData) {
 static void pakCompressedClose(void *pData) {
 	tPakFileCompressedData *pCompressedData = (tPakFileCompressedData*)pData;
 	fileClose(pCompressedData->pSubfile);
-	memFree(pCompressedData, sizeof(*pCompressedData));
+	if(pCompressedData->ulRestartCount) {
+		memFree(
+			pCompressedData->pRestartOffsets,
+			sizeof(pCompressedData->pRestartOffsets[0]) * pCompressedData->ulRestartCount
+		);
+	}
+	memFree(pCompressedData, pCompressedData->ulAllocSize);
 }
 
 static ULONG pakCompressedRead(void *pData, void *pDest, ULONG ulSize) {
 	tPakFileCompressedData *pCompressedData = (tPakFileCompressedData*)pData;
-	tCompressUnpacker *pUnpacker = &pCompressedData->sUnpacker;
-	ULONG ulRemaining = ulSize;
-	UBYTE *pDestByte = pDest;
-
-	while(ulRemaining) {
-		WORD wRead = compressUnpackerReadNext(pUnpacker, pDestByte, ulRemaining);
-		if(wRead < 0) {
-			break;
-		}
-		pDestByte += wRead;
-		ulRemaining -= wRead;
-	}
-	return ulSize - ulRemaining;
+	return compressUnpackerRead(&pCompressedData->sUnpacker, pDest, ulSize);
 }
 
 static ULONG pakCompressedWrite(
@@ -326,10 +531,28 @@ static ULONG pakCompressedWrite(
 	return 0;
 }
 
+static void pakCompressedJumpToRestart(
+	tPakFileCompressedData *pCompressedData, ULONG ulRestartIndex
+) {
+	ULONG ulPackedOffs = (
+		ulRestartIndex ? pCompressedData->pRestartOffsets[ulRestartIndex - 1] : 0
+	);
+	pakSubfileSeek(
+		pCompressedData->pSubfile->pData,
+		pCompressedData->ulPackedStart + ulPackedOffs, FILE_SEEK_SET
+	);
+	compressUnpackerReset(
+		&pCompressedData->sUnpacker,
+		ulRestartIndex * pCompressedData->sUnpacker.ulRestartInterval
+	);
+}
+
 static ULONG pakCompressedSeek(void *pData, LONG lPos, WORD wMode) {
 	tPakFileCompressedData *pCompressedData = (tPakFileCompressedData*)pData;
 	// seek forward: unpack some bytes to void
 	// seek backward: restart unpacker and unpack some bytes to void
+	// with restart points: jump to nearest one before target if it's closer
+	// than current pos, then unpack remaining bytes to void
 
 	ULONG ulPosCurrent = pCompressedData->sUnpacker.ulUnpackedCount;
 	ULONG ulPosTarget;
@@ -357,19 +580,25 @@ static ULONG pakCompressedSeek(void *pData, LONG lPos, WORD wMode) {
 		return 1;
 	}
 
-	if(ulPosTarget < ulPosCurrent) {
+	ULONG ulRestartInterval = pCompressedData->sUnpacker.ulRestartInterval;
+	if(ulRestartInterval) {
+		ULONG ulRestartIndex = ulPosTarget / ulRestartInterval;
+		ULONG ulRestartPos = ulRestartIndex * ulRestartInterval;
+		if(ulPosTarget < ulPosCurrent || ulRestartPos > ulPosCurrent) {
+			pakCompressedJumpToRestart(pCompressedData, ulRestartIndex);
+		}
+	}
+	else if(ulPosTarget < ulPosCurrent) {
 		logWrite("WARN: Huge performance penalty due to going back in compressed file. Do you *really* need to do it?\n");
-		compressUnpackerInit(
-			&pCompressedData->sUnpacker,
-			pCompressedData->sUnpacker.ulCompressedSize,
-			pCompressedData->sUnpacker.ulUncompressedSize,
-			pCompressedData->pSubfile->pData
-		);
+		pakCompressedJumpToRestart(pCompressedData, 0);
 	}
 
 	while(pCompressedData->sUnpacker.ulUnpackedCount < ulPosTarget) {
-		UBYTE ubDummy;
-		pakCompressedRead(pData, &ubDummy, 1);
+		UBYTE pDummy[64];
+		compressUnpackerRead(
+			&pCompressedData->sUnpacker, pDummy,
+			MIN(sizeof(pDummy), ulPosTarget - pCompressedData->sUnpacker.ulUnpackedCount)
+		);
 	}
 
 	return 1;
@@ -395,6 +624,24 @@ static void pakCompressedFlush(UNUSED_ARG void *pData) {
 }
 
 static UWORD pakFileGetFileIndexByHash(const tPakFile *pPakFile, ULONG ulPathHash) {
+	if(pPakFile->uwFlags & PAK_FILE_FLAG_SORTED_BY_HASH) {
+		UWORD uwLo = 0, uwHi = pPakFile->uwFileCount;
+		while(uwLo < uwHi) {
+			UWORD uwMid = (uwLo + uwHi) / 2;
+			ULONG ulMidHash = pPakFile->pEntries[uwMid].ulPathChecksum;
+			if(ulMidHash == ulPathHash) {
+				return uwMid;
+			}
+			if(ulMidHash < ulPathHash) {
+				uwLo = uwMid + 1;
+			}
+			else {
+				uwHi = uwMid;
+			}
+		}
+		return UWORD_MAX;
+	}
+
 	for(UWORD i = 0; i < pPakFile->uwFileCount; ++i) {
 		if(pPakFile->pEntries[i].ulPathChecksum == ulPathHash) {
 			return i;
@@ -407,7 +654,9 @@ static UWORD pakFileGetFileIndexByHash(const tPakFile *pPakFile, ULONG ulPathHas
 
 tPakFile *pakFileOpen(const char *szPath, UBYTE isUninterrupted) {
 	logBlockBegin("pakFileOpen(szPath: '%s')", szPath);
-	tFile *pMainFile = diskFileOpen(szPath, DISK_FILE_MODE_READ, isUninterrupted);
+	tFile *pMainFile = diskFileOpenBuffered(
+		szPath, DISK_FILE_MODE_READ, isUninterrupted, PAK_DISK_BUFFER_SIZE
+	);
 	if(!pMainFile) {
 		logBlockEnd("pakFileOpen()");
 		return 0;
@@ -416,15 +665,40 @@ tPakFile *pakFileOpen(const char *szPath, UBYTE isUninterrupted) {
 	tPakFile *pPakFile = memAllocFast(sizeof(*pPakFile));
 	pPakFile->pFile = pMainFile;
 	pPakFile->pPrevReadSubfile = 0;
+	pPakFile->uwFlags = 0;
+	pPakFile->ulRestartInterval = 0;
+	pPakFile->pTraceFile = 0;
 	fileReadWords(pMainFile, &pPakFile->uwFileCount, 1);
+	if(pPakFile->uwFileCount == PAK_FILE_HEADER_EXTENDED) {
+		fileReadWords(pMainFile, &pPakFile->uwFlags, 1);
+		fileReadWords(pMainFile, &pPakFile->uwFileCount, 1);
+		if(pPakFile->uwFlags & PAK_FILE_FLAG_RESTART_POINTS) {
+			fileReadLongs(pMainFile, &pPakFile->ulRestartInterval, 1);
+		}
+	}
 	pPakFile->pEntries = memAllocFast(sizeof(pPakFile->pEntries[0]) * pPakFile->uwFileCount);
 	for(UWORD i = 0; i < pPakFile->uwFileCount; ++i) {
-		fileReadLongs(pMainFile, &pPakFile->pEntries[i].ulPathChecksum, 1);
-		fileReadLongs(pMainFile, &pPakFile->pEntries[i].ulOffs, 1);
-		fileReadLongs(pMainFile, &pPakFile->pEntries[i].ulSizeUncompressed, 1);
-		fileReadLongs(pMainFile, &pPakFile->pEntries[i].ulSizeData, 1);
+		tPakFileEntry *pEntry = &pPakFile->pEntries[i];
+		fileReadLongs(pMainFile, &pEntry->ulPathChecksum, 1);
+		fileReadLongs(pMainFile, &pEntry->ulOffs, 1);
+		fileReadLongs(pMainFile, &pEntry->ulSizeUncompressed, 1);
+		fileReadLongs(pMainFile, &pEntry->ulSizeData, 1);
+		if(pPakFile->uwFlags & PAK_FILE_FLAG_ENTRY_CODECS) {
+			UWORD uwCodec;
+			fileReadWords(pMainFile, &uwCodec, 1);
+			pEntry->ubCodec = uwCodec;
+		}
+		else {
+			pEntry->ubCodec = (
+				pEntry->ulSizeUncompressed != pEntry->ulSizeData ?
+				PAK_FILE_CODEC_LZSS : PAK_FILE_CODEC_NONE
+			);
+		}
 	}
-	logWrite("Pak file: %p, file count: %hu\n", pPakFile, pPakFile->uwFileCount);
+	logWrite(
+		"Pak file: %p, file count: %hu, flags: %04hX, restart interval: %lu\n",
+		pPakFile, pPakFile->uwFileCount, pPakFile->uwFlags, pPakFile->ulRestartInterval
+	);
 
 	logBlockEnd("pakFileOpen()");
 	return pPakFile;
@@ -432,6 +706,9 @@ tPakFile *pakFileOpen(const char *szPath, UBYTE isUninterrupted) {
 
 void pakFileClose(tPakFile *pPakFile) {
 	logBlockBegin("pakFileClose(pPakFile: %p)", pPakFile);
+	if(pPakFile->pTraceFile) {
+		pakFileTraceEnd(pPakFile);
+	}
 	fileClose(pPakFile->pFile);
 	memFree(pPakFile->pEntries, sizeof(pPakFile->pEntries[0]) * pPakFile->uwFileCount);
 	memFree(pPakFile, sizeof(*pPakFile));
@@ -465,20 +742,27 @@ tFile *pakFileGetFileByIndex(tPakFile *pPakFile, UWORD uwFileIndex) {
 		logBlockEnd("pakFileGetFileByIndex()");
 		return 0;
 	}
-	UBYTE isCompressed = pPakFile->pEntries[uwFileIndex].ulSizeUncompressed != pPakFile->pEntries[uwFileIndex].ulSizeData;
+	UBYTE ubCodec = pPakFile->pEntries[uwFileIndex].ubCodec;
 	logWrite(
-		"Subfile index: %hu, offset: %lu, size: %lu, compressed: %hhu\n",
+		"Subfile index: %hu, offset: %lu, size: %lu, codec: %hhu\n",
 		uwFileIndex,
 		pPakFile->pEntries[uwFileIndex].ulOffs,
 		pPakFile->pEntries[uwFileIndex].ulSizeUncompressed,
-		isCompressed
+		ubCodec
 	);
+	if(ubCodec > PAK_FILE_CODEC_LZ_FAST) {
+		logWrite("ERR: Unsupported codec\n");
+		logBlockEnd("pakFileGetFileByIndex()");
+		return 0;
+	}
 
 	// Create tFile, fill subfileData
 	tPakFileSubfileData *pSubfileData = memAllocFast(sizeof(*pSubfileData));
 	pSubfileData->pPak = pPakFile;
 	pSubfileData->pEntry = &pPakFile->pEntries[uwFileIndex];
 	pSubfileData->ulPos = 0;
+	pSubfileData->ulTraceOpenTime = pPakFile->pTraceFile ? timerGet() : 0;
+	pSubfileData->ulTraceBytesRead = 0;
 	// Prevent reading from same place if pSubfileData gets mem from recently closed file
 	pPakFile->pPrevReadSubfile = 0;
 
@@ -486,13 +770,36 @@ tFile *pakFileGetFileByIndex(tPakFile *pPakFile, UWORD uwFileIndex) {
 	pFile->pCallbacks = &s_sPakSubfileCallbacks;
 	pFile->pData = pSubfileData;
 
-	if(isCompressed) {
-		tPakFileCompressedData *pCompressedData = memAllocFast(sizeof(*pCompressedData));
+	if(ubCodec != PAK_FILE_CODEC_NONE) {
+		// LZSS state is smaller, so the rest of unpacker union isn't allocated
+		ULONG ulAllocSize = (
+			ubCodec == PAK_FILE_CODEC_LZ_FAST ? sizeof(tPakFileCompressedData) :
+			offsetof(tPakFileCompressedData, sUnpacker.pPacked) + UNPACKER_PACKED_BUFFER_SIZE
+		);
+		tPakFileCompressedData *pCompressedData = memAllocFast(ulAllocSize);
+		pCompressedData->ulAllocSize = ulAllocSize;
 		pCompressedData->pSubfile = pFile;
+		pCompressedData->ulRestartCount = 0;
+		pCompressedData->ulPackedStart = 0;
+		if(pPakFile->ulRestartInterval) {
+			// Entry data starts with packed offsets of all but first restart point
+			ULONG ulSizeUncompressed = pPakFile->pEntries[uwFileIndex].ulSizeUncompressed;
+			if(ulSizeUncompressed) {
+				pCompressedData->ulRestartCount = (ulSizeUncompressed - 1) / pPakFile->ulRestartInterval;
+			}
+			if(pCompressedData->ulRestartCount) {
+				pCompressedData->pRestartOffsets = memAllocFast(
+					sizeof(pCompressedData->pRestartOffsets[0]) * pCompressedData->ulRestartCount
+				);
+				fileReadLongs(pFile, pCompressedData->pRestartOffsets, pCompressedData->ulRestartCount);
+			}
+			pCompressedData->ulPackedStart = sizeof(pCompressedData->pRestartOffsets[0]) * pCompressedData->ulRestartCount;
+		}
 		compressUnpackerInit(
-			&pCompressedData->sUnpacker,
-			pPakFile->pEntries[uwFileIndex].ulSizeData,
+			&pCompressedData->sUnpacker, ubCodec,
+			pPakFile->pEntries[uwFileIndex].ulSizeData - pCompressedData->ulPackedStart,
 			pPakFile->pEntries[uwFileIndex].ulSizeUncompressed,
+			pPakFile->ulRestartInterval,
 			pCompressedData->pSubfile->pData
 		);
 
@@ -510,4 +817,102 @@ ULONG pakFileGetPathHash(const char *szPath) {
 	return adler32Buffer((UBYTE*)szPath, strlen(szPath)); // TODO: Calculate path hash
 }
 
+void pakFileTraceBegin(tPakFile *pPakFile, const char *szTracePath) {
+	logBlockBegin(
+		"pakFileTraceBegin(pPakFile: %p, szTracePath: '%s')", pPakFile, szTracePath
+	);
+	if(pPakFile->pTraceFile) {
+		pakFileTraceEnd(pPakFile);
+	}
+	pPakFile->pTraceFile = diskFileOpen(szTracePath, DISK_FILE_MODE_WRITE, 0);
+	if(pPakFile->pTraceFile) {
+		ULONG ulMagic = PAK_FILE_TRACE_MAGIC;
+		fileWriteLongs(pPakFile->pTraceFile, &ulMagic, 1);
+	}
+	else {
+		logWrite("ERR: Can't open trace file\n");
+	}
+	logBlockEnd("pakFileTraceBegin()");
+}
+
+void pakFileTraceEnd(tPakFile *pPakFile) {
+	if(pPakFile->pTraceFile) {
+		fileClose(pPakFile->pTraceFile);
+		pPakFile->pTraceFile = 0;
+	}
+}
+
+ULONG pakFileGetFileSizeByHash(const tPakFile *pPakFile, ULONG ulPathHash) {
+	UWORD uwFileIndex = pakFileGetFileIndexByHash(pPakFile, ulPathHash);
+	if(uwFileIndex == UWORD_MAX) {
+		logWrite("ERR: Can't find subfile with hash 0x%08lX\n", ulPathHash);
+		return 0;
+	}
+	return pPakFile->pEntries[uwFileIndex].ulSizeUncompressed;
+}
+
+tPakFilePrefetch *pakFilePrefetch(tPakFile *pPakFile, ULONG ulPathHash, void *pDest) {
+	logBlockBegin(
+		"pakFilePrefetch(pPakFile: %p, ulPathHash: 0x%08lX, pDest: %p)",
+		pPakFile, ulPathHash, pDest
+	);
+	tFile *pFile = pakFileGetFileByHash(pPakFile, ulPathHash);
+	if(!pFile) {
+		logBlockEnd("pakFilePrefetch()");
+		return 0;
+	}
+
+	tPakFilePrefetch *pPrefetch = memAllocFast(sizeof(*pPrefetch));
+	pPrefetch->pFile = pFile;
+	pPrefetch->pDest = pDest;
+	pPrefetch->ulSize = fileGetSize(pFile);
+	pPrefetch->ulLoaded = 0;
+	pPrefetch->isError = 0;
+	logBlockEnd("pakFilePrefetch()");
+	return pPrefetch;
+}
+
+UBYTE pakFilePrefetchProcess(tPakFilePrefetch *pPrefetch, ULONG ulBudgetUs) {
+	if(!pPrefetch->pFile) {
+		return 1;
+	}
+
+	// timerGetPrec(): One tick equals: PAL - 0.40us, NTSC - 0.45us, so there
+	// are 2.5 ticks per us. NTSC budget ends up ~12% longer, which is fine.
+	ULONG ulBudgetTicks = ulBudgetUs * 5 / 2;
+	ULONG ulStart = timerGetPrec();
+	do {
+		ULONG ulChunkSize = MIN(PREFETCH_CHUNK_SIZE, pPrefetch->ulSize - pPrefetch->ulLoaded);
+		if(!ulChunkSize) {
+			break;
+		}
+		ULONG ulRead = fileReadBytes(
+			pPrefetch->pFile, &pPrefetch->pDest[pPrefetch->ulLoaded], ulChunkSize
+		);
+		pPrefetch->ulLoaded += ulRead;
+		if(ulRead != ulChunkSize) {
+			logWrite(
+				"ERR: Prefetch read failed at %lu of %lu\n",
+				pPrefetch->ulLoaded, pPrefetch->ulSize
+			);
+			pPrefetch->isError = 1;
+			break;
+		}
+	} while(timerGetDelta(ulStart, timerGetPrec()) < ulBudgetTicks);
+
+	if(pPrefetch->isError || pPrefetch->ulLoaded == pPrefetch->ulSize) {
+		fileClose(pPrefetch->pFile);
+		pPrefetch->pFile = 0;
+		return 1;
+	}
+	return 0;
+}
+
+void pakFilePrefetchDestroy(tPakFilePrefetch *pPrefetch) {
+	if(pPrefetch->pFile) {
+		fileClose(pPrefetch->pFile);
+	}
+	memFree(pPrefetch, sizeof(*pPrefetch));
+}
+
 #endif
@@ -16,6 +16,7 @@ void printUsage(const std::string &szAppName)
 	print("extraOpts:\n");
 	print("\t-o outPath\tSpecify output file path. If ommited, it will perform default conversion\n");
 	print("\t-i\t\tEnable interleaved mode\n");
+	print("\t-c\t\tCompress .bm output with ByteRun1\n");
 	print("\t-ehb\t\tExtend palette with EHB colors\n");
 	print("\t-mc #RRGGBB\tTreat color #RRGGBB as mask\n");
 	print("\t-mf outMaskPath\tSpecify path for mask.bm file. If omitted, it will try\n");
@@ -39,6 +40,7 @@ int main(int lArgCount, const char *pArgs[])
 	std::string szPalette = pArgs[1], szInput = pArgs[2];
 	std::string szOutput = "", szMask = "";
 	bool isWriteInterleaved = false;
+	bool isWriteCompressed = false;
 	bool isEhb = false;
 	bool isEnabledOutputMask = true;
 	bool isEnabledOutput = true;
@@ -53,6 +55,9 @@ int main(int lArgCount, const char *pArgs[])
 		else if(pArgs[ArgIndex] == std::string("-i")) {
 			isWriteInterleaved = true;
 		}
+		else if(pArgs[ArgIndex] == std::string("-c")) {
+			isWriteCompressed = true;
+		}
 		else if(pArgs[ArgIndex] == std::string("-ehb")) {
 			isEhb = true;
 		}
@@ -165,7 +170,7 @@ int main(int lArgCount, const char *pArgs[])
 			}
 			if(isEnabledOutputMask) {
 				const auto Mask = In.filterColors(PaletteMask, MaskAntiColor);
-				tPlanarBitmap(Mask, PaletteMask).toBm(szMask, isWriteInterleaved);
+				tPlanarBitmap(Mask, PaletteMask).toBm(szMask, isWriteInterleaved, isWriteCompressed);
 			}
 		}
 		auto Planar = tPlanarBitmap(In, Palette, PaletteMask);
@@ -173,7 +178,7 @@ int main(int lArgCount, const char *pArgs[])
 			return EXIT_FAILURE;
 		}
 		if(isEnabledOutput) {
-			Planar.toBm(szOutput, isWriteInterleaved);
+			Planar.toBm(szOutput, isWriteInterleaved, isWriteCompressed);
 		}
 	}
 	else if(szOutExt == "png") {
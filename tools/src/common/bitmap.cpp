@@ -16,6 +16,84 @@ enum class tBmFlags: std::uint8_t {
 };
 ALLOW_FLAGS_FOR_ENUM(tBmFlags);
 
+// Must be in sync with BITMAP_VERSION_* in ACE's bitmap.h
+static constexpr std::uint8_t s_ubBmVersionRaw = 0;
+static constexpr std::uint8_t s_ubBmVersionByteRun1 = 1;
+
+/**
+ * @brief Packs single bitplane row with ByteRun1. Runs of 3+ same bytes are
+ * stored as repeats, everything else goes into literal blocks.
+ */
+static std::vector<std::uint8_t> packRowByteRun1(
+	const std::uint8_t *pRow, std::size_t Size
+)
+{
+	std::vector<std::uint8_t> vPacked;
+	auto getRunLength = [&](std::size_t Start) {
+		std::size_t RunLength = 1;
+		while(
+			Start + RunLength < Size && RunLength < 128 &&
+			pRow[Start + RunLength] == pRow[Start]
+		) {
+			++RunLength;
+		}
+		return RunLength;
+	};
+
+	std::size_t Pos = 0;
+	while(Pos < Size) {
+		auto RunLength = getRunLength(Pos);
+		if(RunLength >= 3) {
+			vPacked.push_back(std::uint8_t(1 - std::int16_t(RunLength)));
+			vPacked.push_back(pRow[Pos]);
+			Pos += RunLength;
+			continue;
+		}
+
+		std::size_t LiteralStart = Pos;
+		while(
+			Pos < Size && Pos - LiteralStart < 128 &&
+			(Pos == LiteralStart || getRunLength(Pos) < 3)
+		) {
+			++Pos;
+		}
+		vPacked.push_back(std::uint8_t(Pos - LiteralStart - 1));
+		vPacked.insert(vPacked.end(), &pRow[LiteralStart], &pRow[Pos]);
+	}
+	return vPacked;
+}
+
+static bool unpackRowByteRun1(
+	std::ifstream &File, std::uint8_t *pDest, std::size_t Size
+)
+{
+	while(Size) {
+		std::int8_t bControl;
+		if(!File.read(reinterpret_cast<char*>(&bControl), 1)) {
+			return false;
+		}
+		if(bControl >= 0) {
+			std::size_t Count = bControl + 1;
+			if(Count > Size || !File.read(reinterpret_cast<char*>(pDest), Count)) {
+				return false;
+			}
+			pDest += Count;
+			Size -= Count;
+		}
+		else if(bControl != -128) {
+			std::size_t Count = 1 - bControl;
+			char cValue;
+			if(Count > Size || !File.read(&cValue, 1)) {
+				return false;
+			}
+			std::fill_n(pDest, Count, std::uint8_t(cValue));
+			pDest += Count;
+			Size -= Count;
+		}
+	}
+	return true;
+}
+
 tChunkyBitmap::tChunkyBitmap(
 	const tPlanarBitmap &Planar, const tPalette &Palette
 ):
@@ -173,7 +251,9 @@ tPlanarBitmap::tPlanarBitmap(
 	m_ubDepth = ubDepth;
 }
 
-bool tPlanarBitmap::toBm(const std::string &szPath, bool isInterleaved)
+bool tPlanarBitmap::toBm(
+	const std::string &szPath, bool isInterleaved, bool isCompressed
+)
 {
 	flags::flags<tBmFlags> eFlags(tBmFlags::NONE);
 	if(isInterleaved) {
@@ -193,34 +273,41 @@ bool tPlanarBitmap::toBm(const std::string &szPath, bool isInterleaved)
 	OutFile.write(reinterpret_cast<char*>(&m_ubDepth), 1);
 
 	std::uint8_t ubOut = 0;
-	OutFile.write(reinterpret_cast<char*>(&ubOut), 1); // Version
+	std::uint8_t ubVersion = isCompressed ? s_ubBmVersionByteRun1 : s_ubBmVersionRaw;
+	OutFile.write(reinterpret_cast<char*>(&ubVersion), 1); // Version
 	OutFile.write(reinterpret_cast<char*>(&eFlags), 1); // Flags
 	OutFile.write(reinterpret_cast<char*>(&ubOut), 1); // Reserved 1
 	OutFile.write(reinterpret_cast<char*>(&ubOut), 1); // Reserved 2
 
-	// Write bitplanes
+	// Write bitplanes - each row separately, so that compressed ones can be
+	// unpacked straight into partial-width destination.
 	std::uint16_t uwRowWordCount = m_uwWidth / 16;
+	std::vector<std::uint16_t> vRow(uwRowWordCount);
+	auto writeRow = [&](std::uint8_t ubPlane, std::uint16_t y) {
+		for(std::uint16_t x = 0; x < uwRowWordCount; ++x) {
+			vRow[x] = nEndian::toBig16(m_pPlanes[ubPlane].at(y * uwRowWordCount + x));
+		}
+		auto pRowBytes = reinterpret_cast<const std::uint8_t*>(vRow.data());
+		std::size_t RowSize = vRow.size() * sizeof(vRow[0]);
+		if(isCompressed) {
+			auto vPacked = packRowByteRun1(pRowBytes, RowSize);
+			OutFile.write(reinterpret_cast<const char*>(vPacked.data()), vPacked.size());
+		}
+		else {
+			OutFile.write(reinterpret_cast<const char*>(pRowBytes), RowSize);
+		}
+	};
 	if(isInterleaved) {
 		for(std::uint16_t y = 0; y < m_uwHeight; ++y) {
 			for(std::uint8_t ubPlane = 0; ubPlane < m_ubDepth; ++ubPlane) {
-				for(std::uint16_t x = 0; x < uwRowWordCount; ++x) {
-					std::uint16_t uwData = nEndian::toBig16(
-						m_pPlanes[ubPlane].at(y * uwRowWordCount + x)
-					);
-					OutFile.write(reinterpret_cast<char*>(&uwData), sizeof(uint16_t));
-				}
+				writeRow(ubPlane, y);
 			}
 		}
 	}
 	else {
 		for(std::uint8_t ubPlane = 0; ubPlane < m_ubDepth; ++ubPlane) {
 			for(std::uint16_t y = 0; y < m_uwHeight; ++y) {
-				for(std::uint16_t x = 0; x < uwRowWordCount; ++x) {
-					std::uint16_t uwData = nEndian::toBig16(
-						m_pPlanes[ubPlane].at(y * uwRowWordCount + x)
-					);
-					OutFile.write(reinterpret_cast<char*>(&uwData), sizeof(uint16_t));
-				}
+				writeRow(ubPlane, y);
 			}
 		}
 	}
@@ -249,29 +336,41 @@ tPlanarBitmap tPlanarBitmap::fromBm(const std::string &szPath)
 	uwWidth = nEndian::fromBig16(uwWidth);
 	uwHeight = nEndian::fromBig16(uwHeight);
 
-	if(ubVersion == 0) {
+	if(ubVersion == s_ubBmVersionRaw || ubVersion == s_ubBmVersionByteRun1) {
 		tPlanarBitmap Bm(uwWidth, uwHeight, ubBpp);
 		for(std::uint8_t i = 0; i < ubBpp; ++i) {
 			Bm.m_pPlanes[i].resize(uwWidth * uwHeight / sizeof(Bm.m_pPlanes[0][0]));
 		}
+		bool isOk = true;
+		auto readRows = [&](std::uint8_t ubPlane, std::uint32_t y, std::uint32_t RowCount) {
+			auto pDest = &reinterpret_cast<std::uint8_t*>(
+				Bm.m_pPlanes[ubPlane].data()
+			)[y * uwWidth / 8];
+			if(ubVersion == s_ubBmVersionByteRun1) {
+				for(std::uint32_t i = 0; i < RowCount && isOk; ++i) {
+					isOk = unpackRowByteRun1(File, &pDest[i * uwWidth / 8], uwWidth / 8);
+				}
+			}
+			else {
+				File.read(reinterpret_cast<char*>(pDest), (uwWidth / 8) * RowCount);
+			}
+		};
 		if(eFlags & tBmFlags::INTERLEAVED) {
 			for(std::uint32_t y = 0; y < uwHeight; ++y) {
 				for(std::uint8_t i = 0; i < ubBpp; ++i) {
-					File.read(
-						&(reinterpret_cast<char*>(Bm.m_pPlanes[i].data())[y * uwWidth / 8]),
-						uwWidth / 8
-					);
+					readRows(i, y, 1);
 				}
 			}
 		}
 		else {
 			for(std::uint8_t i = 0; i < ubBpp; ++i) {
-				File.read(
-					reinterpret_cast<char*>(Bm.m_pPlanes[i].data()),
-					(uwWidth / 8) * uwHeight
-				);
+				readRows(i, 0, uwHeight);
 			}
 		}
+		if(!isOk) {
+			nLog::error("Malformed compressed bitmap data in '{}'", szPath);
+			return tPlanarBitmap(0, 0, 0);
+		}
 
 		// Convert endianness on data
 		for(std::uint8_t i = ubBpp; i--;) {
@@ -67,7 +67,9 @@ public:
 
 	tPlanarBitmap(std::uint16_t uwWidth, std::uint16_t uwHeight, std::uint8_t ubDepth);
 
-	bool toBm(const std::string &szPath, bool isInterleaved);
+	bool toBm(
+		const std::string &szPath, bool isInterleaved, bool isCompressed = false
+	);
 
 	static tPlanarBitmap fromBm(const std::string &szPath);
 };
@@ -1,5 +1,11 @@
 #include "../common/compress.hpp"
 #include <cmath>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
@@ -17,48 +23,162 @@ static uint8_t rleTableRead(const uint8_t *table, std::uint16_t *index)
 	return byte;
 }
 
-static bool rleTableFind(
+static std::uint32_t rleTableMatchLength(
 	const uint8_t *pLookup, std::uint16_t uwLookupLength,
 	std::uint16_t uwLookupWritePos, const uint8_t *pData, std::uint32_t ulMatchLimit,
-	std::uint16_t *pMatchPosition, std::uint8_t *pMatchLength
+	std::uint16_t uwPos
 )
 {
-	*pMatchPosition = 0;
-	*pMatchLength = 0;
+	std::uint32_t ulLimit = ulMatchLimit;
+	if(uwLookupLength < 0x1000) {
+		ulLimit = std::min(ulLimit, std::uint32_t(uwLookupLength - uwPos));
+	}
 	std::uint32_t ulMatchedLength;
-	bool isFound = false;
-	for (auto i = 0u; i < uwLookupLength; i++) {
-		std::uint32_t ulLimit = ulMatchLimit;
-		if(uwLookupLength < 0x1000) {
-			ulLimit = std::min(ulLimit, uwLookupLength - i);
-		}
-		for (ulMatchedLength = 0u; ulMatchedLength < ulLimit; ulMatchedLength++) {
-			auto offset = i + ulMatchedLength;
-			if (pLookup[offset & 0xfff] != pData[ulMatchedLength]) {
-				break;
-			}
+	for (ulMatchedLength = 0u; ulMatchedLength < ulLimit; ulMatchedLength++) {
+		auto offset = uwPos + ulMatchedLength;
+		if (pLookup[offset & 0xfff] != pData[ulMatchedLength]) {
+			break;
+		}
 
-			 // Don't return RLE runs that are in the area of the table that
-			 // will be written to, since the values will change.
-			if (
-				(i >= uwLookupWritePos && i <= uwLookupWritePos + ulMatchedLength) ||
-				(offset >= uwLookupWritePos && offset <= uwLookupWritePos + ulMatchedLength)
-			) {
-				ulMatchedLength = 0;
+		 // Don't return RLE runs that are in the area of the table that
+		 // will be written to, since the values will change.
+		if (
+			(uwPos >= uwLookupWritePos && uwPos <= uwLookupWritePos + ulMatchedLength) ||
+			(offset >= uwLookupWritePos && offset <= uwLookupWritePos + ulMatchedLength)
+		) {
+			return 0;
+		}
+	}
+	return ulMatchedLength;
+}
+
+/**
+ * @brief Match finder which keeps every lookup table position bucketed
+ * by the hash of the 3 bytes starting at it.
+ *
+ * Each bucket is a bitmap of table positions, so candidates are visited
+ * in ascending position order - same as the brute-force scan over
+ * the whole table, which keeps the emitted stream bit-identical: the longest
+ * match wins and ties go to the lowest table position.
+ */
+struct tRleMatchFinder {
+	static constexpr std::uint16_t s_uwTableSize = 0x1000;
+	static constexpr std::uint16_t s_uwBucketCount = 0x800;
+	static constexpr std::uint16_t s_uwWordsPerBucket = s_uwTableSize / 64;
+
+	std::uint8_t pLookup[s_uwTableSize];
+	std::uint16_t pPosBucket[s_uwTableSize];
+	std::uint16_t uwLookupWritePos;
+	std::uint16_t uwLookupLength;
+	// Which words of each bucket's bitmap are non-empty
+	std::vector<std::uint64_t> vBucketSummary;
+	std::vector<std::uint64_t> vBucketBits;
+
+	tRleMatchFinder():
+		uwLookupWritePos(0), uwLookupLength(0),
+		vBucketSummary(s_uwBucketCount, 0),
+		vBucketBits(s_uwBucketCount * s_uwWordsPerBucket, 0)
+	{
+		std::memset(pLookup, 0, sizeof(pLookup));
+		auto uwZeroBucket = hash(0, 0, 0);
+		for(std::uint16_t uwPos = 0; uwPos < s_uwTableSize; ++uwPos) {
+			pPosBucket[uwPos] = uwZeroBucket;
+			bucketAdd(uwZeroBucket, uwPos);
+		}
+	}
+
+	static std::uint16_t hash(std::uint8_t ubA, std::uint8_t ubB, std::uint8_t ubC)
+	{
+		std::uint32_t ulKey = (ubA << 16) | (ubB << 8) | ubC;
+		return std::uint16_t((ulKey * 2654435761u) >> 21);
+	}
+
+	void bucketAdd(std::uint16_t uwBucket, std::uint16_t uwPos)
+	{
+		auto &Word = vBucketBits[uwBucket * s_uwWordsPerBucket + uwPos / 64];
+		Word |= std::uint64_t(1) << (uwPos % 64);
+		vBucketSummary[uwBucket] |= std::uint64_t(1) << (uwPos / 64);
+	}
+
+	void bucketRemove(std::uint16_t uwBucket, std::uint16_t uwPos)
+	{
+		auto &Word = vBucketBits[uwBucket * s_uwWordsPerBucket + uwPos / 64];
+		Word &= ~(std::uint64_t(1) << (uwPos % 64));
+		if(!Word) {
+			vBucketSummary[uwBucket] &= ~(std::uint64_t(1) << (uwPos / 64));
+		}
+	}
+
+	void rehash(std::uint16_t uwPos)
+	{
+		auto uwBucket = hash(
+			pLookup[uwPos], pLookup[(uwPos + 1) & 0xfff], pLookup[(uwPos + 2) & 0xfff]
+		);
+		if(uwBucket != pPosBucket[uwPos]) {
+			bucketRemove(pPosBucket[uwPos], uwPos);
+			bucketAdd(uwBucket, uwPos);
+			pPosBucket[uwPos] = uwBucket;
+		}
+	}
+
+	void write(std::uint8_t ubByte)
+	{
+		// Byte at given pos is a part of hashes of 3 positions
+		auto uwPos = uwLookupWritePos;
+		pLookup[uwPos] = ubByte;
+		rehash((uwPos - 2) & 0xfff);
+		rehash((uwPos - 1) & 0xfff);
+		rehash(uwPos);
+		uwLookupWritePos = (uwPos + 1) & 0xfff;
+		uwLookupLength = std::min(0x1000, uwLookupLength + 1);
+	}
+
+	bool find(
+		const uint8_t *pData, std::uint32_t ulMatchLimit,
+		std::uint16_t *pMatchPosition, std::uint8_t *pMatchLength
+	) const
+	{
+		*pMatchPosition = 0;
+		*pMatchLength = 0;
+		if(ulMatchLimit < s_RleMinLength) {
+			return false;
+		}
+
+		auto uwBucket = hash(pData[0], pData[1], pData[2]);
+		const auto *pBits = &vBucketBits[uwBucket * s_uwWordsPerBucket];
+		auto ullSummary = vBucketSummary[uwBucket];
+		std::uint32_t ulBestLength = 0;
+		while(ullSummary) {
+			auto ubWord = std::countr_zero(ullSummary);
+			ullSummary &= ullSummary - 1;
+			if(ubWord * 64 >= uwLookupLength) {
 				break;
 			}
-		}
-		if (ulMatchedLength >= s_RleMinLength) {
-			if(ulMatchedLength > *pMatchLength) {
-				*pMatchPosition = i;
-				*pMatchLength = ulMatchedLength;
-				isFound = true;
+			auto ullBits = pBits[ubWord];
+			while(ullBits) {
+				std::uint16_t uwPos = ubWord * 64 + std::countr_zero(ullBits);
+				ullBits &= ullBits - 1;
+				if(uwPos >= uwLookupLength) {
+					break;
+				}
+				auto ulLength = rleTableMatchLength(
+					pLookup, uwLookupLength, uwLookupWritePos, pData, ulMatchLimit, uwPos
+				);
+				if(ulLength >= s_RleMinLength && ulLength > ulBestLength) {
+					*pMatchPosition = uwPos;
+					*pMatchLength = std::uint8_t(ulLength);
+					ulBestLength = ulLength;
+					if(ulBestLength == ulMatchLimit) {
+						// Nothing further may be strictly longer
+						return true;
+					}
+				}
 			}
 		}
-	}
 
-	return isFound;
-}
+		return ulBestLength != 0;
+	}
+};
 
 static void rleTableWrite(uint8_t *table, std::uint16_t *index, uint8_t byte)
 {
@@ -171,12 +291,10 @@ std::uint32_t compressPack(
 	uint8_t *pDest, bool isVerbose
 ) {
 	if(isVerbose) fmt::println("Compress start, size {}", ulSrcSize);
-	std::uint8_t pLookup[0x1000] = {0};
+	auto pFinder = std::make_unique<tRleMatchFinder>();
 	std::uint32_t ulSrcOffset = 0, ulDestOffset = 0, ulCtrlByteOffset;
-	std::uint16_t uwLookupWritePos = 0;
 	std::uint16_t uwRleMatchPosition;
 	std::uint8_t ubRleMatchLength;
-	std::uint16_t uwLookupLength = 0;
 	std::uint16_t uwRleCtl;
 
 	while (ulSrcOffset < ulSrcSize) {
@@ -190,9 +308,8 @@ std::uint32_t compressPack(
 			}
 
 			// Try to find an repeated sequence
-			bool isFound = rleTableFind(
-				pLookup, uwLookupLength, uwLookupWritePos, &pSrc[ulSrcOffset],
-				std::min(ulSrcSize - ulSrcOffset, s_RleMaxLength),
+			bool isFound = pFinder->find(
+				&pSrc[ulSrcOffset], std::min(ulSrcSize - ulSrcOffset, s_RleMaxLength),
 				&uwRleMatchPosition, &ubRleMatchLength
 			);
 			if (isFound) {
@@ -210,8 +327,7 @@ std::uint32_t compressPack(
 				pDest[ulDestOffset++] = std::uint8_t(uwRleCtl);
 
 				for (std::uint8_t i = 0; i < ubRleMatchLength; i++) {
-					rleTableWrite(pLookup, &uwLookupWritePos, pSrc[ulSrcOffset++]);
-					uwLookupLength = std::min(0x1000, uwLookupLength + 1);
+					pFinder->write(pSrc[ulSrcOffset++]);
 				}
 			}
 			else {
@@ -221,8 +337,7 @@ std::uint32_t compressPack(
 				auto RawByte = pSrc[ulSrcOffset++];
 				if(isVerbose) fmt::println("byte at {}: {:02X}", ulDestOffset, RawByte);
 				pDest[ulDestOffset++] = RawByte;
-				rleTableWrite(pLookup, &uwLookupWritePos, RawByte);
-				uwLookupLength = std::min(0x1000, uwLookupLength + 1);
+				pFinder->write(RawByte);
 			}
 		}
 		if(isVerbose) fmt::println("used ctl at {}: {:02X}", ulCtrlByteOffset, pDest[ulCtrlByteOffset]);
@@ -231,3 +346,358 @@ std::uint32_t compressPack(
 	if(isVerbose) fmt::println("compress done, length: {}", ulDestOffset);
 	return ulDestOffset;
 }
+
+std::uint32_t compressPackOptimal(
+	const uint8_t *pSrc, std::uint32_t ulSrcSize,
+	uint8_t *pDest, bool isVerbose
+) {
+	if(isVerbose) fmt::println("Optimal compress start, size {}", ulSrcSize);
+	static constexpr std::uint32_t s_ulWindowSize = 0x1000;
+	static constexpr std::uint32_t s_ulHashSize = 0x10000;
+	static constexpr std::uint32_t s_ulNone = std::numeric_limits<std::uint32_t>::max();
+
+	// Find longest match at each position, preferring the nearest one.
+	// Decoder copies byte by byte through the lookup table, so a match may
+	// overlap bytes it produces - same as in source data space.
+	std::vector<std::uint8_t> vMatchLength(ulSrcSize, 0);
+	std::vector<std::uint16_t> vMatchPos(ulSrcSize, 0);
+	std::vector<std::uint32_t> vHashHead(s_ulHashSize, s_ulNone);
+	std::vector<std::uint32_t> vHashPrev(ulSrcSize, s_ulNone);
+	auto hash = [pSrc](std::uint32_t ulPos) {
+		std::uint32_t ulKey = (pSrc[ulPos] << 16) | (pSrc[ulPos + 1] << 8) | pSrc[ulPos + 2];
+		return (ulKey * 2654435761u) >> 16;
+	};
+	for(std::uint32_t ulPos = 0; ulPos + s_RleMinLength <= ulSrcSize; ++ulPos) {
+		auto ulHash = hash(ulPos);
+		std::uint32_t ulLimit = std::min(ulSrcSize - ulPos, s_RleMaxLength);
+		std::uint32_t ulBestLength = 0;
+		for(
+			auto ulCandidate = vHashHead[ulHash];
+			ulCandidate != s_ulNone && ulPos - ulCandidate <= s_ulWindowSize;
+			ulCandidate = vHashPrev[ulCandidate]
+		) {
+			std::uint32_t ulLength = 0;
+			while(ulLength < ulLimit && pSrc[ulCandidate + ulLength] == pSrc[ulPos + ulLength]) {
+				++ulLength;
+			}
+			if(ulLength > ulBestLength) {
+				ulBestLength = ulLength;
+				vMatchPos[ulPos] = std::uint16_t(ulCandidate & 0xfff);
+				if(ulLength == ulLimit) {
+					break;
+				}
+			}
+		}
+		if(ulBestLength >= s_RleMinLength) {
+			vMatchLength[ulPos] = std::uint8_t(ulBestLength);
+		}
+		vHashPrev[ulPos] = vHashHead[ulHash];
+		vHashHead[ulHash] = ulPos;
+	}
+
+	// Exact output size is minimized: state is the number of tokens already
+	// put in current control byte, since the token which starts a new group
+	// also costs the control byte. Costs are only needed up to max match
+	// length ahead, hence the ring of cost rows.
+	static constexpr std::uint32_t s_ulCtlBits = 8;
+	static constexpr std::uint32_t s_ulCostRows = s_RleMaxLength + 1;
+	std::vector<std::uint32_t> vCost(s_ulCostRows * s_ulCtlBits, 0);
+	std::vector<std::uint8_t> vChoice(std::size_t(ulSrcSize) * s_ulCtlBits, 0);
+	auto costAt = [&vCost](std::uint32_t ulPos, std::uint32_t ulBit) -> std::uint32_t & {
+		return vCost[(ulPos % s_ulCostRows) * s_ulCtlBits + ulBit];
+	};
+	for(std::uint32_t ulBit = 0; ulBit < s_ulCtlBits; ++ulBit) {
+		costAt(ulSrcSize, ulBit) = 0;
+	}
+	for(std::uint32_t ulPos = ulSrcSize; ulPos-- > 0;) {
+		// Row of ulPos is shared only with ulPos + s_ulCostRows, which is out
+		// of reach of any token, so it may be overwritten right away.
+		for(std::uint32_t ulBit = 0; ulBit < s_ulCtlBits; ++ulBit) {
+			std::uint32_t ulCtlCost = (ulBit == 0) ? 1 : 0;
+			std::uint32_t ulNextBit = (ulBit + 1) % s_ulCtlBits;
+			std::uint32_t ulBestCost = ulCtlCost + 1 + costAt(ulPos + 1, ulNextBit);
+			std::uint8_t ubBestChoice = 0;
+			for(std::uint32_t ulLength = s_RleMinLength; ulLength <= vMatchLength[ulPos]; ++ulLength) {
+				std::uint32_t ulCost = ulCtlCost + 2 + costAt(ulPos + ulLength, ulNextBit);
+				if(ulCost < ulBestCost) {
+					ulBestCost = ulCost;
+					ubBestChoice = std::uint8_t(ulLength);
+				}
+			}
+			vChoice[std::size_t(ulPos) * s_ulCtlBits + ulBit] = ubBestChoice;
+			costAt(ulPos, ulBit) = ulBestCost;
+		}
+	}
+
+	// Emit tokens along the chosen path
+	std::uint32_t ulSrcOffset = 0, ulDestOffset = 0, ulCtrlByteOffset = 0;
+	std::uint32_t ulBit = 0;
+	while(ulSrcOffset < ulSrcSize) {
+		if(ulBit == 0) {
+			ulCtrlByteOffset = ulDestOffset++;
+			pDest[ulCtrlByteOffset] = 0;
+		}
+		auto ubChoice = vChoice[std::size_t(ulSrcOffset) * s_ulCtlBits + ulBit];
+		if(ubChoice) {
+			std::uint16_t uwRleCtl = (ubChoice - 3) & 0xf;
+			uwRleCtl |= (vMatchPos[ulSrcOffset] & 0xfff) << 4;
+			if(isVerbose) fmt::println(
+				"sequence at {}, word: {:04X}, len: {}, index: {}",
+				ulDestOffset, uwRleCtl, ubChoice, vMatchPos[ulSrcOffset]
+			);
+			pDest[ulDestOffset++] = uwRleCtl >> 8;
+			pDest[ulDestOffset++] = std::uint8_t(uwRleCtl);
+			ulSrcOffset += ubChoice;
+		}
+		else {
+			pDest[ulCtrlByteOffset] |= (1 << ulBit);
+			if(isVerbose) fmt::println("byte at {}: {:02X}", ulDestOffset, pSrc[ulSrcOffset]);
+			pDest[ulDestOffset++] = pSrc[ulSrcOffset++];
+		}
+		ulBit = (ulBit + 1) % s_ulCtlBits;
+	}
+
+	if(isVerbose) fmt::println("optimal compress done, length: {}", ulDestOffset);
+	return ulDestOffset;
+}
+
+// Keep in sync with UNPACKER_FAST_* defines in src/ace/utils/pak_file.c
+static constexpr std::uint32_t s_ulFastBlockSize = 0x1000;
+static constexpr std::uint32_t s_ulFastBlockHeaderSize = 2;
+static constexpr std::uint32_t s_ulFastPackedBlockMax = s_ulFastBlockSize + 32;
+static constexpr std::uint32_t s_ulFastRingSize = 2 * s_ulFastBlockSize;
+static constexpr std::uint32_t s_ulFastMinMatch = 4;
+static constexpr std::uint32_t s_ulFastLengthExtended = 15;
+
+static void fastWriteLengthExtra(
+	uint8_t *pDest, std::uint32_t &ulDestOffset, std::uint32_t ulLength
+) {
+	if(ulLength < s_ulFastLengthExtended) {
+		return;
+	}
+	ulLength -= s_ulFastLengthExtended;
+	while(ulLength >= 0xFF) {
+		pDest[ulDestOffset++] = 0xFF;
+		ulLength -= 0xFF;
+	}
+	pDest[ulDestOffset++] = std::uint8_t(ulLength);
+}
+
+static bool fastReadLengthExtra(
+	const uint8_t *pPacked, std::uint32_t &ulOffset, std::uint32_t ulEnd,
+	std::uint32_t &ulLength
+) {
+	if(ulLength < s_ulFastLengthExtended) {
+		return true;
+	}
+	std::uint8_t ubExtra;
+	do {
+		if(ulOffset >= ulEnd) {
+			return false;
+		}
+		ubExtra = pPacked[ulOffset++];
+		ulLength += ubExtra;
+	} while(ubExtra == 0xFF);
+	return true;
+}
+
+std::uint32_t compressPackFastGetMaxSize(std::uint32_t ulSrcSize) {
+	std::uint32_t ulBlockCount = (ulSrcSize + s_ulFastBlockSize - 1) / s_ulFastBlockSize;
+	return ulBlockCount * (s_ulFastBlockHeaderSize + s_ulFastPackedBlockMax);
+}
+
+std::uint32_t compressPackFast(
+	const uint8_t *pSrc, std::uint32_t ulSrcSize, uint8_t *pDest
+) {
+	static constexpr std::uint32_t s_ulHashBits = 14;
+	static constexpr std::uint32_t s_ulMaxChainDepth = 256;
+	static constexpr std::uint32_t s_ulNone = std::numeric_limits<std::uint32_t>::max();
+
+	std::vector<std::uint32_t> vHashHead(1 << s_ulHashBits, s_ulNone);
+	std::vector<std::uint32_t> vHashPrev(ulSrcSize, s_ulNone);
+	std::uint32_t ulInsertedEnd = 0;
+	auto insertUpTo = [&](std::uint32_t ulEnd) {
+		for(; ulInsertedEnd < ulEnd; ++ulInsertedEnd) {
+			if(ulInsertedEnd + s_ulFastMinMatch > ulSrcSize) {
+				continue;
+			}
+			std::uint32_t ulKey;
+			std::memcpy(&ulKey, &pSrc[ulInsertedEnd], sizeof(ulKey));
+			auto ulHash = (ulKey * 2654435761u) >> (32 - s_ulHashBits);
+			vHashPrev[ulInsertedEnd] = vHashHead[ulHash];
+			vHashHead[ulHash] = ulInsertedEnd;
+		}
+	};
+
+	// Decoder keeps the previous block and current one in its ring, so the
+	// window is one block long. Match can't go past the end of current block,
+	// nor can its source wrap around the ring.
+	auto findMatch = [&](
+		std::uint32_t ulPos, std::uint32_t ulBlockEnd, std::uint32_t &ulBestDistance
+	) {
+		insertUpTo(ulPos);
+		std::uint32_t ulBestLength = 0;
+		if(ulPos + s_ulFastMinMatch > ulBlockEnd) {
+			return ulBestLength;
+		}
+		std::uint32_t ulKey;
+		std::memcpy(&ulKey, &pSrc[ulPos], sizeof(ulKey));
+		auto ulHash = (ulKey * 2654435761u) >> (32 - s_ulHashBits);
+		std::uint32_t ulDepth = 0;
+		for(
+			auto ulCandidate = vHashHead[ulHash];
+			ulCandidate != s_ulNone && ulPos - ulCandidate <= s_ulFastBlockSize &&
+			ulDepth < s_ulMaxChainDepth;
+			ulCandidate = vHashPrev[ulCandidate], ++ulDepth
+		) {
+			std::uint32_t ulLimit = std::min(
+				ulBlockEnd - ulPos, s_ulFastRingSize - (ulCandidate % s_ulFastRingSize)
+			);
+			std::uint32_t ulLength = 0;
+			while(ulLength < ulLimit && pSrc[ulCandidate + ulLength] == pSrc[ulPos + ulLength]) {
+				++ulLength;
+			}
+			if(ulLength > ulBestLength) {
+				ulBestLength = ulLength;
+				ulBestDistance = ulPos - ulCandidate;
+				if(ulLength == ulLimit) {
+					break;
+				}
+			}
+		}
+		return ulBestLength >= s_ulFastMinMatch ? ulBestLength : 0;
+	};
+
+	std::uint32_t ulDestOffset = 0;
+	auto writeSequence = [&](
+		std::uint32_t ulLiteralStart, std::uint32_t ulLiteralCount,
+		std::uint32_t ulDistance, std::uint32_t ulMatchLength
+	) {
+		std::uint32_t ulMatchCode = ulMatchLength ? ulMatchLength - s_ulFastMinMatch : 0;
+		pDest[ulDestOffset++] = std::uint8_t(
+			(std::min(ulLiteralCount, s_ulFastLengthExtended) << 4) |
+			std::min(ulMatchCode, s_ulFastLengthExtended)
+		);
+		fastWriteLengthExtra(pDest, ulDestOffset, ulLiteralCount);
+		std::memcpy(&pDest[ulDestOffset], &pSrc[ulLiteralStart], ulLiteralCount);
+		ulDestOffset += ulLiteralCount;
+		if(ulMatchLength) {
+			pDest[ulDestOffset++] = std::uint8_t(ulDistance >> 8);
+			pDest[ulDestOffset++] = std::uint8_t(ulDistance);
+			fastWriteLengthExtra(pDest, ulDestOffset, ulMatchCode);
+		}
+	};
+
+	for(std::uint32_t ulBlockStart = 0; ulBlockStart < ulSrcSize; ulBlockStart += s_ulFastBlockSize) {
+		std::uint32_t ulBlockEnd = std::min(ulBlockStart + s_ulFastBlockSize, ulSrcSize);
+		std::uint32_t ulHeaderOffset = ulDestOffset;
+		ulDestOffset += s_ulFastBlockHeaderSize;
+
+		std::uint32_t ulPos = ulBlockStart, ulLiteralStart = ulBlockStart;
+		while(ulPos < ulBlockEnd) {
+			std::uint32_t ulDistance = 0;
+			std::uint32_t ulLength = findMatch(ulPos, ulBlockEnd, ulDistance);
+			if(!ulLength) {
+				++ulPos;
+				continue;
+			}
+
+			// Lazy matching: prefer a longer match starting one byte later
+			std::uint32_t ulNextDistance = 0;
+			std::uint32_t ulNextLength = findMatch(ulPos + 1, ulBlockEnd, ulNextDistance);
+			if(ulNextLength > ulLength + 1) {
+				++ulPos;
+				ulLength = ulNextLength;
+				ulDistance = ulNextDistance;
+			}
+
+			writeSequence(ulLiteralStart, ulPos - ulLiteralStart, ulDistance, ulLength);
+			ulPos += ulLength;
+			ulLiteralStart = ulPos;
+		}
+		if(ulLiteralStart < ulBlockEnd) {
+			writeSequence(ulLiteralStart, ulBlockEnd - ulLiteralStart, 0, 0);
+		}
+
+		std::uint32_t ulPackedSize = ulDestOffset - ulHeaderOffset - s_ulFastBlockHeaderSize;
+		if(ulPackedSize > s_ulFastPackedBlockMax) {
+			// Can't happen since matches are never longer than what they encode
+			throw std::runtime_error(fmt::format("Fast block too big: {}", ulPackedSize));
+		}
+		pDest[ulHeaderOffset] = std::uint8_t(ulPackedSize >> 8);
+		pDest[ulHeaderOffset + 1] = std::uint8_t(ulPackedSize);
+	}
+	return ulDestOffset;
+}
+
+bool compressUnpackFast(
+	const uint8_t *pPacked, std::uint32_t ulPackedSize,
+	uint8_t *pDest, std::uint32_t ulDestSize
+) {
+	std::vector<std::uint8_t> vRing(s_ulFastRingSize);
+	std::uint32_t ulIn = 0;
+	for(std::uint32_t ulBlockStart = 0; ulBlockStart < ulDestSize; ulBlockStart += s_ulFastBlockSize) {
+		if(ulIn + s_ulFastBlockHeaderSize > ulPackedSize) {
+			return false;
+		}
+		std::uint32_t ulBlockPackedSize = (pPacked[ulIn] << 8) | pPacked[ulIn + 1];
+		ulIn += s_ulFastBlockHeaderSize;
+		std::uint32_t ulInEnd = ulIn + ulBlockPackedSize;
+		if(ulBlockPackedSize > s_ulFastPackedBlockMax || ulInEnd > ulPackedSize) {
+			return false;
+		}
+
+		std::uint32_t ulBlockSize = std::min(s_ulFastBlockSize, ulDestSize - ulBlockStart);
+		std::uint32_t ulOutStart = ulBlockStart % s_ulFastRingSize;
+		std::uint32_t ulOut = ulOutStart, ulOutEnd = ulOutStart + ulBlockSize;
+		while(ulOut < ulOutEnd) {
+			if(ulIn >= ulInEnd) {
+				return false;
+			}
+			std::uint8_t ubToken = pPacked[ulIn++];
+			std::uint32_t ulLength = ubToken >> 4;
+			if(
+				!fastReadLengthExtra(pPacked, ulIn, ulInEnd, ulLength) ||
+				ulIn + ulLength > ulInEnd || ulOut + ulLength > ulOutEnd
+			) {
+				return false;
+			}
+			std::memcpy(&vRing[ulOut], &pPacked[ulIn], ulLength);
+			ulOut += ulLength;
+			ulIn += ulLength;
+			if(ulOut == ulOutEnd) {
+				break;
+			}
+
+			if(ulIn + 2 > ulInEnd) {
+				return false;
+			}
+			std::uint32_t ulDistance = (pPacked[ulIn] << 8) | pPacked[ulIn + 1];
+			ulIn += 2;
+			ulLength = ubToken & 0xF;
+			if(!fastReadLengthExtra(pPacked, ulIn, ulInEnd, ulLength)) {
+				return false;
+			}
+			ulLength += s_ulFastMinMatch;
+			std::uint32_t ulUnpackedPos = ulBlockStart + (ulOut - ulOutStart);
+			if(
+				!ulDistance || ulDistance > s_ulFastBlockSize || ulDistance > ulUnpackedPos ||
+				ulOut + ulLength > ulOutEnd
+			) {
+				return false;
+			}
+			std::uint32_t ulSrc = (ulOut + s_ulFastRingSize - ulDistance) % s_ulFastRingSize;
+			if(ulSrc + ulLength > s_ulFastRingSize) {
+				return false;
+			}
+			for(std::uint32_t i = 0; i < ulLength; ++i) {
+				vRing[ulOut++] = vRing[ulSrc++];
+			}
+		}
+		if(ulIn != ulInEnd) {
+			return false;
+		}
+		std::memcpy(&pDest[ulBlockStart], &vRing[ulOutStart], ulBlockSize);
+	}
+	return ulIn == ulPackedSize;
+}
@@ -41,6 +41,41 @@ std::uint32_t compressPack(
 	uint8_t *pDest, bool isVerbose = false
 );
 
+/**
+ * @brief Same stream format as compressPack(), but chooses between literals
+ * and matches of each possible length so that the output is smallest.
+ * Much slower and uses ~15 bytes of memory per input byte.
+ */
+std::uint32_t compressPackOptimal(
+	const uint8_t *pSrc, std::uint32_t ulSrcSize,
+	uint8_t *pDest, bool isVerbose = false
+);
+
+/**
+ * @brief Packs data into byte-aligned LZ stream which decodes much faster than
+ * compressPack() one, at the cost of slightly worse ratio. See
+ * PAK_FILE_CODEC_LZ_FAST in src/ace/utils/pak_file.c for the format.
+ *
+ * @param pDest Destination buffer, at least compressPackFastGetMaxSize() long.
+ * @return Packed size.
+ */
+std::uint32_t compressPackFast(
+	const uint8_t *pSrc, std::uint32_t ulSrcSize, uint8_t *pDest
+);
+
+std::uint32_t compressPackFastGetMaxSize(std::uint32_t ulSrcSize);
+
+/**
+ * @brief Unpacks compressPackFast() stream, the same way as the engine does.
+ *
+ * @return True if the stream is valid and unpacks to exactly ulDestSize bytes,
+ * otherwise false.
+ */
+bool compressUnpackFast(
+	const uint8_t *pPacked, std::uint32_t ulPackedSize,
+	uint8_t *pDest, std::uint32_t ulDestSize
+);
+
 void compressUnpackerInit(
 	tCompressUnpacker *pUnpacker, const uint8_t *pCompressed, size_t ulCompressedSize,
 	size_t ulUncompressedSize, bool isVerbose = false
@@ -0,0 +1,437 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "custom_model.h"
+#include <cstring>
+
+static constexpr std::uint16_t s_uwBltCon0UseA = 0x0800;
+static constexpr std::uint16_t s_uwBltCon0UseB = 0x0400;
+static constexpr std::uint16_t s_uwBltCon0UseC = 0x0200;
+static constexpr std::uint16_t s_uwBltCon0UseD = 0x0100;
+static constexpr std::uint16_t s_uwBltCon1Line = 0x0001;
+static constexpr std::uint16_t s_uwBltCon1Desc = 0x0002; // also SING in line mode
+static constexpr std::uint16_t s_uwBltCon1FillCarryIn = 0x0004; // also AUL in line mode
+static constexpr std::uint16_t s_uwBltCon1FillInclusive = 0x0008; // also SUL in line mode
+static constexpr std::uint16_t s_uwBltCon1FillExclusive = 0x0010; // also SUD in line mode
+static constexpr std::uint16_t s_uwBltCon1Sign = 0x0040;
+static constexpr std::uint16_t s_uwDmaConSetClr = 0x8000;
+static constexpr std::uint16_t s_uwDmaConBlitZero = 0x2000;
+static constexpr std::uint16_t s_uwCopConDanger = 0x0002;
+
+static constexpr std::uint16_t s_uwFrameLines = 312; // PAL
+static constexpr std::uint16_t s_uwLineColorClocks = 227;
+static constexpr std::uint8_t s_ubCopperInstructionColorClocks = 4;
+static constexpr std::uint8_t s_ubCopperInstructionCycles = 2;
+static constexpr std::uint8_t s_ubLinePixelCycles = 4;
+
+// DMA cycles per blitted word, indexed by USEA..USED bits of BLTCON0.
+// Based on HRM's "Typical Blitter Cycle Sequence" table - idle slots included.
+// C+D is interleaved as C0 - C1 D0 - C2 D1, so it takes only 2 cycles per word.
+static constexpr std::uint8_t s_pBlitWordCycles[16] = {
+	2, 2, 2, 2, 3, 3, 3, 4, 2, 2, 2, 3, 3, 3, 3, 4
+};
+
+static std::uint16_t blitMinterm(
+	std::uint16_t uwA, std::uint16_t uwB, std::uint16_t uwC, std::uint8_t ubMinterm
+) {
+	// Each minterm bit selects one combination of A, B, C bits, MSB being ABC
+	std::uint16_t uwD = 0;
+	for(std::uint8_t ubTerm = 0; ubTerm < 8; ++ubTerm) {
+		if(ubMinterm & (1 << ubTerm)) {
+			uwD |= (
+				((ubTerm & 4) ? uwA : ~uwA) &
+				((ubTerm & 2) ? uwB : ~uwB) &
+				((ubTerm & 1) ? uwC : ~uwC)
+			);
+		}
+	}
+	return uwD;
+}
+
+tCustomModel::tCustomModel(std::uint32_t ulChipSize, bool isEcs):
+	m_vChipMem(ulChipSize, 0),
+	m_ulChipMask((ulChipSize - 1) & ~1u),
+	m_isEcs(isEcs)
+{
+	std::memset(m_pRegs, 0, sizeof(m_pRegs));
+}
+
+void tCustomModel::writeReg(std::uint16_t uwReg, std::uint16_t uwValue)
+{
+	uwReg &= (CUSTOM_REG_COUNT - 2);
+	switch(uwReg) {
+		case CUSTOM_REG_DMACON:
+			if(uwValue & s_uwDmaConSetClr) {
+				m_uwDmaCon |= uwValue & ~s_uwDmaConSetClr;
+			}
+			else {
+				m_uwDmaCon &= ~uwValue;
+			}
+			break;
+		case CUSTOM_REG_BLTCON0L:
+			m_pRegs[CUSTOM_REG_BLTCON0 / 2] = (m_pRegs[CUSTOM_REG_BLTCON0 / 2] & 0xFF00) | (uwValue & 0xFF);
+			break;
+		case CUSTOM_REG_BLTSIZE:
+			m_pRegs[uwReg / 2] = uwValue;
+			blitStart(
+				(uwValue & 0x3F) ? (uwValue & 0x3F) : 64,
+				(uwValue >> 6) ? (uwValue >> 6) : 1024
+			);
+			return;
+		case CUSTOM_REG_BLTSIZV:
+			m_uwBlitSizeV = uwValue & 0x7FFF;
+			break;
+		case CUSTOM_REG_BLTSIZH:
+			if(m_isEcs) {
+				m_pRegs[uwReg / 2] = uwValue;
+				blitStart(
+					(uwValue & 0x7FF) ? (uwValue & 0x7FF) : 2048,
+					m_uwBlitSizeV ? m_uwBlitSizeV : 32768
+				);
+				return;
+			}
+			break;
+		case CUSTOM_REG_COPJMP1:
+			m_ulCopperPc = getRegLong(CUSTOM_REG_COP1LCH);
+			break;
+		case CUSTOM_REG_COPJMP2:
+			m_ulCopperPc = getRegLong(CUSTOM_REG_COP2LCH);
+			break;
+		default:
+			break;
+	}
+	m_pRegs[uwReg / 2] = uwValue;
+}
+
+void tCustomModel::writeRegLong(std::uint16_t uwReg, std::uint32_t ulValue)
+{
+	writeReg(uwReg, ulValue >> 16);
+	writeReg(uwReg + 2, ulValue & 0xFFFF);
+}
+
+std::uint16_t tCustomModel::readReg(std::uint16_t uwReg) const
+{
+	uwReg &= (CUSTOM_REG_COUNT - 2);
+	if(uwReg == CUSTOM_REG_DMACONR) {
+		// Blits are done instantly, so BBUSY is never set
+		return (m_uwDmaCon & 0x07FF) | (m_isBlitZero ? s_uwDmaConBlitZero : 0);
+	}
+	return m_pRegs[uwReg / 2];
+}
+
+std::uint16_t tCustomModel::readChipWord(std::uint32_t ulAddr) const
+{
+	ulAddr &= m_ulChipMask;
+	return (m_vChipMem[ulAddr] << 8) | m_vChipMem[ulAddr + 1];
+}
+
+void tCustomModel::writeChipWord(std::uint32_t ulAddr, std::uint16_t uwValue)
+{
+	ulAddr &= m_ulChipMask;
+	m_vChipMem[ulAddr] = uwValue >> 8;
+	m_vChipMem[ulAddr + 1] = uwValue & 0xFF;
+}
+
+void tCustomModel::resetStats(void)
+{
+	m_sStats = tCustomModelStats();
+	m_ulLastBlitCycles = 0;
+}
+
+std::uint32_t tCustomModel::getRegLong(std::uint16_t uwReg) const
+{
+	return (
+		(std::uint32_t(m_pRegs[uwReg / 2]) << 16) | m_pRegs[uwReg / 2 + 1]
+	) & m_ulChipMask;
+}
+
+void tCustomModel::setRegLong(std::uint16_t uwReg, std::uint32_t ulValue)
+{
+	ulValue &= m_ulChipMask;
+	m_pRegs[uwReg / 2] = ulValue >> 16;
+	m_pRegs[uwReg / 2 + 1] = ulValue & 0xFFFF;
+}
+
+void tCustomModel::blitStart(std::uint16_t uwWidth, std::uint16_t uwHeight)
+{
+	if(m_pRegs[CUSTOM_REG_BLTCON1 / 2] & s_uwBltCon1Line) {
+		blitLine(uwHeight);
+	}
+	else {
+		blitArea(uwWidth, uwHeight);
+	}
+	++m_sStats.ullBlitCount;
+	m_sStats.ullBlitCycles += m_ulLastBlitCycles;
+}
+
+void tCustomModel::blitArea(std::uint16_t uwWidth, std::uint16_t uwHeight)
+{
+	std::uint16_t uwBltCon0 = m_pRegs[CUSTOM_REG_BLTCON0 / 2];
+	std::uint16_t uwBltCon1 = m_pRegs[CUSTOM_REG_BLTCON1 / 2];
+	std::uint8_t ubShiftA = uwBltCon0 >> 12;
+	std::uint8_t ubShiftB = uwBltCon1 >> 12;
+	std::uint8_t ubMinterm = uwBltCon0 & 0xFF;
+	bool isDesc = uwBltCon1 & s_uwBltCon1Desc;
+	bool isFillInclusive = uwBltCon1 & s_uwBltCon1FillInclusive;
+	bool isFill = isFillInclusive || (uwBltCon1 & s_uwBltCon1FillExclusive);
+	std::int32_t lStep = isDesc ? -2 : 2;
+
+	// Low bit of modulos is ignored by hardware
+	auto getModulo = [&](std::uint16_t uwReg) {
+		std::int32_t lMod = std::int16_t(m_pRegs[uwReg / 2] & 0xFFFE);
+		return isDesc ? -lMod : lMod;
+	};
+
+	struct tChannel {
+		bool isUsed;
+		std::uint32_t ulPtr;
+		std::int32_t lModulo;
+		std::uint16_t uwData;
+	} pChannels[4] = {
+		{
+			bool(uwBltCon0 & s_uwBltCon0UseA), getRegLong(CUSTOM_REG_BLTAPTH),
+			getModulo(CUSTOM_REG_BLTAMOD), m_pRegs[CUSTOM_REG_BLTADAT / 2]
+		},
+		{
+			bool(uwBltCon0 & s_uwBltCon0UseB), getRegLong(CUSTOM_REG_BLTBPTH),
+			getModulo(CUSTOM_REG_BLTBMOD), m_pRegs[CUSTOM_REG_BLTBDAT / 2]
+		},
+		{
+			bool(uwBltCon0 & s_uwBltCon0UseC), getRegLong(CUSTOM_REG_BLTCPTH),
+			getModulo(CUSTOM_REG_BLTCMOD), m_pRegs[CUSTOM_REG_BLTCDAT / 2]
+		},
+		{
+			bool(uwBltCon0 & s_uwBltCon0UseD), getRegLong(CUSTOM_REG_BLTDPTH),
+			getModulo(CUSTOM_REG_BLTDMOD), 0
+		},
+	};
+	tChannel &A = pChannels[0], &B = pChannels[1], &C = pChannels[2], &D = pChannels[3];
+
+	// Previous words used for shifting in new ones - assumed to be zeroed
+	// on blit start, so that the results don't depend on earlier blits.
+	std::uint16_t uwPrevA = 0, uwPrevB = 0;
+	m_isBlitZero = true;
+	for(std::uint16_t uwY = 0; uwY < uwHeight; ++uwY) {
+		bool isFillCarry = uwBltCon1 & s_uwBltCon1FillCarryIn;
+		for(std::uint16_t uwX = 0; uwX < uwWidth; ++uwX) {
+			for(auto &Channel: pChannels) {
+				if(Channel.isUsed && &Channel != &D) {
+					Channel.uwData = readChipWord(Channel.ulPtr);
+					Channel.ulPtr += lStep;
+				}
+			}
+
+			std::uint16_t uwA = A.uwData;
+			if(uwX == 0) {
+				uwA &= m_pRegs[CUSTOM_REG_BLTAFWM / 2];
+			}
+			if(uwX == uwWidth - 1) {
+				uwA &= m_pRegs[CUSTOM_REG_BLTALWM / 2];
+			}
+
+			std::uint16_t uwShiftedA, uwShiftedB;
+			if(isDesc) {
+				uwShiftedA = ((std::uint32_t(uwA) << 16 | uwPrevA) << ubShiftA) >> 16;
+				uwShiftedB = ((std::uint32_t(B.uwData) << 16 | uwPrevB) << ubShiftB) >> 16;
+			}
+			else {
+				uwShiftedA = (std::uint32_t(uwPrevA) << 16 | uwA) >> ubShiftA;
+				uwShiftedB = (std::uint32_t(uwPrevB) << 16 | B.uwData) >> ubShiftB;
+			}
+			uwPrevA = uwA;
+			uwPrevB = B.uwData;
+
+			std::uint16_t uwD = blitMinterm(uwShiftedA, uwShiftedB, C.uwData, ubMinterm);
+			if(isFill) {
+				// Fill goes from right to left, so it needs descending mode
+				std::uint16_t uwFilled = 0;
+				for(std::uint8_t ubBit = 0; ubBit < 16; ++ubBit) {
+					bool isSet = uwD & (1 << ubBit);
+					bool isOut = isFillInclusive ? (isFillCarry || isSet) : (isFillCarry != isSet);
+					isFillCarry = isFillCarry != isSet;
+					if(isOut) {
+						uwFilled |= 1 << ubBit;
+					}
+				}
+				uwD = uwFilled;
+			}
+
+			if(uwD) {
+				m_isBlitZero = false;
+			}
+			if(D.isUsed) {
+				writeChipWord(D.ulPtr, uwD);
+				D.ulPtr += lStep;
+			}
+		}
+
+		for(auto &Channel: pChannels) {
+			if(Channel.isUsed) {
+				Channel.ulPtr += Channel.lModulo;
+			}
+		}
+	}
+
+	// Pointers continue from where the blit has ended, just like on hardware
+	setRegLong(CUSTOM_REG_BLTAPTH, A.ulPtr);
+	setRegLong(CUSTOM_REG_BLTBPTH, B.ulPtr);
+	setRegLong(CUSTOM_REG_BLTCPTH, C.ulPtr);
+	setRegLong(CUSTOM_REG_BLTDPTH, D.ulPtr);
+	m_pRegs[CUSTOM_REG_BLTADAT / 2] = A.uwData;
+	m_pRegs[CUSTOM_REG_BLTBDAT / 2] = B.uwData;
+	m_pRegs[CUSTOM_REG_BLTCDAT / 2] = C.uwData;
+
+	m_ulLastBlitCycles = std::uint32_t(uwWidth) * uwHeight * s_pBlitWordCycles[
+		(uwBltCon0 >> 8) & 0xF
+	];
+}
+
+void tCustomModel::blitLine(std::uint16_t uwHeight)
+{
+	// Octant bits: SUD set means that minor ("sometimes") steps are vertical,
+	// AUL makes major steps go up/left, SUL does the same for minor steps.
+	std::uint16_t uwBltCon0 = m_pRegs[CUSTOM_REG_BLTCON0 / 2];
+	std::uint16_t uwBltCon1 = m_pRegs[CUSTOM_REG_BLTCON1 / 2];
+	bool isOneDot = uwBltCon1 & s_uwBltCon1Desc;
+	bool isMajorNeg = uwBltCon1 & s_uwBltCon1FillCarryIn;
+	bool isMinorNeg = uwBltCon1 & s_uwBltCon1FillInclusive;
+	bool isMajorX = uwBltCon1 & s_uwBltCon1FillExclusive;
+	std::uint8_t ubMinterm = uwBltCon0 & 0xFF;
+	std::uint8_t ubShiftA = uwBltCon0 >> 12;
+	std::uint8_t ubShiftB = uwBltCon1 >> 12;
+	std::int16_t wError = std::int16_t(m_pRegs[CUSTOM_REG_BLTAPTL / 2]);
+	bool isSign = uwBltCon1 & s_uwBltCon1Sign;
+	std::int16_t wErrorIncPos = std::int16_t(m_pRegs[CUSTOM_REG_BLTAMOD / 2]);
+	std::int16_t wErrorIncNeg = std::int16_t(m_pRegs[CUSTOM_REG_BLTBMOD / 2]);
+	std::int32_t lRowStep = std::int16_t(m_pRegs[CUSTOM_REG_BLTCMOD / 2]);
+	std::uint16_t uwPixel = m_pRegs[CUSTOM_REG_BLTADAT / 2] & m_pRegs[CUSTOM_REG_BLTAFWM / 2];
+	std::uint16_t uwPattern = m_pRegs[CUSTOM_REG_BLTBDAT / 2];
+	std::uint32_t ulPtrC = getRegLong(CUSTOM_REG_BLTCPTH);
+	std::uint32_t ulPtrD = getRegLong(CUSTOM_REG_BLTDPTH);
+	bool isRowDrawn = false;
+
+	auto stepX = [&](bool isLeft) {
+		if(isLeft) {
+			if(ubShiftA-- == 0) {
+				ubShiftA = 15;
+				ulPtrC -= 2;
+			}
+		}
+		else if(++ubShiftA == 16) {
+			ubShiftA = 0;
+			ulPtrC += 2;
+		}
+	};
+	auto stepY = [&](bool isUp) {
+		ulPtrC += isUp ? -lRowStep : lRowStep;
+		isRowDrawn = false;
+	};
+
+	m_isBlitZero = true;
+	for(std::uint16_t i = 0; i < uwHeight; ++i) {
+		// Pattern is used MSB-first, starting from bit selected by BSH
+		bool isPatternSet = (uwPattern >> ((15 - ubShiftB) & 0xF)) & 1;
+		ubShiftB = (ubShiftB + 1) & 0xF;
+		std::uint16_t uwA = (isOneDot && isRowDrawn) ? 0 : (uwPixel >> ubShiftA);
+		std::uint16_t uwB = isPatternSet ? 0xFFFF : 0;
+		std::uint16_t uwD = blitMinterm(uwA, uwB, readChipWord(ulPtrC), ubMinterm);
+		if(uwD) {
+			m_isBlitZero = false;
+		}
+
+		// First pixel goes to BLTDPT, following ones to where C points at
+		writeChipWord(i ? ulPtrC : ulPtrD, uwD);
+		isRowDrawn = true;
+
+		if(isMajorX) {
+			stepX(isMajorNeg);
+		}
+		else {
+			stepY(isMajorNeg);
+		}
+		if(isSign) {
+			wError += wErrorIncNeg;
+		}
+		else {
+			wError += wErrorIncPos;
+			if(isMajorX) {
+				stepY(isMinorNeg);
+			}
+			else {
+				stepX(isMinorNeg);
+			}
+		}
+		isSign = wError < 0;
+	}
+
+	setRegLong(CUSTOM_REG_BLTCPTH, ulPtrC);
+	setRegLong(CUSTOM_REG_BLTDPTH, ulPtrC);
+	m_pRegs[CUSTOM_REG_BLTAPTL / 2] = std::uint16_t(wError);
+	m_pRegs[CUSTOM_REG_BLTCON0 / 2] = (uwBltCon0 & 0x0FFF) | (ubShiftA << 12);
+	m_pRegs[CUSTOM_REG_BLTCON1 / 2] = (
+		(uwBltCon1 & ~(0xF000 | s_uwBltCon1Sign)) | (ubShiftB << 12) |
+		(isSign ? s_uwBltCon1Sign : 0)
+	);
+	m_ulLastBlitCycles = std::uint32_t(uwHeight) * s_ubLinePixelCycles;
+}
+
+void tCustomModel::runCopperFrame(void)
+{
+	m_ulCopperPc = getRegLong(CUSTOM_REG_COP1LCH);
+	std::uint16_t uwBeamY = 0, uwBeamX = 0;
+	bool isSkipNext = false;
+
+	auto advanceBeam = [&](std::uint16_t uwColorClocks) {
+		uwBeamX += uwColorClocks;
+		while(uwBeamX >= s_uwLineColorClocks) {
+			uwBeamX -= s_uwLineColorClocks;
+			++uwBeamY;
+		}
+	};
+
+	// Vertical position bit 8 can't be compared, bit 7 can't be masked out
+	auto isBeamPast = [&](std::uint16_t uwFirst, std::uint16_t uwSecond) {
+		std::uint16_t uwMask = ((uwSecond | 0x8000) & 0xFFFE);
+		std::uint16_t uwBeam = ((uwBeamY & 0xFF) << 8) | (uwBeamX & 0xFE);
+		return (uwBeam & uwMask) >= (uwFirst & uwMask);
+	};
+
+	while(uwBeamY < s_uwFrameLines) {
+		std::uint16_t uwFirst = readChipWord(m_ulCopperPc);
+		std::uint16_t uwSecond = readChipWord(m_ulCopperPc + 2);
+		m_ulCopperPc += 4;
+		m_sStats.ullCopperCycles += s_ubCopperInstructionCycles;
+		advanceBeam(s_ubCopperInstructionColorClocks);
+
+		if(isSkipNext) {
+			isSkipNext = false;
+			continue;
+		}
+
+		if(!(uwFirst & 1)) {
+			// MOVE
+			std::uint16_t uwReg = uwFirst & 0x1FE;
+			bool isDanger = m_pRegs[CUSTOM_REG_COPCON / 2] & s_uwCopConDanger;
+			if(uwReg < 0x40 || (uwReg < 0x80 && !isDanger)) {
+				// Copper stops on protected register access
+				break;
+			}
+			++m_sStats.ullCopperMoves;
+			writeReg(uwReg, uwSecond);
+		}
+		else if(!(uwSecond & 1)) {
+			// WAIT - blits are done instantly so blitter-finished flag is ignored
+			while(!isBeamPast(uwFirst, uwSecond)) {
+				if(uwBeamY >= s_uwFrameLines) {
+					return;
+				}
+				advanceBeam(2);
+			}
+		}
+		else {
+			// SKIP
+			isSkipNext = isBeamPast(uwFirst, uwSecond);
+		}
+	}
+}
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _ACE_TOOLS_COMMON_CUSTOM_MODEL_H_
+#define _ACE_TOOLS_COMMON_CUSTOM_MODEL_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Offsets of custom chip registers handled by tCustomModel, same as in
+ * NDK's hardware/custom.h. Pointer registers are split into high and low words.
+ */
+enum tCustomReg: std::uint16_t {
+	CUSTOM_REG_DMACONR = 0x002,
+	CUSTOM_REG_COPCON = 0x02E,
+	CUSTOM_REG_BLTCON0 = 0x040,
+	CUSTOM_REG_BLTCON1 = 0x042,
+	CUSTOM_REG_BLTAFWM = 0x044,
+	CUSTOM_REG_BLTALWM = 0x046,
+	CUSTOM_REG_BLTCPTH = 0x048,
+	CUSTOM_REG_BLTCPTL = 0x04A,
+	CUSTOM_REG_BLTBPTH = 0x04C,
+	CUSTOM_REG_BLTBPTL = 0x04E,
+	CUSTOM_REG_BLTAPTH = 0x050,
+	CUSTOM_REG_BLTAPTL = 0x052,
+	CUSTOM_REG_BLTDPTH = 0x054,
+	CUSTOM_REG_BLTDPTL = 0x056,
+	CUSTOM_REG_BLTSIZE = 0x058,
+	CUSTOM_REG_BLTCON0L = 0x05A,
+	CUSTOM_REG_BLTSIZV = 0x05C,
+	CUSTOM_REG_BLTSIZH = 0x05E,
+	CUSTOM_REG_BLTCMOD = 0x060,
+	CUSTOM_REG_BLTBMOD = 0x062,
+	CUSTOM_REG_BLTAMOD = 0x064,
+	CUSTOM_REG_BLTDMOD = 0x066,
+	CUSTOM_REG_BLTCDAT = 0x070,
+	CUSTOM_REG_BLTBDAT = 0x072,
+	CUSTOM_REG_BLTADAT = 0x074,
+	CUSTOM_REG_COP1LCH = 0x080,
+	CUSTOM_REG_COP1LCL = 0x082,
+	CUSTOM_REG_COP2LCH = 0x084,
+	CUSTOM_REG_COP2LCL = 0x086,
+	CUSTOM_REG_COPJMP1 = 0x088,
+	CUSTOM_REG_COPJMP2 = 0x08A,
+	CUSTOM_REG_DMACON = 0x096,
+	CUSTOM_REG_COUNT = 0x200, ///< Size of register space, in bytes.
+};
+
+struct tCustomModelStats {
+	std::uint64_t ullBlitCount = 0;
+	std::uint64_t ullBlitCycles = 0;
+	std::uint64_t ullCopperMoves = 0;
+	std::uint64_t ullCopperCycles = 0;
+};
+
+/**
+ * @brief Software model of the blitter and copper, writing to its own chip
+ * memory image. Allows running register sequences produced by ACE on host,
+ * checking their results bit-exactly and counting used DMA cycles.
+ *
+ * Blits are done instantly when BLTSIZE (or ECS' BLTSIZH) is written, so the
+ * blitter never appears busy. Pointer registers are advanced the same way as
+ * on real hardware, so continued blits (e.g. bob bg saving) work as expected.
+ *
+ * DMA cycles are counted as bus slots used by enabled channels, according
+ * to HRM's blitter cycle table, without contention with CPU, bitplane
+ * or other DMA. Copper cycles are only instruction fetches.
+ */
+class tCustomModel {
+public:
+	/**
+	 * @brief Creates the model with zero-filled chip memory.
+	 *
+	 * @param ulChipSize Size of chip memory, must be a power of two.
+	 * All chip addresses are wrapped to it.
+	 * @param isEcs If set, BLTSIZV/BLTSIZH registers and big blits are supported.
+	 */
+	tCustomModel(std::uint32_t ulChipSize = 512 * 1024, bool isEcs = false);
+
+	void writeReg(std::uint16_t uwReg, std::uint16_t uwValue);
+
+	/**
+	 * @brief Writes the pointer register pair, high word first.
+	 */
+	void writeRegLong(std::uint16_t uwReg, std::uint32_t ulValue);
+
+	/**
+	 * @brief Returns the last written register value, except for DMACONR
+	 * which returns DMACON state along with blitter zero flag.
+	 */
+	std::uint16_t readReg(std::uint16_t uwReg) const;
+
+	std::uint16_t readChipWord(std::uint32_t ulAddr) const;
+
+	void writeChipWord(std::uint32_t ulAddr, std::uint16_t uwValue);
+
+	/**
+	 * @brief Executes copper list from COP1LC for a single frame, like it's
+	 * done after vertical blank.
+	 *
+	 * Copper stops at the end of the frame, on unsatisfiable WAIT or on MOVE
+	 * to a protected register.
+	 */
+	void runCopperFrame(void);
+
+	void resetStats(void);
+
+	std::vector<std::uint8_t> m_vChipMem; ///< Big-endian, just as on Amiga.
+	tCustomModelStats m_sStats;
+	std::uint32_t m_ulLastBlitCycles = 0;
+
+private:
+	void blitStart(std::uint16_t uwWidth, std::uint16_t uwHeight);
+
+	void blitArea(std::uint16_t uwWidth, std::uint16_t uwHeight);
+
+	void blitLine(std::uint16_t uwHeight);
+
+	std::uint32_t getRegLong(std::uint16_t uwReg) const;
+
+	void setRegLong(std::uint16_t uwReg, std::uint32_t ulValue);
+
+	std::uint16_t m_pRegs[CUSTOM_REG_COUNT / 2];
+	std::uint32_t m_ulChipMask;
+	std::uint32_t m_ulCopperPc = 0;
+	std::uint16_t m_uwDmaCon = 0;
+	std::uint16_t m_uwBlitSizeV = 0;
+	bool m_isEcs;
+	bool m_isBlitZero = true;
+};
+
+#endif // _ACE_TOOLS_COMMON_CUSTOM_MODEL_H_
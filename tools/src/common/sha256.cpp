@@ -0,0 +1,100 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "sha256.h"
+#include <bit>
+#include <fmt/format.h>
+
+namespace nSha256 {
+
+static constexpr std::uint32_t s_pRoundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void processBlock(std::uint32_t *pState, const std::uint8_t *pBlock)
+{
+	std::uint32_t pW[64];
+	for(auto i = 0; i < 16; ++i) {
+		pW[i] = (
+			(std::uint32_t(pBlock[i * 4 + 0]) << 24) | (std::uint32_t(pBlock[i * 4 + 1]) << 16) |
+			(std::uint32_t(pBlock[i * 4 + 2]) << 8) | (std::uint32_t(pBlock[i * 4 + 3]) << 0)
+		);
+	}
+	for(auto i = 16; i < 64; ++i) {
+		auto s0 = std::rotr(pW[i - 15], 7) ^ std::rotr(pW[i - 15], 18) ^ (pW[i - 15] >> 3);
+		auto s1 = std::rotr(pW[i - 2], 17) ^ std::rotr(pW[i - 2], 19) ^ (pW[i - 2] >> 10);
+		pW[i] = pW[i - 16] + s0 + pW[i - 7] + s1;
+	}
+
+	std::uint32_t a = pState[0], b = pState[1], c = pState[2], d = pState[3];
+	std::uint32_t e = pState[4], f = pState[5], g = pState[6], h = pState[7];
+	for(auto i = 0; i < 64; ++i) {
+		auto S1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+		auto ch = (e & f) ^ (~e & g);
+		auto Temp1 = h + S1 + ch + s_pRoundConstants[i] + pW[i];
+		auto S0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+		auto maj = (a & b) ^ (a & c) ^ (b & c);
+		auto Temp2 = S0 + maj;
+		h = g; g = f; f = e; e = d + Temp1;
+		d = c; c = b; b = a; a = Temp1 + Temp2;
+	}
+	pState[0] += a; pState[1] += b; pState[2] += c; pState[3] += d;
+	pState[4] += e; pState[5] += f; pState[6] += g; pState[7] += h;
+}
+
+tDigest calculate(const std::uint8_t *pData, std::size_t Size)
+{
+	std::uint32_t pState[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	std::size_t Offset = 0;
+	for(; Offset + 64 <= Size; Offset += 64) {
+		processBlock(pState, &pData[Offset]);
+	}
+
+	// Pad the remainder with 0x80, zeros and message length in bits
+	std::uint8_t pTail[128] = {0};
+	std::size_t TailSize = Size - Offset;
+	for(std::size_t i = 0; i < TailSize; ++i) {
+		pTail[i] = pData[Offset + i];
+	}
+	pTail[TailSize] = 0x80;
+	std::size_t PaddedSize = (TailSize + 1 + 8 <= 64) ? 64 : 128;
+	std::uint64_t ullBitCount = std::uint64_t(Size) * 8;
+	for(auto i = 0; i < 8; ++i) {
+		pTail[PaddedSize - 1 - i] = std::uint8_t(ullBitCount >> (i * 8));
+	}
+	for(std::size_t BlockOffset = 0; BlockOffset < PaddedSize; BlockOffset += 64) {
+		processBlock(pState, &pTail[BlockOffset]);
+	}
+
+	tDigest Digest;
+	for(auto i = 0; i < 8; ++i) {
+		Digest[i * 4 + 0] = std::uint8_t(pState[i] >> 24);
+		Digest[i * 4 + 1] = std::uint8_t(pState[i] >> 16);
+		Digest[i * 4 + 2] = std::uint8_t(pState[i] >> 8);
+		Digest[i * 4 + 3] = std::uint8_t(pState[i] >> 0);
+	}
+	return Digest;
+}
+
+std::string toString(const tDigest &Digest)
+{
+	std::string Out;
+	for(auto ubByte: Digest) {
+		Out += fmt::format("{:02x}", ubByte);
+	}
+	return Out;
+}
+
+} // namespace nSha256
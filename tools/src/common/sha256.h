@@ -0,0 +1,23 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _ACE_TOOLS_COMMON_SHA256_H_
+#define _ACE_TOOLS_COMMON_SHA256_H_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace nSha256 {
+
+using tDigest = std::array<std::uint8_t, 32>;
+
+tDigest calculate(const std::uint8_t *pData, std::size_t Size);
+
+std::string toString(const tDigest &Digest);
+
+} // namespace nSha256
+
+#endif // _ACE_TOOLS_COMMON_SHA256_H_
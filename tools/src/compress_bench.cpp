@@ -0,0 +1,174 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+#include "common/logging.h"
+#include "common/fs.h"
+#include "common/compress.hpp"
+
+static void printUsage(const std::string &szAppName) {
+	using fmt::print;
+	print("Usage:\n\t{} inDir [extraOpts]\n\n", szAppName);
+	print("Required arguments:\n");
+	print("\tinDir   Path to input directory, searched recursively.\n");
+	print("Extra options:\n");
+	print("\t-c2     Use optimal parsing compression.\n");
+	print("\t-cf     Use fast decoding codec.\n");
+	print("\t-e ext  Benchmark files with given extension. May be repeated. Default: bm, sfx, mod.\n");
+}
+
+static double getMbPerSec(std::uint64_t ullBytes, std::chrono::duration<double> Time) {
+	if(Time.count() <= 0) {
+		return 0;
+	}
+	return (double(ullBytes) / (1024 * 1024)) / Time.count();
+}
+
+int main(int lArgCount, const char *pArgs[])
+{
+	using namespace std::string_view_literals;
+	using tClock = std::chrono::steady_clock;
+
+	const std::uint8_t ubMandatoryArgCnt = 1;
+	if(lArgCount - 1 < ubMandatoryArgCnt) {
+		nLog::error("Too few arguments, expected {}", ubMandatoryArgCnt);
+		printUsage(pArgs[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::string InPath(pArgs[1]);
+	std::vector<std::string> vExtensions;
+	bool isOptimal = false;
+	bool isFast = false;
+	for(auto ArgIndex = 2; ArgIndex < lArgCount; ++ArgIndex) {
+		std::string_view Arg = pArgs[ArgIndex];
+		if(Arg == "-c2"sv) {
+			isOptimal = true;
+		}
+		else if(Arg == "-cf"sv) {
+			isFast = true;
+		}
+		else if(Arg == "-e"sv && ArgIndex + 1 < lArgCount) {
+			vExtensions.push_back(pArgs[++ArgIndex]);
+		}
+		else {
+			nLog::error("Unknown arg or missing value: '{}'", pArgs[ArgIndex]);
+			printUsage(pArgs[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if(vExtensions.empty()) {
+		vExtensions = {"bm", "sfx", "mod"};
+	}
+
+	if(!nFs::isDir(InPath)) {
+		nLog::error("Path {} isn't a folder", InPath);
+		return EXIT_FAILURE;
+	}
+
+	std::uint32_t ulFileCount = 0;
+	std::uint64_t ullTotalIn = 0, ullTotalOut = 0;
+	std::chrono::duration<double> TimePack{0}, TimeUnpack{0};
+	std::vector<std::uint8_t> vFileContents;
+	std::vector<std::uint8_t> vPackBuffer;
+	std::vector<std::uint8_t> vDecompressed;
+	for (std::filesystem::recursive_directory_iterator i(InPath), end; i != end; ++i) {
+		if(is_directory(i->path())) {
+			continue;
+		}
+		auto Path = i->path().generic_string();
+		if(std::find(vExtensions.begin(), vExtensions.end(), nFs::getExt(Path)) == vExtensions.end()) {
+			continue;
+		}
+
+		auto ulSize = std::uint32_t(std::filesystem::file_size(Path));
+		if(!ulSize) {
+			continue;
+		}
+		std::ifstream FileIn;
+		FileIn.open(Path, std::ios::binary);
+		if(FileIn.fail()) {
+			nLog::error("Can't open the file {}", Path);
+			return EXIT_FAILURE;
+		}
+		vFileContents.resize(ulSize);
+		FileIn.read(reinterpret_cast<char*>(vFileContents.data()), ulSize);
+
+		auto ulPackBufferSize = std::max(ulSize * 2, compressPackFastGetMaxSize(ulSize));
+		if(vPackBuffer.size() < ulPackBufferSize) {
+			vPackBuffer.resize(ulPackBufferSize);
+		}
+		auto PackStart = tClock::now();
+		std::uint32_t ulCompressedSize;
+		if(isFast) {
+			ulCompressedSize = compressPackFast(vFileContents.data(), ulSize, vPackBuffer.data());
+		}
+		else if(isOptimal) {
+			ulCompressedSize = compressPackOptimal(vFileContents.data(), ulSize, vPackBuffer.data());
+		}
+		else {
+			ulCompressedSize = compressPack(vFileContents.data(), ulSize, vPackBuffer.data());
+		}
+		auto PackEnd = tClock::now();
+
+		vDecompressed.resize(ulSize);
+		bool isUnpacked = true;
+		if(isFast) {
+			isUnpacked = compressUnpackFast(
+				vPackBuffer.data(), ulCompressedSize, vDecompressed.data(), ulSize
+			);
+		}
+		else {
+			tCompressUnpacker UnpackState;
+			compressUnpackerInit(&UnpackState, vPackBuffer.data(), ulCompressedSize, ulSize);
+			while(true) {
+				std::uint8_t ubRead;
+				tCompressUnpackResult eResult = compressUnpackerProcess(&UnpackState, &ubRead);
+				if(eResult == COMPRESS_UNPACK_RESULT_DONE) {
+					break;
+				}
+				if(eResult == COMPRESS_UNPACK_RESULT_BUSY_WROTE_BYTE) {
+					vDecompressed[UnpackState.ulWriteOffset - 1] = ubRead;
+				}
+			}
+		}
+		auto UnpackEnd = tClock::now();
+
+		if(!isUnpacked || vDecompressed != vFileContents) {
+			nLog::error("Round-trip mismatch for {}", Path);
+			return EXIT_FAILURE;
+		}
+
+		std::chrono::duration<double> FileTimePack = PackEnd - PackStart;
+		fmt::print(
+			"{}: {} -> {} ({:.2f}%), {:.2f} MB/s\n", Path, ulSize, ulCompressedSize,
+			float(ulCompressedSize) / ulSize * 100, getMbPerSec(ulSize, FileTimePack)
+		);
+		++ulFileCount;
+		ullTotalIn += ulSize;
+		ullTotalOut += ulCompressedSize;
+		TimePack += FileTimePack;
+		TimeUnpack += UnpackEnd - PackEnd;
+	}
+
+	if(!ulFileCount) {
+		nLog::error("No matching files found in {}", InPath);
+		return EXIT_FAILURE;
+	}
+
+	fmt::print(
+		"Files: {}, total: {} -> {} ({:.2f}%)\n", ulFileCount, ullTotalIn, ullTotalOut,
+		float(ullTotalOut) / ullTotalIn * 100
+	);
+	fmt::print(
+		"Compress: {:.3f}s, {:.2f} MB/s\nDecompress: {:.3f}s, {:.2f} MB/s\n",
+		TimePack.count(), getMbPerSec(ullTotalIn, TimePack),
+		TimeUnpack.count(), getMbPerSec(ullTotalIn, TimeUnpack)
+	);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,435 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Runs ACE's blitter code on tCustomModel, with src/ace/managers/blit.c built
+// for host against register shim from host/, and compares results with plain
+// CPU implementations.
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <ace/managers/blit.h>
+#include "common/logging.h"
+#include "common/custom_model.h"
+#include "host/ace_host.h"
+
+static constexpr std::uint16_t s_uwCopConDanger = 0x0002;
+static constexpr std::uint16_t s_uwRegColor0 = 0x180;
+
+class tHarness {
+public:
+	tHarness(void): m_Model(1024 * 1024), m_Random(0xACE) {
+		aceHostSetModel(&m_Model);
+	}
+
+	/**
+	 * @brief Creates bitmap with bitplanes placed in model's chip memory.
+	 */
+	tBitMap createBitMap(
+		std::uint16_t uwWidth, std::uint16_t uwHeight, std::uint8_t ubDepth,
+		bool isInterleaved
+	) {
+		tBitMap BitMap = {};
+		std::uint16_t uwByteWidth = ((uwWidth + 15) / 16) * 2;
+		BitMap.Rows = uwHeight;
+		BitMap.Depth = ubDepth;
+		if(isInterleaved) {
+			BitMap.Flags = BMF_INTERLEAVED;
+			BitMap.BytesPerRow = uwByteWidth * ubDepth;
+			for(std::uint8_t i = 0; i < ubDepth; ++i) {
+				BitMap.Planes[i] = getChip(m_ulChipPos + i * uwByteWidth);
+			}
+		}
+		else {
+			BitMap.BytesPerRow = uwByteWidth;
+			for(std::uint8_t i = 0; i < ubDepth; ++i) {
+				BitMap.Planes[i] = getChip(m_ulChipPos + i * uwByteWidth * uwHeight);
+			}
+		}
+		// Extra plane is used as a scratch area by one-dot lines
+		BitMap.Planes[ubDepth] = getChip(m_ulChipPos + uwByteWidth * uwHeight * ubDepth);
+		m_ulChipPos += uwByteWidth * uwHeight * (ubDepth + 1);
+		return BitMap;
+	}
+
+	UBYTE *allocChip(std::uint32_t ulSize) {
+		std::uint32_t ulAddr = m_ulChipPos;
+		m_ulChipPos += (ulSize + 1) & ~1u;
+		return getChip(ulAddr);
+	}
+
+	void fillRandom(UBYTE *pData, std::uint32_t ulSize) {
+		for(std::uint32_t i = 0; i < ulSize; ++i) {
+			pData[i] = UBYTE(m_Random());
+		}
+	}
+
+	void fillRandom(const tBitMap &BitMap) {
+		for(std::uint8_t ubPlane = 0; ubPlane < BitMap.Depth; ++ubPlane) {
+			for(std::uint16_t uwY = 0; uwY < BitMap.Rows; ++uwY) {
+				fillRandom(
+					&BitMap.Planes[ubPlane][uwY * BitMap.BytesPerRow],
+					bitmapGetByteWidth(&BitMap)
+				);
+			}
+		}
+	}
+
+	static bool getPixel(
+		const tBitMap &BitMap, std::uint8_t ubPlane, std::uint16_t uwX,
+		std::uint16_t uwY
+	) {
+		auto ubByte = BitMap.Planes[ubPlane][uwY * BitMap.BytesPerRow + uwX / 8];
+		return (ubByte >> (7 - (uwX & 7))) & 1;
+	}
+
+	/**
+	 * @brief Returns all pixels of all bitplanes, for comparing whole bitmaps.
+	 */
+	static std::vector<bool> getPixels(const tBitMap &BitMap) {
+		std::vector<bool> vPixels;
+		std::uint16_t uwWidth = bitmapGetByteWidth(&BitMap) * 8;
+		for(std::uint8_t ubPlane = 0; ubPlane < BitMap.Depth; ++ubPlane) {
+			for(std::uint16_t uwY = 0; uwY < BitMap.Rows; ++uwY) {
+				for(std::uint16_t uwX = 0; uwX < uwWidth; ++uwX) {
+					vPixels.push_back(getPixel(BitMap, ubPlane, uwX, uwY));
+				}
+			}
+		}
+		return vPixels;
+	}
+
+	static std::size_t getPixelIndex(
+		const tBitMap &BitMap, std::uint8_t ubPlane, std::uint16_t uwX,
+		std::uint16_t uwY
+	) {
+		std::uint16_t uwWidth = bitmapGetByteWidth(&BitMap) * 8;
+		return (std::size_t(ubPlane) * BitMap.Rows + uwY) * uwWidth + uwX;
+	}
+
+	bool testCopy(
+		const tBitMap &Src, std::int16_t wSrcX, std::int16_t wSrcY,
+		tBitMap &Dst, std::int16_t wDstX, std::int16_t wDstY,
+		std::int16_t wWidth, std::int16_t wHeight, const UBYTE *pMask
+	) {
+		fillRandom(Dst);
+		auto vExpected = getPixels(Dst);
+		for(std::uint8_t ubPlane = 0; ubPlane < std::min(Src.Depth, Dst.Depth); ++ubPlane) {
+			for(std::int16_t wY = 0; wY < wHeight; ++wY) {
+				for(std::int16_t wX = 0; wX < wWidth; ++wX) {
+					if(pMask && !getMaskPixel(Src, pMask, ubPlane, wSrcX + wX, wSrcY + wY)) {
+						continue;
+					}
+					vExpected[getPixelIndex(Dst, ubPlane, wDstX + wX, wDstY + wY)] =
+						getPixel(Src, ubPlane, wSrcX + wX, wSrcY + wY);
+				}
+			}
+		}
+
+		if(pMask) {
+			blitCopyMask(&Src, wSrcX, wSrcY, &Dst, wDstX, wDstY, wWidth, wHeight, pMask);
+		}
+		else {
+			blitCopy(&Src, wSrcX, wSrcY, &Dst, wDstX, wDstY, wWidth, wHeight, MINTERM_COOKIE);
+		}
+		return check(
+			Dst, vExpected, fmt::format(
+				"{} {},{} -> {},{} {}x{}{}", pMask ? "mask-copy" : "copy",
+				wSrcX, wSrcY, wDstX, wDstY, wWidth, wHeight,
+				bitmapIsInterleaved(&Src) ? " interleaved" : ""
+			)
+		);
+	}
+
+	bool testRect(
+		tBitMap &Dst, std::int16_t wDstX, std::int16_t wDstY,
+		std::int16_t wWidth, std::int16_t wHeight, std::uint8_t ubColor
+	) {
+		fillRandom(Dst);
+		auto vExpected = getPixels(Dst);
+		for(std::uint8_t ubPlane = 0; ubPlane < Dst.Depth; ++ubPlane) {
+			for(std::int16_t wY = wDstY; wY < wDstY + wHeight; ++wY) {
+				for(std::int16_t wX = wDstX; wX < wDstX + wWidth; ++wX) {
+					vExpected[getPixelIndex(Dst, ubPlane, wX, wY)] = (ubColor >> ubPlane) & 1;
+				}
+			}
+		}
+		blitRect(&Dst, wDstX, wDstY, wWidth, wHeight, ubColor);
+		return check(Dst, vExpected, fmt::format(
+			"rect {},{} {}x{} color {}", wDstX, wDstY, wWidth, wHeight, ubColor
+		));
+	}
+
+	bool testLine(
+		tBitMap &Dst, std::int16_t wX1, std::int16_t wY1,
+		std::int16_t wX2, std::int16_t wY2, std::uint8_t ubColor
+	) {
+		fillRandom(Dst);
+		auto vExpected = getPixels(Dst);
+
+		// Bresenham with the same decisions as blitter: step along the minor
+		// axis whenever the error term isn't negative.
+		std::int16_t wDx = std::abs(wX2 - wX1), wDy = std::abs(wY2 - wY1);
+		std::int16_t wStepX = (wX2 < wX1) ? -1 : 1, wStepY = (wY2 < wY1) ? -1 : 1;
+		if(wY1 > wY2) {
+			// Blitter always draws downwards
+			std::swap(wX1, wX2);
+			std::swap(wY1, wY2);
+			wStepX = -wStepX;
+			wStepY = -wStepY;
+		}
+		bool isXMajor = wDx >= wDy;
+		std::int16_t wMajor = isXMajor ? wDx : wDy, wMinor = isXMajor ? wDy : wDx;
+		std::int16_t wErr = 2 * wMinor - wMajor;
+		std::int16_t wX = wX1, wY = wY1;
+		for(std::int16_t i = 0; i <= wMajor; ++i) {
+			for(std::uint8_t ubPlane = 0; ubPlane < Dst.Depth; ++ubPlane) {
+				vExpected[getPixelIndex(Dst, ubPlane, wX, wY)] = (ubColor >> ubPlane) & 1;
+			}
+			if(wErr >= 0) {
+				if(isXMajor) {
+					wY += wStepY;
+				}
+				else {
+					wX += wStepX;
+				}
+				wErr += 2 * wMinor - 2 * wMajor;
+			}
+			else {
+				wErr += 2 * wMinor;
+			}
+			if(isXMajor) {
+				wX += wStepX;
+			}
+			else {
+				wY += wStepY;
+			}
+		}
+
+		blitLine(&Dst, wX1, wY1, wX2, wY2, ubColor, 0xFFFF, 0);
+		return check(Dst, vExpected, fmt::format(
+			"line {},{} -> {},{} color {}", wX1, wY1, wX2, wY2, ubColor
+		));
+	}
+
+	/**
+	 * @brief Runs a copper list which changes color mid-frame, then does
+	 * a blitter rect fill by itself after being allowed to touch blitter regs.
+	 */
+	bool testCopperFrame(const tBitMap &Dst) {
+		fillRandom(Dst);
+		auto vExpected = getPixels(Dst);
+		for(std::uint16_t uwY = 0; uwY < 8; ++uwY) {
+			for(std::uint16_t uwX = 16; uwX < 48; ++uwX) {
+				vExpected[getPixelIndex(Dst, 0, uwX, uwY)] = false;
+			}
+		}
+
+		std::int16_t wModulo = Dst.BytesPerRow - 4;
+		std::uint32_t ulDst = getChipAddr(Dst.Planes[0]) + 2;
+		std::vector<std::pair<std::uint16_t, std::uint16_t>> vCopperList = {
+			{s_uwRegColor0, 0x0F00},
+			{0x6401, 0xFFFE}, // WAIT for line 100
+			{s_uwRegColor0, 0x00F0},
+			{CUSTOM_REG_BLTCON0, USEC|USED | MINTERM_NA_AND_C},
+			{CUSTOM_REG_BLTCON1, 0},
+			{CUSTOM_REG_BLTAFWM, 0xFFFF},
+			{CUSTOM_REG_BLTALWM, 0xFFFF},
+			{CUSTOM_REG_BLTADAT, 0xFFFF},
+			{CUSTOM_REG_BLTCMOD, std::uint16_t(wModulo)},
+			{CUSTOM_REG_BLTDMOD, std::uint16_t(wModulo)},
+			{CUSTOM_REG_BLTCPTH, std::uint16_t(ulDst >> 16)},
+			{CUSTOM_REG_BLTCPTL, std::uint16_t(ulDst)},
+			{CUSTOM_REG_BLTDPTH, std::uint16_t(ulDst >> 16)},
+			{CUSTOM_REG_BLTDPTL, std::uint16_t(ulDst)},
+			{CUSTOM_REG_BLTSIZE, (8 << HSIZEBITS) | 2},
+			{0xFFFF, 0xFFFE}, // End of list
+		};
+		std::uint32_t ulList = getChipAddr(allocChip(vCopperList.size() * 4));
+		for(std::size_t i = 0; i < vCopperList.size(); ++i) {
+			m_Model.writeChipWord(ulList + i * 4, vCopperList[i].first);
+			m_Model.writeChipWord(ulList + i * 4 + 2, vCopperList[i].second);
+		}
+
+		m_Model.resetStats();
+		m_Model.writeReg(CUSTOM_REG_COPCON, s_uwCopConDanger);
+		m_Model.writeRegLong(CUSTOM_REG_COP1LCH, ulList);
+		m_Model.runCopperFrame();
+
+		fmt::print(
+			"copper: {} moves, {} copper cycles, {} blit DMA cycles\n",
+			m_Model.m_sStats.ullCopperMoves, m_Model.m_sStats.ullCopperCycles,
+			m_Model.m_sStats.ullBlitCycles
+		);
+		bool isOk = check(Dst, vExpected, "copper frame blit");
+		if(m_Model.readReg(s_uwRegColor0) != 0x00F0) {
+			nLog::error("copper frame: COLOR00 is {:04X}", m_Model.readReg(s_uwRegColor0));
+			isOk = false;
+		}
+		// All but the wait and end instructions are moves
+		auto ullExpectedMoves = vCopperList.size() - 2;
+		if(m_Model.m_sStats.ullCopperMoves != ullExpectedMoves || m_Model.m_sStats.ullBlitCount != 1) {
+			nLog::error(
+				"copper frame: {} moves, {} blits, expected {} and 1",
+				m_Model.m_sStats.ullCopperMoves, m_Model.m_sStats.ullBlitCount,
+				ullExpectedMoves
+			);
+			isOk = false;
+		}
+
+		// Without COPCON's danger bit, copper stops at first blitter register
+		m_Model.resetStats();
+		m_Model.writeReg(CUSTOM_REG_COPCON, 0);
+		m_Model.runCopperFrame();
+		if(m_Model.m_sStats.ullCopperMoves != 2 || m_Model.m_sStats.ullBlitCount != 0) {
+			nLog::error(
+				"copper frame: protected registers were written ({} moves, {} blits)",
+				m_Model.m_sStats.ullCopperMoves, m_Model.m_sStats.ullBlitCount
+			);
+			isOk = false;
+		}
+		return isOk;
+	}
+
+	tCustomModel m_Model;
+
+private:
+	UBYTE *getChip(std::uint32_t ulAddr) {
+		return &m_Model.m_vChipMem[ulAddr];
+	}
+
+	std::uint32_t getChipAddr(const UBYTE *pData) const {
+		return std::uint32_t(pData - m_Model.m_vChipMem.data());
+	}
+
+	static bool getMaskPixel(
+		const tBitMap &Src, const UBYTE *pMask, std::uint8_t ubPlane,
+		std::uint16_t uwX, std::uint16_t uwY
+	) {
+		// Mask has the same layout as a single source bitplane, or as the whole
+		// source bitmap if it's interleaved
+		std::uint32_t ulPlaneOffs = bitmapIsInterleaved(&Src) ? Src.Planes[ubPlane] - Src.Planes[0] : 0;
+		auto ubByte = pMask[ulPlaneOffs + uwY * Src.BytesPerRow + uwX / 8];
+		return (ubByte >> (7 - (uwX & 7))) & 1;
+	}
+
+	bool check(
+		const tBitMap &BitMap, const std::vector<bool> &vExpected,
+		const std::string &Name
+	) {
+		auto vActual = getPixels(BitMap);
+		for(std::size_t i = 0; i < vActual.size(); ++i) {
+			if(vActual[i] != vExpected[i]) {
+				std::uint16_t uwWidth = bitmapGetByteWidth(&BitMap) * 8;
+				nLog::error(
+					"{}: pixel mismatch at plane {}, x {}, y {}", Name,
+					i / (std::size_t(uwWidth) * BitMap.Rows),
+					i % uwWidth, (i / uwWidth) % BitMap.Rows
+				);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::uint32_t m_ulChipPos = 0;
+	std::mt19937 m_Random;
+};
+
+int main(void)
+{
+	tHarness Harness;
+	std::uint32_t ulFailCount = 0;
+	std::uint32_t ulTestCount = 0;
+	auto count = [&](bool isOk) {
+		++ulTestCount;
+		if(!isOk) {
+			++ulFailCount;
+		}
+	};
+
+	auto Src = Harness.createBitMap(128, 48, 3, false);
+	auto Dst = Harness.createBitMap(160, 48, 3, false);
+	auto SrcInterleaved = Harness.createBitMap(128, 48, 3, true);
+	auto DstInterleaved = Harness.createBitMap(160, 48, 3, true);
+	UBYTE *pMask = Harness.allocChip(Src.BytesPerRow * Src.Rows);
+	UBYTE *pMaskInterleaved = Harness.allocChip(SrcInterleaved.BytesPerRow * SrcInterleaved.Rows);
+	Harness.fillRandom(Src);
+	Harness.fillRandom(SrcInterleaved);
+	Harness.fillRandom(pMask, Src.BytesPerRow * Src.Rows);
+	Harness.fillRandom(pMaskInterleaved, SrcInterleaved.BytesPerRow * SrcInterleaved.Rows);
+
+	// Copies: aligned, shifted right within same word count, shifted left,
+	// spanning one extra destination word and short source split into two blits
+	const std::int16_t pCopies[][6] = {
+		{0, 0, 16, 4, 32, 16},
+		{3, 2, 7, 5, 40, 20},
+		{9, 1, 2, 3, 50, 12},
+		{5, 0, 12, 8, 15, 10},
+		{17, 4, 33, 6, 64, 30},
+		{2, 3, 31, 5, 20, 9},
+	};
+	Harness.m_Model.resetStats();
+	for(const auto &pCopy: pCopies) {
+		count(Harness.testCopy(Src, pCopy[0], pCopy[1], Dst, pCopy[2], pCopy[3], pCopy[4], pCopy[5], nullptr));
+		count(Harness.testCopy(
+			SrcInterleaved, pCopy[0], pCopy[1], DstInterleaved, pCopy[2], pCopy[3],
+			pCopy[4], pCopy[5], nullptr
+		));
+		count(Harness.testCopy(Src, pCopy[0], pCopy[1], Dst, pCopy[2], pCopy[3], pCopy[4], pCopy[5], pMask));
+		count(Harness.testCopy(
+			SrcInterleaved, pCopy[0], pCopy[1], DstInterleaved, pCopy[2], pCopy[3],
+			pCopy[4], pCopy[5], pMaskInterleaved
+		));
+	}
+	// All source and destination phases with widths up to 4 words, which
+	// catches wrong masks on short sources spanning an extra destination word.
+	// Small destination keeps whole-bitmap comparisons quick.
+	auto DstSweep = Harness.createBitMap(112, 8, 3, false);
+	for(std::int16_t wSrcX = 0; wSrcX < 16; ++wSrcX) {
+		for(std::int16_t wDstX = 16; wDstX < 32; ++wDstX) {
+			for(std::int16_t wWidth = 1; wWidth <= 64; ++wWidth) {
+				count(Harness.testCopy(Src, wSrcX, 1, DstSweep, wDstX, 2, wWidth, 3, nullptr));
+				count(Harness.testCopy(Src, wSrcX, 1, DstSweep, wDstX, 2, wWidth, 3, pMask));
+			}
+		}
+	}
+	fmt::print(
+		"copy: {} blits, {} DMA cycles\n",
+		Harness.m_Model.m_sStats.ullBlitCount, Harness.m_Model.m_sStats.ullBlitCycles
+	);
+
+	Harness.m_Model.resetStats();
+	count(Harness.testRect(Dst, 0, 0, 16, 8, 5));
+	count(Harness.testRect(Dst, 3, 7, 1, 1, 7));
+	count(Harness.testRect(Dst, 13, 10, 70, 21, 2));
+	count(Harness.testRect(Dst, 31, 40, 34, 8, 0));
+	fmt::print(
+		"rect: {} blits, {} DMA cycles\n",
+		Harness.m_Model.m_sStats.ullBlitCount, Harness.m_Model.m_sStats.ullBlitCycles
+	);
+
+	// One line per octant, plus horizontal, vertical and diagonal ones
+	const std::int16_t pLines[][4] = {
+		{10, 10, 90, 30}, {10, 10, 30, 40}, {90, 10, 10, 30}, {70, 5, 50, 40},
+		{90, 30, 10, 10}, {30, 40, 10, 10}, {10, 30, 90, 10}, {50, 40, 70, 5},
+		{5, 20, 150, 20}, {77, 2, 77, 45}, {20, 5, 60, 45},
+	};
+	Harness.m_Model.resetStats();
+	for(const auto &pLine: pLines) {
+		count(Harness.testLine(Dst, pLine[0], pLine[1], pLine[2], pLine[3], 5));
+	}
+	fmt::print(
+		"line: {} blits, {} DMA cycles\n",
+		Harness.m_Model.m_sStats.ullBlitCount, Harness.m_Model.m_sStats.ullBlitCycles
+	);
+
+	count(Harness.testCopperFrame(Dst));
+
+	fmt::print("{}/{} tests passed\n", ulTestCount - ulFailCount, ulTestCount);
+	return ulFailCount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Just enough of ACE runtime to run engine's blitter code on host, with its
+// register accesses done on tCustomModel. Built with the NDK stand-ins from
+// host/include.
+
+#include "ace_host.h"
+#include <cstdint>
+#include <hardware/dmabits.h>
+#include <ace/managers/system.h>
+#include <ace/utils/bitmap.h>
+
+static tCustomModel *s_pModel;
+static tCustom s_Custom;
+
+tCustom volatile * const g_pCustom = &s_Custom;
+
+void aceHostSetModel(tCustomModel *pModel) {
+	s_pModel = pModel;
+}
+
+void customHostWrite(UWORD uwReg, UWORD uwValue) {
+	s_pModel->writeReg(uwReg, uwValue);
+}
+
+void customHostWritePtr(UWORD uwReg, const volatile void *pValue) {
+	auto ulValue = std::uintptr_t(pValue);
+	auto ulChipStart = std::uintptr_t(s_pModel->m_vChipMem.data());
+	if(ulValue - ulChipStart < s_pModel->m_vChipMem.size()) {
+		ulValue -= ulChipStart;
+	}
+	// Anything else, e.g. line's error term in BLTAPT, is passed as-is
+	s_pModel->writeRegLong(uwReg, std::uint32_t(ulValue));
+}
+
+UWORD customHostRead(UWORD uwReg) {
+	return s_pModel->readReg(uwReg);
+}
+
+void systemSetDmaBit(UBYTE ubDmaBit, UBYTE isEnabled) {
+	customHostWrite(
+		CUSTOM_REG_DMACON, (isEnabled ? DMAF_SETCLR : 0) | (1 << ubDmaBit)
+	);
+}
+
+UBYTE bitmapIsInterleaved(const tBitMap *pBitMap) {
+	return (pBitMap->Depth > 1) && (pBitMap->Flags & BMF_INTERLEAVED);
+}
+
+UWORD bitmapGetByteWidth(const tBitMap *pBitMap) {
+	if(bitmapIsInterleaved(pBitMap)) {
+		return UWORD(pBitMap->Planes[1] - pBitMap->Planes[0]);
+	}
+	return pBitMap->BytesPerRow;
+}
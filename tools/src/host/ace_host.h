@@ -0,0 +1,19 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _ACE_TOOLS_HOST_ACE_HOST_H_
+#define _ACE_TOOLS_HOST_ACE_HOST_H_
+
+#include "../common/custom_model.h"
+
+/**
+ * @brief Binds g_pCustom of ACE sources built for host to given model.
+ *
+ * Pointers written to its registers which point into model's chip memory
+ * are converted to chip addresses, so ACE structs placed there (e.g. bitplanes
+ * of tBitMap) can be used directly. Other values are written as-is.
+ */
+void aceHostSetModel(tCustomModel *pModel);
+
+#endif // _ACE_TOOLS_HOST_ACE_HOST_H_
@@ -0,0 +1,10 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef EXEC_INTERRUPTS_H
+#define EXEC_INTERRUPTS_H
+
+struct Interrupt;
+
+#endif // EXEC_INTERRUPTS_H
@@ -0,0 +1,14 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef EXEC_MEMORY_H
+#define EXEC_MEMORY_H
+
+#define MEMF_ANY 0
+#define MEMF_PUBLIC (1 << 0)
+#define MEMF_CHIP (1 << 1)
+#define MEMF_FAST (1 << 2)
+#define MEMF_CLEAR (1 << 16)
+
+#endif // EXEC_MEMORY_H
@@ -0,0 +1,18 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef EXEC_TYPES_H
+#define EXEC_TYPES_H
+
+#include <stdint.h>
+
+typedef uint8_t UBYTE;
+typedef uint16_t UWORD;
+typedef uint32_t ULONG;
+typedef int8_t BYTE;
+typedef int16_t WORD;
+typedef int32_t LONG;
+typedef void *APTR;
+
+#endif // EXEC_TYPES_H
@@ -0,0 +1,27 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef GRAPHICS_GFX_H
+#define GRAPHICS_GFX_H
+
+#include <exec/types.h>
+
+#define BMF_CLEAR (1 << 0)
+#define BMF_DISPLAYABLE (1 << 1)
+#define BMF_INTERLEAVED (1 << 2)
+#define BMF_STANDARD (1 << 3)
+#define BMF_MINPLANES (1 << 4)
+
+typedef UBYTE *PLANEPTR;
+
+struct BitMap {
+	UWORD BytesPerRow;
+	UWORD Rows;
+	UBYTE Flags;
+	UBYTE Depth;
+	UWORD pad;
+	PLANEPTR Planes[8];
+};
+
+#endif // GRAPHICS_GFX_H
@@ -0,0 +1,41 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HARDWARE_BLIT_H
+#define HARDWARE_BLIT_H
+
+#define HSIZEBITS 6
+#define VSIZEBITS (16 - HSIZEBITS)
+#define HSIZEMASK 0x3F
+#define VSIZEMASK 0x3FF
+
+#define ASHIFTSHIFT 12
+#define BSHIFTSHIFT 12
+
+#define SRCA 0x800
+#define SRCB 0x400
+#define SRCC 0x200
+#define DEST 0x100
+
+#define ABC 0x80
+#define ABNC 0x40
+#define ANBC 0x20
+#define ANBNC 0x10
+#define NABC 0x08
+#define NABNC 0x04
+#define NANBC 0x02
+#define NANBNC 0x01
+
+#define LINEMODE 0x01
+#define BLITREVERSE 0x02
+#define FILL_CARRYIN 0x04
+#define FILL_OR 0x08
+#define FILL_XOR 0x10
+#define ONEDOT 0x02
+#define AUL 0x04
+#define SUL 0x08
+#define SUD 0x10
+#define SIGNFLAG 0x40
+
+#endif // HARDWARE_BLIT_H
@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HARDWARE_CUSTOM_H
+#define HARDWARE_CUSTOM_H
+
+#ifndef __cplusplus
+#error "Host build of ACE sources must be done as C++"
+#endif
+
+#include <exec/types.h>
+
+// Register accesses are forwarded to tCustomModel bound with aceHostSetModel()
+// - see host/ace_host.cpp. Only registers used by the blitter code are here.
+// Engine headers include this file within extern "C".
+extern "C++" {
+
+void customHostWrite(UWORD uwReg, UWORD uwValue);
+
+void customHostWritePtr(UWORD uwReg, const volatile void *pValue);
+
+UWORD customHostRead(UWORD uwReg);
+
+template<UWORD t_uwReg>
+struct tCustomHostReg {
+	void operator=(UWORD uwValue) volatile {
+		customHostWrite(t_uwReg, uwValue);
+	}
+
+	operator UWORD() const volatile {
+		return customHostRead(t_uwReg);
+	}
+};
+
+template<UWORD t_uwReg>
+struct tCustomHostPtr {
+	void operator=(const volatile void *pValue) volatile {
+		customHostWritePtr(t_uwReg, pValue);
+	}
+};
+
+struct Custom {
+	tCustomHostReg<0x002> dmaconr;
+	tCustomHostReg<0x040> bltcon0;
+	tCustomHostReg<0x042> bltcon1;
+	tCustomHostReg<0x044> bltafwm;
+	tCustomHostReg<0x046> bltalwm;
+	tCustomHostPtr<0x048> bltcpt;
+	tCustomHostPtr<0x04C> bltbpt;
+	tCustomHostPtr<0x050> bltapt;
+	tCustomHostPtr<0x054> bltdpt;
+	tCustomHostReg<0x058> bltsize;
+	tCustomHostReg<0x05A> bltcon0l;
+	tCustomHostReg<0x05C> bltsizv;
+	tCustomHostReg<0x05E> bltsizh;
+	tCustomHostReg<0x060> bltcmod;
+	tCustomHostReg<0x062> bltbmod;
+	tCustomHostReg<0x064> bltamod;
+	tCustomHostReg<0x066> bltdmod;
+	tCustomHostReg<0x070> bltcdat;
+	tCustomHostReg<0x072> bltbdat;
+	tCustomHostReg<0x074> bltadat;
+	tCustomHostReg<0x096> dmacon;
+};
+
+} // extern "C++"
+
+#endif // HARDWARE_CUSTOM_H
@@ -0,0 +1,14 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HARDWARE_DMABITS_H
+#define HARDWARE_DMABITS_H
+
+#define DMAB_BLITTER 6
+#define DMAF_SETCLR 0x8000
+#define DMAF_BLTDONE 0x4000
+#define DMAF_BLTNZERO 0x2000
+#define DMAF_BLITTER 0x0040
+
+#endif // HARDWARE_DMABITS_H
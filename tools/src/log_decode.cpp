@@ -0,0 +1,327 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <cctype>
+#include <cstdio>
+#include <bit>
+#include "common/logging.h"
+
+// Must be in sync with binary log format in ACE's log.c
+static constexpr std::uint32_t s_ulLogBinaryMagic = 0x41434542; // "ACEB"
+static constexpr std::uint8_t s_ubTagFormat = 1;
+static constexpr std::uint8_t s_ubTagMessage = 2;
+static constexpr std::uint8_t s_ubTagTrimNewline = 3;
+static constexpr std::uint8_t s_ubNoIndent = 0xFF;
+
+class tRecordReader {
+public:
+	tRecordReader(const std::uint8_t *pData, std::size_t Size):
+		m_pData(pData), m_Size(Size), m_Pos(0)
+	{ }
+
+	bool isEnd(void) const {
+		return m_Pos >= m_Size;
+	}
+
+	bool readByte(std::uint8_t &ubOut) {
+		if(m_Size - m_Pos < 1) {
+			return false;
+		}
+		ubOut = m_pData[m_Pos++];
+		return true;
+	}
+
+	bool readWord(std::uint16_t &uwOut) {
+		if(m_Size - m_Pos < 2) {
+			return false;
+		}
+		uwOut = (m_pData[m_Pos] << 8) | m_pData[m_Pos + 1];
+		m_Pos += 2;
+		return true;
+	}
+
+	bool readLong(std::uint32_t &ulOut) {
+		std::uint16_t uwHi, uwLo;
+		if(m_Size - m_Pos < 4 || !readWord(uwHi) || !readWord(uwLo)) {
+			return false;
+		}
+		ulOut = (std::uint32_t(uwHi) << 16) | uwLo;
+		return true;
+	}
+
+	bool readQuad(std::uint64_t &ullOut) {
+		std::uint32_t ulHi, ulLo;
+		if(m_Size - m_Pos < 8 || !readLong(ulHi) || !readLong(ulLo)) {
+			return false;
+		}
+		ullOut = (std::uint64_t(ulHi) << 32) | ulLo;
+		return true;
+	}
+
+	bool readString(std::string &Out) {
+		std::uint16_t uwLength;
+		if(!readWord(uwLength) || m_Size - m_Pos < uwLength) {
+			return false;
+		}
+		Out.assign(reinterpret_cast<const char*>(&m_pData[m_Pos]), uwLength);
+		m_Pos += uwLength;
+		return true;
+	}
+
+	tRecordReader sub(std::size_t Size) {
+		Size = std::min(Size, m_Size - m_Pos);
+		tRecordReader Sub(&m_pData[m_Pos], Size);
+		m_Pos += Size;
+		return Sub;
+	}
+
+private:
+	const std::uint8_t *m_pData;
+	std::size_t m_Size;
+	std::size_t m_Pos;
+};
+
+template<typename... tArgs>
+static std::string formatSpec(const std::string &Spec, tArgs... Args) {
+	int lSize = std::snprintf(nullptr, 0, Spec.c_str(), Args...);
+	if(lSize < 0) {
+		return "<bad spec>";
+	}
+	std::string Out(lSize, '\0');
+	std::snprintf(Out.data(), Out.size() + 1, Spec.c_str(), Args...);
+	return Out;
+}
+
+/**
+ * @brief Formats message the same way as ACE's printf, taking args
+ * from binary record.
+ */
+static std::string formatMessage(const std::string &Format, tRecordReader &Args) {
+	std::string Out;
+	for(std::size_t i = 0; i < Format.size(); ++i) {
+		if(Format[i] != '%') {
+			Out += Format[i];
+			continue;
+		}
+		if(++i >= Format.size()) {
+			break;
+		}
+		if(Format[i] == '%') {
+			Out += '%';
+			continue;
+		}
+
+		// Rebuild the spec without length modifiers, resolving '*' along the way
+		std::string Spec = "%";
+		while(i < Format.size() && std::strchr("0-+ #", Format[i])) {
+			Spec += Format[i++];
+		}
+		for(std::uint8_t ubField = 0; ubField < 2; ++ubField) {
+			if(ubField == 1) {
+				if(i >= Format.size() || Format[i] != '.') {
+					break;
+				}
+				Spec += Format[i++];
+			}
+			if(i < Format.size() && Format[i] == '*') {
+				std::uint32_t ulValue;
+				if(!Args.readLong(ulValue)) {
+					return Out + "<missing args>";
+				}
+				Spec += std::to_string(std::int32_t(ulValue));
+				++i;
+			}
+			while(i < Format.size() && std::isdigit(static_cast<unsigned char>(Format[i]))) {
+				Spec += Format[i++];
+			}
+		}
+		bool isLongLong = false, isShort = false, isChar = false;
+		while(i < Format.size() && std::strchr("lhjzt", Format[i])) {
+			if(Format[i] == 'l' && i + 1 < Format.size() && Format[i + 1] == 'l') {
+				isLongLong = true;
+				++i;
+			}
+			else if(Format[i] == 'h') {
+				isChar = isShort;
+				isShort = true;
+			}
+			++i;
+		}
+		if(i >= Format.size()) {
+			break;
+		}
+
+		char cSpecifier = Format[i];
+		if(cSpecifier == 's') {
+			std::string Arg;
+			if(!Args.readString(Arg)) {
+				return Out + "<missing args>";
+			}
+			Out += formatSpec(Spec + 's', Arg.c_str());
+		}
+		else if(std::strchr("fFeEgG", cSpecifier)) {
+			std::uint64_t ullValue;
+			if(!Args.readQuad(ullValue)) {
+				return Out + "<missing args>";
+			}
+			Out += formatSpec(Spec + cSpecifier, std::bit_cast<double>(ullValue));
+		}
+		else if(std::strchr("diuxXobcp", cSpecifier)) {
+			std::uint64_t ullValue;
+			if(isLongLong) {
+				if(!Args.readQuad(ullValue)) {
+					return Out + "<missing args>";
+				}
+			}
+			else {
+				std::uint32_t ulValue;
+				if(!Args.readLong(ulValue)) {
+					return Out + "<missing args>";
+				}
+				ullValue = isChar ? (ulValue & 0xFF) : (isShort ? (ulValue & 0xFFFF) : ulValue);
+			}
+
+			if(cSpecifier == 'p') {
+				// ACE prints pointers as zero-padded uppercase hex
+				Out += formatSpec("%08llX", static_cast<unsigned long long>(ullValue));
+			}
+			else if(cSpecifier == 'c') {
+				Out += formatSpec(Spec + 'c', int(ullValue & 0xFF));
+			}
+			else if(cSpecifier == 'b') {
+				std::string Bits;
+				do {
+					Bits.insert(Bits.begin(), char('0' + (ullValue & 1)));
+					ullValue >>= 1;
+				} while(ullValue);
+				Out += Bits;
+			}
+			else if(cSpecifier == 'd' || cSpecifier == 'i') {
+				long long llValue;
+				if(isLongLong) {
+					llValue = static_cast<long long>(ullValue);
+				}
+				else if(isChar) {
+					llValue = std::int8_t(ullValue);
+				}
+				else if(isShort) {
+					llValue = std::int16_t(ullValue);
+				}
+				else {
+					llValue = std::int32_t(ullValue);
+				}
+				Out += formatSpec(Spec + "ll" + cSpecifier, llValue);
+			}
+			else {
+				Out += formatSpec(Spec + "ll" + cSpecifier, static_cast<unsigned long long>(ullValue));
+			}
+		}
+		else {
+			Out += Spec + cSpecifier;
+		}
+	}
+	return Out;
+}
+
+static void printUsage(const std::string &szAppName) {
+	using fmt::print;
+	print("Usage:\n\t{} inLog [outTxt]\n\n", szAppName);
+	print("inLog   Path to binary log written by ACE built with ACE_DEBUG_LOG_BINARY.\n");
+	print("outTxt  Path to output text log. If omitted, log is printed to stdout.\n");
+}
+
+int main(int lArgCount, const char *pArgs[])
+{
+	const std::uint8_t ubMandatoryArgCnt = 1;
+	if(lArgCount - 1 < ubMandatoryArgCnt || lArgCount - 1 > ubMandatoryArgCnt + 1) {
+		nLog::error("Wrong number of arguments");
+		printUsage(pArgs[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::string InPath(pArgs[1]);
+	std::ifstream FileIn;
+	FileIn.open(InPath, std::ios::binary);
+	if(FileIn.fail()) {
+		nLog::error("Can't open the file {}", InPath);
+		return EXIT_FAILURE;
+	}
+	std::vector<std::uint8_t> vContents(std::filesystem::file_size(InPath));
+	FileIn.read(reinterpret_cast<char*>(vContents.data()), vContents.size());
+
+	tRecordReader Reader(vContents.data(), vContents.size());
+	std::uint32_t ulMagic;
+	if(!Reader.readLong(ulMagic) || ulMagic != s_ulLogBinaryMagic) {
+		nLog::error("{} isn't a binary ACE log", InPath);
+		return EXIT_FAILURE;
+	}
+
+	std::map<std::uint32_t, std::string> mFormats;
+	std::string Out;
+	while(!Reader.isEnd()) {
+		std::uint8_t ubTag;
+		Reader.readByte(ubTag);
+		if(ubTag == s_ubTagFormat) {
+			std::uint32_t ulPtr;
+			std::string Format;
+			if(!Reader.readLong(ulPtr) || !Reader.readString(Format)) {
+				fmt::println(FMT_STRING("WARN: truncated format record"));
+				break;
+			}
+			mFormats[ulPtr] = Format;
+		}
+		else if(ubTag == s_ubTagMessage) {
+			std::uint16_t uwSize;
+			std::uint32_t ulPtr;
+			std::uint8_t ubIndent;
+			if(!Reader.readWord(uwSize)) {
+				fmt::println(FMT_STRING("WARN: truncated message record"));
+				break;
+			}
+			auto Record = Reader.sub(uwSize);
+			if(!Record.readLong(ulPtr) || !Record.readByte(ubIndent)) {
+				fmt::println(FMT_STRING("WARN: truncated message record"));
+				break;
+			}
+			if(ubIndent != s_ubNoIndent) {
+				Out.append(ubIndent, '\t');
+			}
+			auto Format = mFormats.find(ulPtr);
+			if(Format == mFormats.end()) {
+				Out += fmt::format(FMT_STRING("<unknown format {:08X}>\n"), ulPtr);
+				continue;
+			}
+			Out += formatMessage(Format->second, Record);
+		}
+		else if(ubTag == s_ubTagTrimNewline) {
+			if(!Out.empty() && Out.back() == '\n') {
+				Out.pop_back();
+			}
+		}
+		else {
+			nLog::error("Unknown record tag {} in {}", ubTag, InPath);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(lArgCount - 1 > ubMandatoryArgCnt) {
+		std::string OutPath(pArgs[2]);
+		std::ofstream FileOut;
+		FileOut.open(OutPath, std::ios::binary);
+		if(FileOut.fail()) {
+			nLog::error("Can't open the file {}", OutPath);
+			return EXIT_FAILURE;
+		}
+		FileOut.write(Out.data(), Out.size());
+	}
+	else {
+		fmt::print("{}", Out);
+	}
+	return EXIT_SUCCESS;
+}
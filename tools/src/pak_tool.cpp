@@ -7,20 +7,167 @@
 #include <filesystem>
 #include <vector>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <limits>
 #include "common/logging.h"
 #include "common/fs.h"
 #include "common/endian.h"
 #include "common/compress.hpp"
 #include "common/stream.h"
+#include "common/sha256.h"
+#include "common/parse.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Keep in sync with PAK_FILE_CODEC_* defines in include/ace/utils/pak_file.h
+enum class tPakCodec: std::uint8_t {
+	NONE = 0,
+	LZSS = 1,
+	LZ_FAST = 2,
+};
 
 struct tPakEntry {
 	std::string ShortPath;
 	std::string Path;
 	std::uint32_t ulChecksum;
 	std::uint32_t ulUncompressedSize;
+	nSha256::tDigest ContentDigest;
+	tPakCodec eCodec = tPakCodec::NONE;
 	std::vector<std::uint8_t> vData;
 };
 
+// Keep in sync with PAK_FILE_* defines in include/ace/utils/pak_file.h
+static constexpr std::uint16_t s_uwPakHeaderExtended = 0xFFFF;
+static constexpr std::uint16_t s_uwPakFlagRestartPoints = 1;
+static constexpr std::uint16_t s_uwPakFlagSortedByHash = 2;
+static constexpr std::uint16_t s_uwPakFlagEntryCodecs = 4;
+static constexpr std::uint32_t s_ulPakTraceMagic = 0x50414B54; // "PAKT"
+
+// Bump when compressed entry data for same input and settings would change,
+// so that stale blobs in compression caches won't be used.
+static constexpr std::uint32_t s_ulCacheVersion = 3;
+
+// Rough per-byte costs in 68000 cycles of reading packed data from floppy
+// and of decoding it, used for automatic codec selection.
+static constexpr std::uint32_t s_ulCostReadPerByte = 280;
+static constexpr std::uint32_t s_ulCostDecodeLzssPerByte = 70;
+static constexpr std::uint32_t s_ulCostDecodeFastPerByte = 20;
+
+enum class tCompressLevel: std::uint8_t {
+	GREEDY = 1,
+	OPTIMAL = 2,
+};
+
+enum class tCodecSelection: std::uint8_t {
+	LZSS,
+	LZ_FAST,
+	AUTO,
+};
+
+struct tPakSettings {
+	bool isCompressed = false;
+	tCompressLevel eCompressLevel = tCompressLevel::GREEDY;
+	tCodecSelection eCodecSelection = tCodecSelection::LZSS;
+	std::uint32_t ulRestartInterval = 0;
+	bool isSortedByHash = false;
+	std::string CachePath;
+};
+
+static std::string getCacheBlobPath(const tPakSettings &Settings, const tPakEntry &Entry) {
+	// Key consists of everything that affects entry's data, not its path
+	auto Key = fmt::format(
+		"v{}:c{}:cs{}:ri{}:{}", s_ulCacheVersion, std::uint8_t(Settings.eCompressLevel),
+		std::uint8_t(Settings.eCodecSelection), Settings.ulRestartInterval,
+		nSha256::toString(Entry.ContentDigest)
+	);
+	auto KeyDigest = nSha256::calculate(
+		reinterpret_cast<const std::uint8_t*>(Key.data()), Key.size()
+	);
+	return fmt::format("{}/{}.bin", Settings.CachePath, nSha256::toString(KeyDigest));
+}
+
+// Blob consists of codec id byte, digest of entry data and the data itself.
+// The digest guards against truncated or otherwise damaged blobs, which would
+// be silently written into the pak otherwise.
+static bool cacheLoad(const std::string &BlobPath, tPakEntry &Entry) {
+	std::error_code Error;
+	auto Size = std::filesystem::file_size(BlobPath, Error);
+	nSha256::tDigest DataDigest;
+	if(Error || Size < sizeof(std::uint8_t) + DataDigest.size()) {
+		return false;
+	}
+	std::ifstream FileBlob;
+	FileBlob.open(BlobPath, std::ios::binary);
+	if(FileBlob.fail()) {
+		return false;
+	}
+	std::uint8_t ubCodec;
+	FileBlob.read(reinterpret_cast<char*>(&ubCodec), sizeof(ubCodec));
+	auto eCodec = tPakCodec(ubCodec);
+	if(eCodec != tPakCodec::NONE && eCodec != tPakCodec::LZSS && eCodec != tPakCodec::LZ_FAST) {
+		fmt::println(FMT_STRING("WARN: Unknown codec {} in cache blob {}"), ubCodec, BlobPath);
+		return false;
+	}
+	FileBlob.read(reinterpret_cast<char*>(DataDigest.data()), DataDigest.size());
+	std::vector<std::uint8_t> vData(Size - sizeof(ubCodec) - DataDigest.size());
+	FileBlob.read(reinterpret_cast<char*>(vData.data()), vData.size());
+	if(FileBlob.fail()) {
+		return false;
+	}
+
+	// Stored data must be the entry's contents as-is, packed one must be smaller
+	bool isSizeValid = (eCodec == tPakCodec::NONE) ?
+		(vData.size() == Entry.ulUncompressedSize) :
+		(vData.size() < Entry.ulUncompressedSize);
+	if(!isSizeValid || nSha256::calculate(vData.data(), vData.size()) != DataDigest) {
+		fmt::println(FMT_STRING("WARN: Damaged cache blob {}, repacking"), BlobPath);
+		return false;
+	}
+	Entry.eCodec = eCodec;
+	Entry.vData = std::move(vData);
+	return true;
+}
+
+static void cacheStore(const std::string &BlobPath, const tPakEntry &Entry) {
+	// Write to temp file unique to the process and thread, then rename it,
+	// so that concurrent pak_tool runs or threads storing same blob never leave
+	// a partially written one.
+	auto TempPath = fmt::format(
+		"{}.{}.{}.tmp", BlobPath, getpid(),
+		std::hash<std::thread::id>{}(std::this_thread::get_id())
+	);
+	std::ofstream FileBlob;
+	FileBlob.open(TempPath, std::ios::binary);
+	if(FileBlob.fail()) {
+		fmt::println(FMT_STRING("WARN: Can't write cache blob {}"), TempPath);
+		return;
+	}
+	auto ubCodec = std::uint8_t(Entry.eCodec);
+	auto DataDigest = nSha256::calculate(Entry.vData.data(), Entry.vData.size());
+	FileBlob.write(reinterpret_cast<const char*>(&ubCodec), sizeof(ubCodec));
+	FileBlob.write(reinterpret_cast<const char*>(DataDigest.data()), DataDigest.size());
+	FileBlob.write(reinterpret_cast<const char*>(Entry.vData.data()), Entry.vData.size());
+	FileBlob.close();
+
+	std::error_code Error;
+	if(FileBlob.fail()) {
+		fmt::println(FMT_STRING("WARN: Can't write cache blob {}"), TempPath);
+		std::filesystem::remove(TempPath, Error);
+		return;
+	}
+	std::filesystem::rename(TempPath, BlobPath, Error);
+	if(Error) {
+		std::filesystem::remove(TempPath, Error);
+	}
+}
+
 static std::uint32_t adler32Buffer(const std::uint8_t *pData, std::uint32_t ulDataSize) {
 	constexpr std::uint32_t modulo = 65521;
 	std::uint32_t a = 1, b = 0;
@@ -37,21 +184,414 @@ static std::uint32_t adler32Buffer(const std::uint8_t *pData, std::uint32_t ulDa
 	return (b << 16) | a;
 }
 
+static bool isUnpackedSame(
+	tPakCodec eCodec, const std::uint8_t *pPacked, std::uint32_t ulPackedSize,
+	const std::uint8_t *pOriginal, std::uint32_t ulOriginalSize,
+	std::vector<std::uint8_t> &vDecompressed
+) {
+	vDecompressed.resize(ulOriginalSize);
+	if(eCodec == tPakCodec::LZ_FAST) {
+		if(!compressUnpackFast(pPacked, ulPackedSize, vDecompressed.data(), ulOriginalSize)) {
+			nLog::error("malformed packed stream");
+			return false;
+		}
+	}
+	else {
+		tCompressUnpacker UnpackState;
+		compressUnpackerInit(&UnpackState, pPacked, ulPackedSize, ulOriginalSize);
+		while(true) {
+			std::uint8_t ubRead;
+			tCompressUnpackResult eResult = compressUnpackerProcess(&UnpackState, &ubRead);
+			if(eResult == COMPRESS_UNPACK_RESULT_DONE) {
+				break;
+			}
+			if(eResult == COMPRESS_UNPACK_RESULT_BUSY_WROTE_BYTE) {
+				vDecompressed[UnpackState.ulWriteOffset - 1] = ubRead;
+			}
+		}
+	}
+
+	for(std::size_t i = 0; i < ulOriginalSize; ++i) {
+		if(vDecompressed[i] != pOriginal[i]) {
+			nLog::error("mismatch at index {}", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::uint32_t getLoadCost(
+	tPakCodec eCodec, std::uint32_t ulDataSize, std::uint32_t ulUncompressedSize
+) {
+	std::uint32_t ulDecodeCost = 0;
+	if(eCodec == tPakCodec::LZSS) {
+		ulDecodeCost = s_ulCostDecodeLzssPerByte;
+	}
+	else if(eCodec == tPakCodec::LZ_FAST) {
+		ulDecodeCost = s_ulCostDecodeFastPerByte;
+	}
+	return ulDataSize * s_ulCostReadPerByte + ulUncompressedSize * ulDecodeCost;
+}
+
+static bool packSegments(
+	const tPakEntry &Entry, const std::vector<std::uint8_t> &vFileContents,
+	const tPakSettings &Settings, tPakCodec eCodec,
+	std::vector<std::uint8_t> &vPackBuffer, std::uint32_t &ulPackedSize,
+	std::vector<std::uint8_t> &vDecompressed
+) {
+	// With restart points, each segment is packed separately and entry data
+	// is prefixed with packed offsets of all segments but the first one.
+	std::uint32_t ulSegmentSize = Entry.ulUncompressedSize;
+	std::uint32_t ulRestartCount = 0;
+	if(Settings.ulRestartInterval) {
+		ulSegmentSize = Settings.ulRestartInterval;
+		if(Entry.ulUncompressedSize) {
+			ulRestartCount = (Entry.ulUncompressedSize - 1) / Settings.ulRestartInterval;
+		}
+	}
+	std::uint32_t ulTableSize = ulRestartCount * sizeof(std::uint32_t);
+
+	std::uint32_t ulPackedOffs = ulTableSize;
+	for(std::uint32_t ulSegment = 0; ulSegment <= ulRestartCount; ++ulSegment) {
+		std::uint32_t ulSrcOffs = ulSegment * ulSegmentSize;
+		std::uint32_t ulSrcSize = std::min(ulSegmentSize, Entry.ulUncompressedSize - ulSrcOffs);
+		std::uint32_t ulMaxSegmentSize = std::max(ulSrcSize * 2, compressPackFastGetMaxSize(ulSrcSize));
+		if(vPackBuffer.size() < ulPackedOffs + ulMaxSegmentSize) {
+			vPackBuffer.resize(ulPackedOffs + ulMaxSegmentSize);
+		}
+		if(ulSegment) {
+			std::uint32_t ulRestartOffsBe = nEndian::toBig32(ulPackedOffs - ulTableSize);
+			std::memcpy(
+				&vPackBuffer[(ulSegment - 1) * sizeof(std::uint32_t)],
+				&ulRestartOffsBe, sizeof(ulRestartOffsBe)
+			);
+		}
+		const std::uint8_t *pSrc = vFileContents.data() + ulSrcOffs;
+		std::uint8_t *pDest = vPackBuffer.data() + ulPackedOffs;
+		std::uint32_t SegmentSize;
+		if(eCodec == tPakCodec::LZ_FAST) {
+			SegmentSize = compressPackFast(pSrc, ulSrcSize, pDest);
+		}
+		else if(Settings.eCompressLevel == tCompressLevel::OPTIMAL) {
+			SegmentSize = compressPackOptimal(pSrc, ulSrcSize, pDest);
+		}
+		else {
+			SegmentSize = compressPack(pSrc, ulSrcSize, pDest);
+		}
+		if(!isUnpackedSame(eCodec, pDest, SegmentSize, pSrc, ulSrcSize, vDecompressed)) {
+			nLog::error("{}: segment {} doesn't unpack properly", Entry.ShortPath, ulSegment);
+			return false;
+		}
+		ulPackedOffs += SegmentSize;
+	}
+	ulPackedSize = ulPackedOffs;
+	return true;
+}
+
+static bool packEntry(
+	tPakEntry &Entry, const tPakSettings &Settings, std::vector<std::uint8_t> &vPackBuffer,
+	std::vector<std::uint8_t> &vDecompressed
+) {
+	std::vector<std::uint8_t> vFileContents;
+	std::ifstream FileIn;
+	FileIn.open(Entry.Path, std::ios::binary);
+	if(FileIn.fail()) {
+		nLog::error("Can't open the file {}", Entry.Path);
+		return false;
+	}
+	vFileContents.resize(Entry.ulUncompressedSize);
+	FileIn.read(reinterpret_cast<char*>(vFileContents.data()), Entry.ulUncompressedSize);
+	Entry.ContentDigest = nSha256::calculate(vFileContents.data(), vFileContents.size());
+
+	// There's nothing to compress in empty files and packing them would operate
+	// on empty buffers
+	if(!Settings.isCompressed || !Entry.ulUncompressedSize) {
+		Entry.eCodec = tPakCodec::NONE;
+		Entry.vData = std::move(vFileContents);
+		return true;
+	}
+
+	std::string CacheBlobPath;
+	if(!Settings.CachePath.empty()) {
+		CacheBlobPath = getCacheBlobPath(Settings, Entry);
+		if(cacheLoad(CacheBlobPath, Entry)) {
+			return true;
+		}
+	}
+
+	std::vector<tPakCodec> vCodecs;
+	if(Settings.eCodecSelection != tCodecSelection::LZ_FAST) {
+		vCodecs.push_back(tPakCodec::LZSS);
+	}
+	if(Settings.eCodecSelection != tCodecSelection::LZSS) {
+		vCodecs.push_back(tPakCodec::LZ_FAST);
+	}
+
+	// Packed data is only used if it's noticeably smaller. When selecting the
+	// codec automatically, the one giving the fastest load is used, which
+	// may also mean storing the entry uncompressed.
+	Entry.eCodec = tPakCodec::NONE;
+	auto ulBestCost = getLoadCost(tPakCodec::NONE, Entry.ulUncompressedSize, Entry.ulUncompressedSize);
+	for(auto eCodec: vCodecs) {
+		std::uint32_t ulPackedSize;
+		if(!packSegments(Entry, vFileContents, Settings, eCodec, vPackBuffer, ulPackedSize, vDecompressed)) {
+			return false;
+		}
+		if(ulPackedSize + 10 >= vFileContents.size()) {
+			continue;
+		}
+		auto ulCost = getLoadCost(eCodec, ulPackedSize, Entry.ulUncompressedSize);
+		if(Settings.eCodecSelection != tCodecSelection::AUTO || ulCost < ulBestCost) {
+			ulBestCost = ulCost;
+			Entry.eCodec = eCodec;
+			Entry.vData = std::vector(vPackBuffer.data(), vPackBuffer.data() + ulPackedSize);
+		}
+	}
+	if(Entry.eCodec == tPakCodec::NONE) {
+		Entry.vData = std::move(vFileContents);
+	}
+
+	if(!CacheBlobPath.empty()) {
+		cacheStore(CacheBlobPath, Entry);
+	}
+	return true;
+}
+
+static bool packEntries(std::vector<tPakEntry> &vEntries, const tPakSettings &Settings, std::uint32_t ulJobCount) {
+	// Entries are independent, so workers just grab the next unprocessed one.
+	// Their order in vEntries is kept, so the output is the same regardless of
+	// the job count.
+	std::atomic<std::size_t> NextIndex = 0;
+	std::atomic<bool> isFailed = false;
+	auto Worker = [&]() {
+		std::vector<std::uint8_t> vPackBuffer;
+		std::vector<std::uint8_t> vDecompressed;
+		while(!isFailed) {
+			auto Index = NextIndex++;
+			if(Index >= vEntries.size()) {
+				break;
+			}
+			if(!packEntry(vEntries[Index], Settings, vPackBuffer, vDecompressed)) {
+				isFailed = true;
+			}
+		}
+	};
+
+	ulJobCount = std::max(1u, std::min(ulJobCount, std::uint32_t(vEntries.size())));
+	if(ulJobCount == 1) {
+		Worker();
+	}
+	else {
+		std::vector<std::thread> vThreads;
+		for(std::uint32_t i = 0; i < ulJobCount; ++i) {
+			vThreads.emplace_back(Worker);
+		}
+		for(auto &Thread: vThreads) {
+			Thread.join();
+		}
+	}
+	return !isFailed;
+}
+
+static bool discoverEntries(const std::string &InPath, std::vector<tPakEntry> &vEntries) {
+	auto AbsoluteBasePath = std::filesystem::absolute(InPath);
+	bool isCollided = false;
+  for (std::filesystem::recursive_directory_iterator i(InPath), end; i != end; ++i) {
+    if (!is_directory(i->path())) {
+			tPakEntry Entry;
+			Entry.ShortPath = std::filesystem::relative(i->path(), AbsoluteBasePath).generic_string();
+			Entry.Path = i->path().generic_string();
+			Entry.ulUncompressedSize = std::uint32_t(std::filesystem::file_size(Entry.Path));
+			Entry.ulChecksum = adler32Buffer(
+				reinterpret_cast<const std::uint8_t*>(Entry.ShortPath.c_str()),
+				std::uint32_t(Entry.ShortPath.size())
+			);
+			for(auto OtherIndex = 0; OtherIndex < vEntries.size(); ++OtherIndex) {
+				if(Entry.ulChecksum == vEntries[OtherIndex].ulChecksum) {
+					nLog::error("Entry {} checksum collision with entry {}", vEntries.size(), OtherIndex);
+					isCollided = true;
+				}
+			}
+
+			vEntries.push_back(Entry);
+		}
+	}
+	fmt::print("Discovered {} files\n", vEntries.size());
+	if(isCollided) {
+		nLog::error("Aborting due to checksum collisions! Report an issue and/or change your file names a bit.");
+		return false;
+	}
+	return true;
+}
+
+struct tTraceRecord {
+	std::uint32_t ulPathHash;
+	std::uint32_t ulOpenTime;
+	std::uint32_t ulBytesRead;
+};
+
+static bool readTrace(const std::string &TracePath, std::vector<tTraceRecord> &vRecords) {
+	std::ifstream FileTrace;
+	FileTrace.open(TracePath, std::ios::binary);
+	if(FileTrace.fail()) {
+		nLog::error("Can't open trace file {}", TracePath);
+		return false;
+	}
+	auto readLong = [&FileTrace](std::uint32_t &ulOut) {
+		std::uint32_t ulBe;
+		FileTrace.read(reinterpret_cast<char*>(&ulBe), sizeof(ulBe));
+		ulOut = nEndian::fromBig32(ulBe);
+		return !FileTrace.fail();
+	};
+	std::uint32_t ulMagic;
+	if(!readLong(ulMagic) || ulMagic != s_ulPakTraceMagic) {
+		nLog::error("{} isn't a pak trace file", TracePath);
+		return false;
+	}
+	vRecords.clear();
+	tTraceRecord Record;
+	while(
+		readLong(Record.ulPathHash) && readLong(Record.ulOpenTime) &&
+		readLong(Record.ulBytesRead)
+	) {
+		vRecords.push_back(Record);
+	}
+	return true;
+}
+
+static int makeOrderFile(
+	const std::string &InPath, const std::string &OrderPath,
+	const std::vector<std::string> &vTracePaths
+) {
+	if(!nFs::isDir(InPath)) {
+		nLog::error("Path {} isn't a folder", InPath);
+		return EXIT_FAILURE;
+	}
+	std::vector<tPakEntry> vEntries;
+	if(!discoverEntries(InPath, vEntries)) {
+		return EXIT_FAILURE;
+	}
+	std::map<std::uint32_t, std::size_t> mHashToEntry;
+	for(std::size_t i = 0; i < vEntries.size(); ++i) {
+		mHashToEntry[vEntries[i].ulChecksum] = i;
+	}
+
+	// Files are ordered by their first open in each trace. With many traces,
+	// e.g. of different playthroughs, relative positions of first opens are
+	// averaged, so that files needed early in most of them go first.
+	struct tFileStats {
+		double fPosSum = 0;
+		std::uint32_t ulTraceCount = 0;
+		std::uint32_t ulOpenCount = 0;
+		std::uint64_t ullBytesRead = 0;
+	};
+	std::map<std::size_t, tFileStats> mStats;
+	std::uint32_t ulUnknownCount = 0;
+	for(const auto &TracePath: vTracePaths) {
+		std::vector<tTraceRecord> vRecords;
+		if(!readTrace(TracePath, vRecords)) {
+			return EXIT_FAILURE;
+		}
+		// Records are written on close, so put them in order of opening
+		std::stable_sort(
+			vRecords.begin(), vRecords.end(),
+			[](const tTraceRecord &A, const tTraceRecord &B) {
+				return A.ulOpenTime < B.ulOpenTime;
+			}
+		);
+		std::vector<std::size_t> vFirstOpens;
+		for(const auto &Record: vRecords) {
+			auto Found = mHashToEntry.find(Record.ulPathHash);
+			if(Found == mHashToEntry.end()) {
+				fmt::println(FMT_STRING("WARN: unknown path hash {:08X} in {}"), Record.ulPathHash, TracePath);
+				++ulUnknownCount;
+				continue;
+			}
+			auto &Stats = mStats[Found->second];
+			if(std::find(vFirstOpens.begin(), vFirstOpens.end(), Found->second) == vFirstOpens.end()) {
+				vFirstOpens.push_back(Found->second);
+			}
+			++Stats.ulOpenCount;
+			Stats.ullBytesRead += Record.ulBytesRead;
+		}
+		for(std::size_t Pos = 0; Pos < vFirstOpens.size(); ++Pos) {
+			auto &Stats = mStats[vFirstOpens[Pos]];
+			Stats.fPosSum += double(Pos) / vFirstOpens.size();
+			++Stats.ulTraceCount;
+		}
+		fmt::print("{}: {} opens of {} files\n", TracePath, vRecords.size(), vFirstOpens.size());
+	}
+
+	std::vector<std::size_t> vOrder;
+	for(const auto &[EntryIndex, Stats]: mStats) {
+		vOrder.push_back(EntryIndex);
+	}
+	std::stable_sort(
+		vOrder.begin(), vOrder.end(), [&mStats](std::size_t A, std::size_t B) {
+			return mStats[A].fPosSum / mStats[A].ulTraceCount < mStats[B].fPosSum / mStats[B].ulTraceCount;
+		}
+	);
+
+	std::ofstream FileOrder;
+	FileOrder.open(OrderPath);
+	if(FileOrder.fail()) {
+		nLog::error("Can't open the file {} for writing", OrderPath);
+		return EXIT_FAILURE;
+	}
+	std::uint64_t ullTotalBytesRead = 0;
+	for(auto EntryIndex: vOrder) {
+		const auto &Stats = mStats[EntryIndex];
+		fmt::print(
+			"{}: traces: {}, opens: {}, bytes read: {}\n", vEntries[EntryIndex].ShortPath,
+			Stats.ulTraceCount, Stats.ulOpenCount, Stats.ullBytesRead
+		);
+		FileOrder << vEntries[EntryIndex].ShortPath << '\n';
+		ullTotalBytesRead += Stats.ullBytesRead;
+	}
+	fmt::print(
+		"Ordered {} of {} files, {} bytes read in total, {} unknown records\n",
+		vOrder.size(), vEntries.size(), ullTotalBytesRead, ulUnknownCount
+	);
+	return EXIT_SUCCESS;
+}
+
 static void printUsage(const std::string &szAppName) {
 	using fmt::print;
-	print("Usage:\n\t{} inDir outPak [extraOpts]\n\n", szAppName);
+	print("Usage:\n\t{} inDir outPak [extraOpts]\n", szAppName);
+	print("\t{} -order inDir outOrder.txt trace [trace...]\n\n", szAppName);
 	print("Required arguments:\n");
 	print("\tinDir   Path to input directory.\n");
 	print("\toutPak  Path to output pak file.\n");
 	print("Extra options:\n");
 	print("\t-c                Enable compression.\n");
+	print("\t-c2               Enable compression with optimal parsing - smaller output, much slower packing.\n");
+	print("\t-codec name       With -c, use given codec: lzss (default), fast - decodes faster, but compresses worse,\n");
+	print("\t                  or auto - choose the one with the shortest load time for each file.\n");
+	print("\t-s N              With -c, add restart points every N KiB of compressed files for fast seeking.\n");
+	print("\t-i                Sort file index by path hash for faster lookups. Breaks pakFileGetFileByIndex() order.\n");
+	print("\t-cache dir        With -c, reuse compressed and verified files from given cache directory.\n");
+	print("\t-j N              Pack and verify entries using N threads. 0 uses all cores. Default: 1.\n");
 	print("\t-r orderfile.txt  Reorder files with list file - one path per line. Omitted files will be appended at the end.\n");
+	print("Order mode:\n");
+	print("\tCreates order file for -r from traces recorded with pakFileTraceBegin(),\n");
+	print("\tsorting files of inDir by their first access. Untraced files are omitted.\n");
 }
 
 int main(int lArgCount, const char *pArgs[])
 {
 	using namespace std::string_view_literals;
 
+	if(lArgCount > 1 && pArgs[1] == "-order"sv) {
+		if(lArgCount < 5) {
+			nLog::error("Too few arguments for order mode");
+			printUsage(pArgs[0]);
+			return EXIT_FAILURE;
+		}
+		return makeOrderFile(
+			pArgs[2], pArgs[3], std::vector<std::string>(&pArgs[4], &pArgs[lArgCount])
+		);
+	}
+
 	const std::uint8_t ubMandatoryArgCnt = 2;
 	if(lArgCount - 1 < ubMandatoryArgCnt) {
 		nLog::error("Too few arguments, expected {}", ubMandatoryArgCnt);
@@ -62,12 +602,69 @@ int main(int lArgCount, const char *pArgs[])
 	std::string InPath(pArgs[1]);
 	std::string OutPath(pArgs[2]);
 	std::string OrderPath;
-	bool isCompressed = false;
+	tPakSettings Settings;
+	std::uint32_t ulJobCount = 1;
 
 	for(auto ArgIndex = 3; ArgIndex < lArgCount; ++ArgIndex) {
 		std::string_view Arg = pArgs[ArgIndex];
 		if(Arg == "-c"sv) {
-			isCompressed = true;
+			Settings.isCompressed = true;
+		}
+		else if(Arg == "-c2"sv) {
+			Settings.isCompressed = true;
+			Settings.eCompressLevel = tCompressLevel::OPTIMAL;
+		}
+		else if(Arg == "-codec"sv && ArgIndex + 1 < lArgCount) {
+			std::string_view Codec = pArgs[++ArgIndex];
+			if(Codec == "lzss"sv) {
+				Settings.eCodecSelection = tCodecSelection::LZSS;
+			}
+			else if(Codec == "fast"sv) {
+				Settings.eCodecSelection = tCodecSelection::LZ_FAST;
+			}
+			else if(Codec == "auto"sv) {
+				Settings.eCodecSelection = tCodecSelection::AUTO;
+			}
+			else {
+				nLog::error("Unknown codec: '{}'", Codec);
+				printUsage(pArgs[0]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if(Arg == "-cache"sv && ArgIndex + 1 < lArgCount) {
+			Settings.CachePath = pArgs[++ArgIndex];
+		}
+		else if(Arg == "-i"sv) {
+			Settings.isSortedByHash = true;
+		}
+		else if(Arg == "-s"sv && ArgIndex + 1 < lArgCount) {
+			std::int32_t lIntervalKib;
+			if(!nParse::toInt32(pArgs[++ArgIndex], "restart interval", lIntervalKib)) {
+				printUsage(pArgs[0]);
+				return EXIT_FAILURE;
+			}
+			if(lIntervalKib < 0 || lIntervalKib > std::numeric_limits<std::uint32_t>::max() / 1024) {
+				nLog::error("Restart interval out of range: {} KiB", lIntervalKib);
+				printUsage(pArgs[0]);
+				return EXIT_FAILURE;
+			}
+			Settings.ulRestartInterval = std::uint32_t(lIntervalKib) * 1024;
+		}
+		else if(Arg == "-j"sv && ArgIndex + 1 < lArgCount) {
+			std::int32_t lJobCount;
+			if(!nParse::toInt32(pArgs[++ArgIndex], "job count", lJobCount)) {
+				printUsage(pArgs[0]);
+				return EXIT_FAILURE;
+			}
+			if(lJobCount < 0) {
+				nLog::error("Job count can't be negative: {}", lJobCount);
+				printUsage(pArgs[0]);
+				return EXIT_FAILURE;
+			}
+			ulJobCount = std::uint32_t(lJobCount);
+			if(!ulJobCount) {
+				ulJobCount = std::max(1u, std::thread::hardware_concurrency());
+			}
 		}
 		else if(Arg == "-r"sv && ArgIndex + 1 < lArgCount) {
 			OrderPath = pArgs[++ArgIndex];
@@ -79,11 +676,32 @@ int main(int lArgCount, const char *pArgs[])
 		}
 	}
 
+	if(Settings.ulRestartInterval && !Settings.isCompressed) {
+		nLog::error("Restart points require compression to be enabled");
+		printUsage(pArgs[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(Settings.eCodecSelection != tCodecSelection::LZSS && !Settings.isCompressed) {
+		nLog::error("Codec selection requires compression to be enabled");
+		printUsage(pArgs[0]);
+		return EXIT_FAILURE;
+	}
+
 	if(!nFs::isDir(InPath)) {
 		nLog::error("Path {} isn't a folder", InPath);
 		return EXIT_FAILURE;
 	}
 
+	if(!Settings.CachePath.empty()) {
+		std::error_code Error;
+		std::filesystem::create_directories(Settings.CachePath, Error);
+		if(Error) {
+			nLog::error("Can't create cache folder {}: {}", Settings.CachePath, Error.message());
+			return EXIT_FAILURE;
+		}
+	}
+
 	std::ofstream FilePak;
 	FilePak.open(OutPath, std::ios::binary);
 	if(FilePak.fail()) {
@@ -92,83 +710,16 @@ int main(int lArgCount, const char *pArgs[])
 	}
 	std::vector<tPakEntry> vEntries;
 
-	auto AbsoluteBasePath = std::filesystem::absolute(InPath);
-	bool isCollided = false;
-	std::vector<std::uint8_t> vFileContents;
-	std::vector<std::uint8_t> vPackBuffer;
-	std::vector<std::uint8_t> vDecompressed;
-  for (std::filesystem::recursive_directory_iterator i(InPath), end; i != end; ++i) {
-    if (!is_directory(i->path())) {
-			tPakEntry Entry;
-			Entry.ShortPath = std::filesystem::relative(i->path(), AbsoluteBasePath).generic_string();
-			Entry.Path = i->path().generic_string();
-			Entry.ulUncompressedSize = std::uint32_t(std::filesystem::file_size(Entry.Path));
-			Entry.ulChecksum = adler32Buffer(
-				reinterpret_cast<const std::uint8_t*>(Entry.ShortPath.c_str()),
-				std::uint32_t(Entry.ShortPath.size())
-			);
-			for(auto OtherIndex = 0; OtherIndex < vEntries.size(); ++OtherIndex) {
-				if(Entry.ulChecksum == vEntries[OtherIndex].ulChecksum) {
-					nLog::error("Entry {} checksum collision with entry {}", vEntries.size(), OtherIndex);
-					isCollided = true;
-				}
-			}
-
-			std::ifstream FileIn;
-			FileIn.open(Entry.Path, std::ios::binary);
-			if(FileIn.fail()) {
-				nLog::error("Can't open the file");
-				return EXIT_FAILURE;
-			}
-			vFileContents.resize(Entry.ulUncompressedSize);
-			FileIn.read(reinterpret_cast<char*>(vFileContents.data()), Entry.ulUncompressedSize);
-
-			if(isCompressed) {
-				if(vPackBuffer.size() < Entry.ulUncompressedSize * 2) {
-					vPackBuffer.resize(Entry.ulUncompressedSize * 2);
-				}
-				auto CompressedSize = (std::uint32_t)compressPack(
-					vFileContents.data(), Entry.ulUncompressedSize, vPackBuffer.data()
-				);
-
-				vDecompressed.resize(Entry.ulUncompressedSize);
-				tCompressUnpacker UnpackState;
-				compressUnpackerInit(&UnpackState, vPackBuffer.data(), CompressedSize, Entry.ulUncompressedSize);
-				while(true) {
-					std::uint8_t ubRead;
-					tCompressUnpackResult eResult = compressUnpackerProcess(&UnpackState, &ubRead);
-					if(eResult == COMPRESS_UNPACK_RESULT_DONE) {
-						break;
-					}
-					if(eResult == COMPRESS_UNPACK_RESULT_BUSY_WROTE_BYTE) {
-						vDecompressed[UnpackState.ulWriteOffset - 1] = ubRead;
-					}
-				}
-
-				for(std::size_t i = 0; i < Entry.ulUncompressedSize; ++i) {
-					if(vDecompressed[i] != vFileContents[i]) {
-						nLog::error("mismatch at index {}", i);
-						return EXIT_FAILURE;
-					}
-				}
-
-				if(CompressedSize < vFileContents.size() - 10) {
-					Entry.vData = std::vector(&vPackBuffer[0], &vPackBuffer[CompressedSize]);
-				}
-				else {
-					Entry.vData = vFileContents;
-				}
-			}
-			else {
-				Entry.vData = vFileContents;
-			}
+	if(!discoverEntries(InPath, vEntries)) {
+		return EXIT_FAILURE;
+	}
 
-			vEntries.push_back(Entry);
-		}
+	if(vEntries.size() >= 0xFFFF) {
+		nLog::error("Too many files: {}, max is {}", vEntries.size(), 0xFFFF - 1);
+		return EXIT_FAILURE;
 	}
-	fmt::print("Discovered {} files\n", vEntries.size());
-	if(isCollided) {
-		nLog::error("Aborting due to checksum collisions! Report an issue and/or change your file names a bit.");
+
+	if(!packEntries(vEntries, Settings, ulJobCount)) {
 		return EXIT_FAILURE;
 	}
 
@@ -204,20 +755,91 @@ int main(int lArgCount, const char *pArgs[])
 		vEntries = vOrderedEntries;
 	}
 
+	// Extended header is only used when needed so that plain paks are still
+	// readable by older engine versions
+	std::uint16_t uwFlags = 0;
+	if(Settings.ulRestartInterval) {
+		uwFlags |= s_uwPakFlagRestartPoints;
+	}
+	if(Settings.isSortedByHash) {
+		uwFlags |= s_uwPakFlagSortedByHash;
+	}
+	if(Settings.isCompressed && Settings.eCodecSelection != tCodecSelection::LZSS) {
+		uwFlags |= s_uwPakFlagEntryCodecs;
+	}
+	std::uint32_t ulHeaderSize = 0;
+	if(uwFlags) {
+		std::uint16_t uwExtendedBe = nEndian::toBig16(s_uwPakHeaderExtended);
+		std::uint16_t uwFlagsBe = nEndian::toBig16(uwFlags);
+		FilePak.write(reinterpret_cast<char*>(&uwExtendedBe), sizeof(uwExtendedBe));
+		FilePak.write(reinterpret_cast<char*>(&uwFlagsBe), sizeof(uwFlagsBe));
+		ulHeaderSize += sizeof(uwExtendedBe) + sizeof(uwFlagsBe);
+	}
 	std::uint16_t uwFileCount = std::uint16_t(vEntries.size());
 	std::uint16_t uwFileCountBe = nEndian::toBig16(uwFileCount);
 	FilePak.write(reinterpret_cast<char*>(&uwFileCountBe), sizeof(uwFileCountBe));
-	std::uint32_t ulNextFileOffs = sizeof(uwFileCount) + (uwFileCount * 4 * sizeof(std::uint32_t));
-	std::uint16_t i = 0;
+	ulHeaderSize += sizeof(uwFileCountBe);
+	if(uwFlags & s_uwPakFlagRestartPoints) {
+		std::uint32_t ulRestartIntervalBe = nEndian::toBig32(Settings.ulRestartInterval);
+		FilePak.write(reinterpret_cast<char*>(&ulRestartIntervalBe), sizeof(ulRestartIntervalBe));
+		ulHeaderSize += sizeof(ulRestartIntervalBe);
+	}
+
+	// Data is laid out in vEntries order, which may be set with order file,
+	// while the index may be sorted independently for binary search.
+	// Entries with identical contents share the data of first one of them.
+	std::vector<std::uint32_t> vOffsets;
+	std::vector<bool> vIsDataWritten;
+	std::map<nSha256::tDigest, std::uint32_t> mDigestToOffset;
+	std::uint32_t ulDedupCount = 0, ulDedupBytes = 0;
+	std::uint32_t ulIndexEntrySize = 4 * sizeof(std::uint32_t);
+	if(uwFlags & s_uwPakFlagEntryCodecs) {
+		ulIndexEntrySize += sizeof(std::uint16_t);
+	}
+	std::uint32_t ulNextFileOffs = ulHeaderSize + uwFileCount * ulIndexEntrySize;
 	for(const auto &Entry: vEntries) {
+		auto Found = mDigestToOffset.find(Entry.ContentDigest);
+		if(Found != mDigestToOffset.end()) {
+			vOffsets.push_back(Found->second);
+			vIsDataWritten.push_back(false);
+			++ulDedupCount;
+			ulDedupBytes += std::uint32_t(Entry.vData.size());
+		}
+		else {
+			mDigestToOffset[Entry.ContentDigest] = ulNextFileOffs;
+			vOffsets.push_back(ulNextFileOffs);
+			vIsDataWritten.push_back(true);
+			ulNextFileOffs += std::uint32_t(Entry.vData.size());
+		}
+	}
+	if(ulDedupCount) {
+		fmt::print("Deduplicated {} files, saved {} bytes\n", ulDedupCount, ulDedupBytes);
+	}
+
+	std::vector<std::uint16_t> vIndexOrder(uwFileCount);
+	for(std::uint16_t i = 0; i < uwFileCount; ++i) {
+		vIndexOrder[i] = i;
+	}
+	if(Settings.isSortedByHash) {
+		std::sort(
+			vIndexOrder.begin(), vIndexOrder.end(),
+			[&vEntries](std::uint16_t uwA, std::uint16_t uwB) {
+				return vEntries[uwA].ulChecksum < vEntries[uwB].ulChecksum;
+			}
+		);
+	}
+
+	for(auto EntryIndex: vIndexOrder) {
+		const auto &Entry = vEntries[EntryIndex];
 		fmt::print(
-			"Writing subfile {:4d}: '{}', offset: {}, uncompressed: {}, size: {}, ratio: {:.2f}, checksum: {:08X}...\n",
-			i++, Entry.ShortPath, ulNextFileOffs, Entry.ulUncompressedSize,
-			Entry.vData.size(), float(Entry.vData.size()) / Entry.ulUncompressedSize * 100, Entry.ulChecksum
+			"Writing subfile {:4d}: '{}', offset: {}, uncompressed: {}, size: {}, ratio: {:.2f}, codec: {}, checksum: {:08X}...\n",
+			EntryIndex, Entry.ShortPath, vOffsets[EntryIndex], Entry.ulUncompressedSize,
+			Entry.vData.size(), float(Entry.vData.size()) / Entry.ulUncompressedSize * 100,
+			std::uint8_t(Entry.eCodec), Entry.ulChecksum
 		);
 
 		std::uint32_t ulChecksumBe = nEndian::toBig32(Entry.ulChecksum);
-		std::uint32_t ulOffsBe = nEndian::toBig32(ulNextFileOffs);
+		std::uint32_t ulOffsBe = nEndian::toBig32(vOffsets[EntryIndex]);
 		std::uint32_t ulUncompressedSizeBe = nEndian::toBig32(Entry.ulUncompressedSize);
 		std::uint32_t ulDataSizeBe = nEndian::toBig32(std::uint32_t(Entry.vData.size()));
 
@@ -225,13 +847,17 @@ int main(int lArgCount, const char *pArgs[])
 		FilePak.write(reinterpret_cast<char*>(&ulOffsBe), sizeof(ulOffsBe));
 		FilePak.write(reinterpret_cast<const char*>(&ulUncompressedSizeBe), sizeof(ulUncompressedSizeBe));
 		FilePak.write(reinterpret_cast<char*>(&ulDataSizeBe), sizeof(ulDataSizeBe));
-
-		ulNextFileOffs += std::uint32_t(Entry.vData.size());
+		if(uwFlags & s_uwPakFlagEntryCodecs) {
+			std::uint16_t uwCodecBe = nEndian::toBig16(std::uint16_t(Entry.eCodec));
+			FilePak.write(reinterpret_cast<char*>(&uwCodecBe), sizeof(uwCodecBe));
+		}
 	}
 
-	for(const auto &Entry: vEntries) {
-		std::uint32_t UncompressedSizeBe = isCompressed ? nEndian::toBig32(Entry.ulUncompressedSize) : 0;
-		FilePak.write(reinterpret_cast<const char *>(Entry.vData.data()), Entry.vData.size());
+	for(std::size_t EntryIndex = 0; EntryIndex < vEntries.size(); ++EntryIndex) {
+		if(vIsDataWritten[EntryIndex]) {
+			const auto &Entry = vEntries[EntryIndex];
+			FilePak.write(reinterpret_cast<const char *>(Entry.vData.data()), Entry.vData.size());
+		}
 	}
 
 	fmt::print("All done!\n");